@@ -0,0 +1,194 @@
+#include "asynclogger.h"
+
+#include <QAtomicInteger>
+
+#include <SDL.h>
+
+// Must be a power of 2
+#define LOG_RING_SIZE 4096
+
+// Maximum amount of data to write in a single batch
+#define MAX_BATCH_BYTES (64 * 1024)
+
+#define FLUSH_TIMEOUT_MS 1000
+
+namespace {
+
+// Bounded multi-producer queue with a single consumer. Each slot carries a
+// sequence number that tells producers and the consumer whose turn it is.
+struct LogSlot
+{
+    QAtomicInteger<quint32> sequence;
+    QByteArray message;
+};
+
+LogSlot s_Ring[LOG_RING_SIZE];
+QAtomicInteger<quint32> s_EnqueuePos;
+QAtomicInteger<quint32> s_DequeuePos;
+QAtomicInteger<quint32> s_WrittenPos;
+QAtomicInt s_DroppedMessages;
+QAtomicInt s_WakePending;
+QAtomicInt s_StopRequested;
+
+AsyncLogger::WriteFunction s_Writer;
+SDL_sem* s_WakeSem;
+SDL_Thread* s_WriterThread;
+
+void wakeWriter()
+{
+    // Only post once until the writer wakes up to avoid needless wakeups
+    if (s_WakePending.testAndSetOrdered(0, 1)) {
+        SDL_SemPost(s_WakeSem);
+    }
+}
+
+bool dequeueMessage(QByteArray& batch)
+{
+    quint32 pos = s_DequeuePos.loadAcquire();
+    LogSlot& slot = s_Ring[pos & (LOG_RING_SIZE - 1)];
+
+    if (slot.sequence.loadAcquire() != pos + 1) {
+        // The producer hasn't finished writing this slot yet
+        return false;
+    }
+
+    batch += slot.message;
+    slot.message.clear();
+
+    // Hand the slot back to producers for the next lap around the ring
+    slot.sequence.storeRelease(pos + LOG_RING_SIZE);
+    s_DequeuePos.storeRelease(pos + 1);
+    return true;
+}
+
+// Writes out everything in the ring. Only one thread may drain at a time.
+void drainRing()
+{
+    QByteArray batch;
+
+    for (;;) {
+        bool drained = false;
+        while (batch.size() < MAX_BATCH_BYTES) {
+            if (!dequeueMessage(batch)) {
+                drained = true;
+                break;
+            }
+        }
+
+        int dropped = s_DroppedMessages.fetchAndStoreOrdered(0);
+        if (dropped != 0) {
+            batch += QString("Dropped %1 log messages\n").arg(dropped).toUtf8();
+        }
+
+        if (!batch.isEmpty()) {
+            s_Writer(batch);
+            batch.clear();
+        }
+
+        s_WrittenPos.storeRelease(s_DequeuePos.loadAcquire());
+
+        if (drained) {
+            break;
+        }
+    }
+}
+
+int writerThreadProc(void*)
+{
+    for (;;) {
+        SDL_SemWait(s_WakeSem);
+        s_WakePending.storeRelease(0);
+
+        drainRing();
+
+        if (s_StopRequested.loadAcquire()) {
+            break;
+        }
+    }
+
+    return 0;
+}
+}
+
+void AsyncLogger::start(WriteFunction writer)
+{
+    Q_ASSERT(s_WriterThread == nullptr);
+
+    for (quint32 i = 0; i < LOG_RING_SIZE; i++) {
+        s_Ring[i].sequence.storeRelease(i);
+    }
+
+    s_Writer = writer;
+    s_WakeSem = SDL_CreateSemaphore(0);
+    s_WriterThread = SDL_CreateThread(writerThreadProc, "Logger", nullptr);
+}
+
+void AsyncLogger::stop()
+{
+    if (s_WriterThread == nullptr) {
+        return;
+    }
+
+    s_StopRequested.storeRelease(1);
+    SDL_SemPost(s_WakeSem);
+    SDL_WaitThread(s_WriterThread, nullptr);
+    s_WriterThread = nullptr;
+
+    SDL_DestroySemaphore(s_WakeSem);
+    s_WakeSem = nullptr;
+}
+
+void AsyncLogger::log(const QString& message)
+{
+    if (s_WriterThread == nullptr) {
+        return;
+    }
+
+    quint32 pos = s_EnqueuePos.loadAcquire();
+    for (;;) {
+        LogSlot& slot = s_Ring[pos & (LOG_RING_SIZE - 1)];
+        qint32 diff = (qint32)(slot.sequence.loadAcquire() - pos);
+
+        if (diff == 0) {
+            // The slot is free, so try to claim it
+            if (s_EnqueuePos.testAndSetOrdered(pos, pos + 1, pos)) {
+                slot.message = message.toUtf8();
+                slot.sequence.storeRelease(pos + 1);
+                break;
+            }
+        }
+        else if (diff < 0) {
+            // The ring is full. The writer will report the drop.
+            s_DroppedMessages.fetchAndAddRelaxed(1);
+            break;
+        }
+        else {
+            // Another producer claimed this slot first
+            pos = s_EnqueuePos.loadAcquire();
+        }
+    }
+
+    wakeWriter();
+}
+
+void AsyncLogger::flush()
+{
+    if (s_WriterThread == nullptr) {
+        return;
+    }
+    else if (SDL_ThreadID() == SDL_GetThreadID(s_WriterThread)) {
+        // The writer can't be waiting on itself, so we're in a fatal error
+        // or crash handler that interrupted it. Write the rest directly.
+        drainRing();
+        return;
+    }
+
+    quint32 target = s_EnqueuePos.loadAcquire();
+    Uint32 startTime = SDL_GetTicks();
+
+    wakeWriter();
+    while ((qint32)(s_WrittenPos.loadAcquire() - target) < 0 &&
+           !SDL_TICKS_PASSED(SDL_GetTicks(), startTime + FLUSH_TIMEOUT_MS)) {
+        SDL_Delay(1);
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+// Moves log output off of the logging threads. Messages are placed in a
+// bounded lock-free ring and written in batches by a background thread,
+// so a burst of log messages can never block a real-time thread on I/O.
+// If the ring is full, messages are dropped and the number of dropped
+// messages is reported once there is space again.
+class AsyncLogger
+{
+public:
+    typedef void (*WriteFunction)(const QByteArray& batch);
+
+    // Starts the writer thread. Messages logged before start() or after
+    // stop() are discarded.
+    static void start(WriteFunction writer);
+
+    // Writes all remaining messages and stops the writer thread
+    static void stop();
+
+    // May be called from any thread without blocking
+    static void log(const QString& message);
+
+    // Blocks until all messages logged before this call are written. This
+    // is safe to call from fatal error and crash handlers on any thread.
+    static void flush();
+};
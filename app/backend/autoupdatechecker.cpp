@@ -1,4 +1,5 @@
 #include "autoupdatechecker.h"
+#include "startuptracer.h"
 
 #include <QNetworkReply>
 #include <QJsonDocument>
@@ -34,6 +35,15 @@ void AutoUpdateChecker::start()
         return;
     }
 
+    // The update check isn't urgent, so wait until the UI is up
+    StartupTracer::runWhenInteractive(this, [this] {
+        startUpdateCheck();
+    });
+}
+
+void AutoUpdateChecker::startUpdateCheck()
+{
+
 #if defined(Q_OS_WIN32) || defined(Q_OS_DARWIN) || defined(STEAM_LINK) || defined(APP_IMAGE) // Only run update checker on platforms without auto-update
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0) && QT_VERSION < QT_VERSION_CHECK(5, 15, 1) && !defined(QT_NO_BEARERMANAGEMENT)
     // HACK: Set network accessibility to work around QTBUG-80947 (introduced in Qt 5.14.0 and fixed in Qt 5.15.1)
@@ -18,6 +18,8 @@ private slots:
     void handleUpdateCheckRequestFinished(QNetworkReply* reply);
 
 private:
+    void startUpdateCheck();
+
     void parseStringToVersionQuad(QString& string, QVector<int>& version);
 
     int compareVersion(QVector<int>& version1, QVector<int>& version2);
@@ -3,6 +3,19 @@
 
 #include <QImageReader>
 #include <QImageWriter>
+#include <QGuiApplication>
+#include <QScreen>
+
+// Size of the box art in AppView.qml (in device-independent pixels)
+#define BOXART_DISPLAY_WIDTH 200
+#define BOXART_DISPLAY_HEIGHT 267
+
+#define BOXART_PROVIDER_ID "boxart"
+#define BOXART_ORIGINAL_SIZE_KEY "OriginalSize"
+
+QMutex BoxArtManager::s_ImageCacheLock;
+QCache<QString, BoxArtManager::CachedBoxArt> BoxArtManager::s_ImageCache;
+QSize BoxArtManager::s_ThumbnailSize(BOXART_DISPLAY_WIDTH, BOXART_DISPLAY_HEIGHT);
 
 BoxArtManager::BoxArtManager(QObject *parent) :
     QObject(parent),
@@ -36,6 +49,77 @@ BoxArtManager::getFilePathForBoxArt(NvComputer* computer, int appId)
     return dir.filePath(QString::number(appId) + ".png");
 }
 
+QString
+BoxArtManager::getBoxArtId(NvComputer* computer, int appId)
+{
+    return computer->uuid + "/" + QString::number(appId);
+}
+
+QString
+BoxArtManager::getFilePathForThumbnail(const QString& id)
+{
+    // Thumbnails are named by size, so we'll make new ones if the display changes
+    return Path::getBoxArtCacheDir() + "/" + id + "-" +
+            QString::number(s_ThumbnailSize.width()) + "x" +
+            QString::number(s_ThumbnailSize.height()) + ".png";
+}
+
+void
+BoxArtManager::initializeImageCache(int budgetMb)
+{
+    QScreen* screen = QGuiApplication::primaryScreen();
+    qreal dpr = screen != nullptr ? screen->devicePixelRatio() : 1.0;
+
+    s_ThumbnailSize = QSize(qRound(BOXART_DISPLAY_WIDTH * dpr),
+                            qRound(BOXART_DISPLAY_HEIGHT * dpr));
+
+    // Cache costs are in KB
+    QMutexLocker lock(&s_ImageCacheLock);
+    s_ImageCache.setMaxCost(qMax(budgetMb, 1) * 1024);
+}
+
+void
+BoxArtManager::insertCachedBoxArt(const QString& id, const QImage& image, QSize originalSize)
+{
+    CachedBoxArt* cachedBoxArt = new CachedBoxArt();
+    cachedBoxArt->image = image;
+    cachedBoxArt->originalSize = originalSize;
+
+    // QCache takes ownership and evicts the least recently used entries
+    QMutexLocker lock(&s_ImageCacheLock);
+    s_ImageCache.insert(id, cachedBoxArt, (image.bytesPerLine() * image.height()) / 1024 + 1);
+}
+
+QImage
+BoxArtManager::getCachedBoxArt(const QString& id, QSize* originalSize)
+{
+    {
+        QMutexLocker lock(&s_ImageCacheLock);
+        CachedBoxArt* cachedBoxArt = s_ImageCache.object(id);
+        if (cachedBoxArt != nullptr) {
+            *originalSize = cachedBoxArt->originalSize;
+            return cachedBoxArt->image;
+        }
+    }
+
+    // Decode the thumbnail from disk. It's already the size we display.
+    QImageReader reader(getFilePathForThumbnail(id));
+    QImage image = reader.read();
+    if (image.isNull()) {
+        return QImage();
+    }
+
+    // QML compares the original size against known placeholder images
+    *originalSize = image.size();
+    QStringList dimensions = reader.text(BOXART_ORIGINAL_SIZE_KEY).split('x');
+    if (dimensions.count() == 2) {
+        *originalSize = QSize(dimensions[0].toInt(), dimensions[1].toInt());
+    }
+
+    insertCachedBoxArt(id, image, *originalSize);
+    return image;
+}
+
 class NetworkBoxArtLoadTask : public QObject, public QRunnable
 {
     Q_OBJECT
@@ -56,10 +140,10 @@ signals:
 private:
     void run()
     {
-        QUrl image = m_Bam->loadBoxArtFromNetwork(m_Computer, m_App.id);
+        QUrl image = m_Bam->loadBoxArtThumbnail(m_Computer, m_App.id);
         if (image.isEmpty()) {
             // Give it another shot if it fails once
-            image = m_Bam->loadBoxArtFromNetwork(m_Computer, m_App.id);
+            image = m_Bam->loadBoxArtThumbnail(m_Computer, m_App.id);
         }
         emit boxArtFetchCompleted(m_Computer, m_App, image);
     }
@@ -71,17 +155,36 @@ private:
 
 QUrl BoxArtManager::loadBoxArt(NvComputer* computer, NvApp& app)
 {
-    // Try to open the cached file if it exists and contains data
+    QString id = getBoxArtId(computer, app.id);
+    QUrl imageUrl("image://" BOXART_PROVIDER_ID "/" + id);
+
+    // Use the decoded thumbnail if we have one in memory or on disk
+    {
+        QMutexLocker lock(&s_ImageCacheLock);
+        if (s_ImageCache.contains(id)) {
+            return imageUrl;
+        }
+    }
+    if (QFile::exists(getFilePathForThumbnail(id))) {
+        return imageUrl;
+    }
+
+    // If we get here, we need to fetch or scale asynchronously.
+    // Kick off a worker on our thread pool to do just that, unless
+    // one is already running for this app.
+    if (!m_PendingLoads.contains(id)) {
+        m_PendingLoads.insert(id);
+
+        NetworkBoxArtLoadTask* netLoadTask = new NetworkBoxArtLoadTask(this, computer, app);
+        m_ThreadPool.start(netLoadTask);
+    }
+
+    // Show the full size image until the thumbnail is ready
     QFile cacheFile(getFilePathForBoxArt(computer, app.id));
     if (cacheFile.exists() && cacheFile.size() > 0) {
         return QUrl::fromLocalFile(cacheFile.fileName());
     }
 
-    // If we get here, we need to fetch asynchronously.
-    // Kick off a worker on our thread pool to do just that.
-    NetworkBoxArtLoadTask* netLoadTask = new NetworkBoxArtLoadTask(this, computer, app);
-    m_ThreadPool.start(netLoadTask);
-
     // Return the placeholder then we can notify the caller
     // later when the real image is ready.
     return QUrl("qrc:/res/no_app_image.png");
@@ -95,37 +198,113 @@ void BoxArtManager::deleteBoxArt(NvComputer* computer)
     if (dir.cd(computer->uuid)) {
         dir.removeRecursively();
     }
+
+    // Drop the decoded images too
+    QMutexLocker lock(&s_ImageCacheLock);
+    const QList<QString> ids = s_ImageCache.keys();
+    for (const QString& id : ids) {
+        if (id.startsWith(computer->uuid + "/")) {
+            s_ImageCache.remove(id);
+        }
+    }
 }
 
 void BoxArtManager::handleBoxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image)
 {
+    m_PendingLoads.remove(getBoxArtId(computer, app.id));
+
     if (!image.isEmpty()) {
         emit boxArtLoadComplete(computer, app, image);
     }
 }
 
-QUrl BoxArtManager::loadBoxArtFromNetwork(NvComputer* computer, int appId)
+QUrl BoxArtManager::loadBoxArtThumbnail(NvComputer* computer, int appId)
 {
-    NvHTTP http(computer);
-
     QString cachePath = getFilePathForBoxArt(computer, appId);
     QImage image;
-    try {
-        image = http.getBoxArt(appId);
-    } catch (...) {}
-
-    // Cache the box art on disk if it loaded
-    if (!image.isNull()) {
-        if (image.save(cachePath)) {
-            return QUrl::fromLocalFile(cachePath);
+
+    // Scale the full size image if we already downloaded it
+    QFile cacheFile(cachePath);
+    if (cacheFile.exists() && cacheFile.size() > 0) {
+        image = QImageReader(cachePath).read();
+    }
+
+    if (image.isNull()) {
+        NvHTTP http(computer);
+
+        try {
+            image = http.getBoxArt(appId);
+        } catch (...) {}
+
+        if (image.isNull()) {
+            return QUrl();
         }
-        else {
+
+        // Cache the full size box art on disk, so we can make new
+        // thumbnails without fetching it again.
+        if (!image.save(cachePath)) {
             // A failed save() may leave a zero byte file. Make sure that's removed.
             QFile(cachePath).remove();
         }
     }
 
-    return QUrl();
+    if (!createThumbnail(computer, appId, image)) {
+        // Fall back to the full size image
+        return cacheFile.exists() ? QUrl::fromLocalFile(cachePath) : QUrl();
+    }
+
+    return QUrl("image://" BOXART_PROVIDER_ID "/" + getBoxArtId(computer, appId));
+}
+
+bool BoxArtManager::createThumbnail(NvComputer* computer, int appId, const QImage& image)
+{
+    QString id = getBoxArtId(computer, appId);
+
+    // Only ever scale down. AppView.qml detects GFE's placeholder images by the
+    // image's sourceSize, so those must be left at their original size.
+    QImage thumbnail = image;
+    bool isPlaceholder = (image.width() == 130 && image.height() == 180) || // GFE 2.0 placeholder image
+                         (image.width() == 628 && image.height() == 888);   // GFE 3.0 placeholder image
+    if (!isPlaceholder &&
+            (image.width() > s_ThumbnailSize.width() || image.height() > s_ThumbnailSize.height())) {
+        thumbnail = image.scaled(s_ThumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    // Store the original size along with the thumbnail
+    thumbnail.setText(BOXART_ORIGINAL_SIZE_KEY,
+                      QString::number(image.width()) + "x" + QString::number(image.height()));
+
+    QString thumbnailPath = getFilePathForThumbnail(id);
+    if (!thumbnail.save(thumbnailPath)) {
+        QFile(thumbnailPath).remove();
+        return false;
+    }
+
+    insertCachedBoxArt(id, thumbnail, image.size());
+    return true;
+}
+
+BoxArtImageProvider::BoxArtImageProvider()
+    : QQuickImageProvider(QQuickImageProvider::Image,
+                          QQuickImageProvider::ForceAsynchronousImageLoading)
+{
+
+}
+
+QImage BoxArtImageProvider::requestImage(const QString& id, QSize* size, const QSize&)
+{
+    QSize originalSize;
+    QImage image = BoxArtManager::getCachedBoxArt(id, &originalSize);
+    if (image.isNull()) {
+        // The thumbnail must have been deleted
+        image = QImage(":/res/no_app_image.png");
+        originalSize = image.size();
+    }
+
+    if (size != nullptr) {
+        *size = originalSize;
+    }
+    return image;
 }
 
 #include "boxartmanager.moc"
@@ -5,6 +5,10 @@
 #include <QImage>
 #include <QThreadPool>
 #include <QRunnable>
+#include <QQuickImageProvider>
+#include <QCache>
+#include <QMutex>
+#include <QSet>
 
 class BoxArtManager : public QObject
 {
@@ -22,6 +26,17 @@ public:
     void
     deleteBoxArt(NvComputer* computer);
 
+    // Sets the memory budget for decoded box art and picks the thumbnail
+    // size for the primary display. Must be called on the main thread.
+    static
+    void
+    initializeImageCache(int budgetMb);
+
+    // Returns a null image if there's no thumbnail for this box art ID
+    static
+    QImage
+    getCachedBoxArt(const QString& id, QSize* originalSize);
+
 signals:
     void
     boxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image);
@@ -33,12 +48,48 @@ private slots:
     handleBoxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image);
 
 private:
+    struct CachedBoxArt
+    {
+        QImage image;
+        QSize originalSize;
+    };
+
     QUrl
-    loadBoxArtFromNetwork(NvComputer* computer, int appId);
+    loadBoxArtThumbnail(NvComputer* computer, int appId);
+
+    bool
+    createThumbnail(NvComputer* computer, int appId, const QImage& image);
 
     QString
     getFilePathForBoxArt(NvComputer* computer, int appId);
 
+    static
+    QString
+    getBoxArtId(NvComputer* computer, int appId);
+
+    static
+    QString
+    getFilePathForThumbnail(const QString& id);
+
+    static
+    void
+    insertCachedBoxArt(const QString& id, const QImage& image, QSize originalSize);
+
     QDir m_BoxArtDir;
     QThreadPool m_ThreadPool;
+    QSet<QString> m_PendingLoads;
+
+    static QMutex s_ImageCacheLock;
+    static QCache<QString, CachedBoxArt> s_ImageCache; // Protected by s_ImageCacheLock
+    static QSize s_ThumbnailSize;
+};
+
+// Serves box art thumbnails to QML as image://boxart/<uuid>/<appid>
+class BoxArtImageProvider : public QQuickImageProvider
+{
+public:
+    BoxArtImageProvider();
+
+    QImage
+    requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
 };
@@ -2,6 +2,8 @@
 #include "boxartmanager.h"
 #include "nvhttp.h"
 #include "nvpairingmanager.h"
+#include "path.h"
+#include "startuptracer.h"
 
 #include <Limelight.h>
 #include <QtEndian>
@@ -9,148 +11,27 @@
 #include <QThread>
 #include <QThreadPool>
 #include <QCoreApplication>
+#include <QElapsedTimer>
 
+#include <algorithm>
 #include <random>
 
 #define SER_HOSTS "hosts"
 #define SER_HOSTS_BACKUP "hostsbackup"
 
-class PcMonitorThread : public QThread
-{
-    Q_OBJECT
-
-#define TRIES_BEFORE_OFFLINING 2
-#define POLLS_PER_APPLIST_FETCH 10
-
-public:
-    PcMonitorThread(NvComputer* computer)
-        : m_Computer(computer)
-    {
-        setObjectName("Polling thread for " + computer->name);
-    }
-
-private:
-    bool tryPollComputer(NvAddress address, bool& changed)
-    {
-        NvHTTP http(address, 0, m_Computer->serverCert);
-
-        QString serverInfo;
-        try {
-            serverInfo = http.getServerInfo(NvHTTP::NvLogLevel::NVLL_NONE, true);
-        } catch (...) {
-            return false;
-        }
-
-        NvComputer newState(http, serverInfo);
-
-        // Ensure the machine that responded is the one we intended to contact
-        if (m_Computer->uuid != newState.uuid) {
-            qInfo() << "Found unexpected PC" << newState.name << "looking for" << m_Computer->name;
-            return false;
-        }
-
-        changed = m_Computer->update(newState);
-        return true;
-    }
-
-    bool updateAppList(bool& changed)
-    {
-        NvHTTP http(m_Computer);
-
-        QVector<NvApp> appList;
-
-        try {
-            appList = http.getAppList();
-            if (appList.isEmpty()) {
-                return false;
-            }
-        } catch (...) {
-            return false;
-        }
-
-        QWriteLocker lock(&m_Computer->lock);
-        changed = m_Computer->updateAppList(appList);
-        return true;
-    }
-
-    void run() override
-    {
-        // Always fetch the applist the first time
-        int pollsSinceLastAppListFetch = POLLS_PER_APPLIST_FETCH;
-        while (!isInterruptionRequested()) {
-            bool stateChanged = false;
-            bool online = false;
-            bool wasOnline = m_Computer->state == NvComputer::CS_ONLINE;
-            for (int i = 0; i < (wasOnline ? TRIES_BEFORE_OFFLINING : 1) && !online; i++) {
-                for (auto& address : m_Computer->uniqueAddresses()) {
-                    if (isInterruptionRequested()) {
-                        return;
-                    }
-
-                    if (tryPollComputer(address, stateChanged)) {
-                        if (!wasOnline) {
-                            qInfo() << m_Computer->name << "is now online at" << m_Computer->activeAddress.toString();
-                        }
-                        online = true;
-                        break;
-                    }
-                }
-            }
-
-            // Check if we failed after all retry attempts
-            // Note: we don't need to acquire the read lock here,
-            // because we're on the writing thread.
-            if (!online && m_Computer->state != NvComputer::CS_OFFLINE) {
-                qInfo() << m_Computer->name << "is now offline";
-                m_Computer->state = NvComputer::CS_OFFLINE;
-                stateChanged = true;
-            }
-
-            // Grab the applist if it's empty or it's been long enough that we need to refresh
-            pollsSinceLastAppListFetch++;
-            if (m_Computer->state == NvComputer::CS_ONLINE &&
-                    m_Computer->pairState == NvComputer::PS_PAIRED &&
-                    (m_Computer->appList.isEmpty() || pollsSinceLastAppListFetch >= POLLS_PER_APPLIST_FETCH)) {
-                // Notify prior to the app list poll since it may take a while, and we don't
-                // want to delay onlining of a machine, especially if we already have a cached list.
-                if (stateChanged) {
-                    emit computerStateChanged(m_Computer);
-                    stateChanged = false;
-                }
-
-                if (updateAppList(stateChanged)) {
-                    pollsSinceLastAppListFetch = 0;
-                }
-            }
-
-            if (stateChanged) {
-                // Tell anyone listening that we've changed state
-                emit computerStateChanged(m_Computer);
-            }
-
-            // Wait a bit to poll again, but do it in 100 ms chunks
-            // so we can be interrupted reasonably quickly.
-            // FIXME: QWaitCondition would be better.
-            for (int i = 0; i < 30 && !isInterruptionRequested(); i++) {
-                QThread::msleep(100);
-            }
-        }
-    }
-
-signals:
-   void computerStateChanged(NvComputer* computer);
-
-private:
-    NvComputer* m_Computer;
-};
-
 ComputerManager::ComputerManager(StreamingPreferences* prefs)
     : m_Prefs(prefs),
       m_PollingRef(0),
+      m_PollScheduler(new ComputerPollScheduler(this)),
+      m_HostStore(Path::getHostStoreDir()),
+      m_AppListsPending(false),
       m_MdnsBrowser(nullptr),
       m_CompatFetcher(nullptr),
       m_NeedsDelayedFlush(false)
 {
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+
     QSettings settings;
 
     // If there's a hosts backup copy, we must have failed to commit
@@ -162,19 +43,67 @@ ComputerManager::ComputerManager(StreamingPreferences* prefs)
         hosts = settings.beginReadArray(SER_HOSTS);
     }
 
-    // Inflate our hosts from QSettings
-    for (int i = 0; i < hosts; i++) {
-        settings.setArrayIndex(i);
-        NvComputer* computer = new NvComputer(settings);
-        m_KnownHosts[computer->uuid] = computer;
-        m_LastSerializedHosts[computer->uuid] = *computer;
+    if (hosts != 0) {
+        // Migrate hosts from QSettings into the host store
+        bool migrated = true;
+        for (int i = 0; i < hosts; i++) {
+            settings.setArrayIndex(i);
+            NvComputer* computer = new NvComputer(settings);
+            m_KnownHosts[computer->uuid] = computer;
+            m_LastSerializedHosts[computer->uuid] = *computer;
+
+            migrated &= m_HostStore.saveHost(*computer);
+            if (!computer->appList.isEmpty()) {
+                migrated &= m_HostStore.saveAppList(computer->uuid, computer->appList);
+            }
+        }
+        settings.endArray();
+
+        // Keep the old host list around if we couldn't migrate it all
+        if (migrated) {
+            qInfo() << "Migrated" << hosts << "hosts to host store";
+            settings.remove(SER_HOSTS);
+            settings.remove(SER_HOSTS_BACKUP);
+        }
     }
-    settings.endArray();
+    else {
+        settings.endArray();
 
-    // Fetch latest compatibility data asynchronously
-    m_CompatFetcher.start();
+        // Only load the host records now. App lists aren't needed to show
+        // the PC view, so the flush thread loads them after we've started.
+        const QStringList uuids = m_HostStore.getHostUuids();
+        for (const QString& uuid : uuids) {
+            NvComputer* computer = m_HostStore.loadHost(uuid);
+            if (computer != nullptr) {
+                m_KnownHosts[computer->uuid] = computer;
+                m_LastSerializedHosts[computer->uuid] = *computer;
+            }
+        }
+
+        m_AppListsPending = true;
+    }
+
+    qInfo() << "Loaded" << m_KnownHosts.count() << "hosts in" << loadTimer.elapsed() << "ms";
+
+    // Build the sorted host list
+    for (NvComputer* computer : m_KnownHosts) {
+        m_SortedHosts.append({ computer->name.toLower(), computer });
+    }
+    std::sort(m_SortedHosts.begin(), m_SortedHosts.end(), isSortedBefore);
+
+    // Hosts are only polled while startPolling() is in effect
+    connect(m_PollScheduler, &ComputerPollScheduler::computerStateChanged,
+            this, &ComputerManager::handleComputerStateChanged);
+    for (NvComputer* computer : m_KnownHosts) {
+        m_PollScheduler->addComputer(computer);
+    }
+
+    // Fetch latest compatibility data asynchronously once the UI is up
+    StartupTracer::runWhenInteractive(this, [this] {
+        m_CompatFetcher.start();
+    });
 
-    // Start the delayed flush thread to handle saveHosts() calls
+    // Start the delayed flush thread to handle queueHostFlush() calls
     m_DelayedFlushThread = new DelayedFlushThread(this);
     m_DelayedFlushThread->start();
 
@@ -216,15 +145,9 @@ ComputerManager::~ComputerManager()
     delete m_MdnsBrowser;
     m_MdnsBrowser = nullptr;
 
-    // Interrupt polling
-    for (ComputerPollingEntry* entry : m_PollEntries) {
-        entry->interrupt();
-    }
-
-    // Delete all polling entries (and associated threads)
-    for (ComputerPollingEntry* entry : m_PollEntries) {
-        delete entry;
-    }
+    // Abort all polling requests
+    delete m_PollScheduler;
+    m_PollScheduler = nullptr;
 
     // Destroy all NvComputer objects now that polling is halted
     for (NvComputer* computer : m_KnownHosts) {
@@ -233,7 +156,13 @@ ComputerManager::~ComputerManager()
 }
 
 void DelayedFlushThread::run() {
+    if (m_ComputerManager->m_AppListsPending) {
+        loadAppLists();
+    }
+
     for (;;) {
+        QSet<QString> dirtyHosts;
+
         // Wait for a delayed flush request or an interruption
         {
             QMutexLocker locker(&m_ComputerManager->m_DelayedFlushMutex);
@@ -249,61 +178,153 @@ void DelayedFlushThread::run() {
                 break;
             }
 
-            // Reset the delayed flush flag to ensure any racing saveHosts() call will set it again
+            // Reset the delayed flush flag to ensure any racing queueHostFlush() call will set it again
             m_ComputerManager->m_NeedsDelayedFlush = false;
-
-            // Update the last serialized hosts map under the delayed flush mutex
-            m_ComputerManager->m_LastSerializedHosts.clear();
-            for (const NvComputer* computer : m_ComputerManager->m_KnownHosts) {
-                // Copy the current state of the NvComputer to allow us to check later if we need
-                // to serialize it again when attribute updates occur.
-                QReadLocker computerLock(&computer->lock);
-                m_ComputerManager->m_LastSerializedHosts[computer->uuid] = *computer;
-            }
+            dirtyHosts.swap(m_ComputerManager->m_DirtyHosts);
         }
 
         // Perform the flush
+        QElapsedTimer flushTimer;
+        flushTimer.start();
+
+        int recordsWritten = 0;
+        for (const QString& uuid : dirtyHosts) {
+            recordsWritten += flushHost(uuid);
+        }
+
+        if (recordsWritten > 0) {
+            qInfo() << "Wrote" << recordsWritten << "host store records for"
+                    << dirtyHosts.count() << "hosts in" << flushTimer.elapsed() << "ms";
+        }
+    }
+}
+
+void DelayedFlushThread::loadAppLists()
+{
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+
+    QStringList uuids;
+    {
+        QReadLocker lock(&m_ComputerManager->m_Lock);
+        uuids = m_ComputerManager->m_KnownHosts.keys();
+    }
+
+    for (const QString& uuid : uuids) {
+        QVector<NvApp> appList = m_ComputerManager->m_HostStore.loadAppList(uuid);
+        if (appList.isEmpty()) {
+            continue;
+        }
+
         {
-            QSettings settings;
+            QReadLocker lock(&m_ComputerManager->m_Lock);
+            NvComputer* computer = m_ComputerManager->m_KnownHosts.value(uuid);
+            if (computer == nullptr) {
+                // Deleted while we were loading
+                continue;
+            }
 
-            // First, write to the backup location
-            settings.beginWriteArray(SER_HOSTS_BACKUP);
-            {
-                QReadLocker lock(&m_ComputerManager->m_Lock);
-                int i = 0;
-                for (const NvComputer* computer : m_ComputerManager->m_KnownHosts) {
-                    settings.setArrayIndex(i++);
-                    computer->serialize(settings, false);
-                }
+            QWriteLocker computerLock(&computer->lock);
+            computer->mergeStoredAppList(appList);
+        }
+
+        // Record what's on disk, so saveHost() can tell if the host's list differs
+        {
+            QMutexLocker locker(&m_ComputerManager->m_DelayedFlushMutex);
+            auto it = m_ComputerManager->m_LastSerializedHosts.find(uuid);
+            if (it != m_ComputerManager->m_LastSerializedHosts.end()) {
+                it->appList = appList;
             }
-            settings.endArray();
+        }
+    }
 
-            // Next, write to the primary location
-            settings.remove(SER_HOSTS);
-            settings.beginWriteArray(SER_HOSTS);
-            {
-                QReadLocker lock(&m_ComputerManager->m_Lock);
-                int i = 0;
-                for (const NvComputer* computer : m_ComputerManager->m_KnownHosts) {
-                    settings.setArrayIndex(i++);
-                    computer->serialize(settings, true);
-                }
+    qInfo() << "Loaded app lists for" << uuids.count() << "hosts in" << loadTimer.elapsed() << "ms";
+
+    // Let the UI know the app lists are available
+    QMetaObject::invokeMethod(m_ComputerManager, "handleAppListsLoaded", Qt::QueuedConnection);
+}
+
+int DelayedFlushThread::flushHost(const QString& uuid)
+{
+    QHash<QString, NvComputer>& lastSerializedHosts = m_ComputerManager->m_LastSerializedHosts;
+
+    // Only this thread modifies m_LastSerializedHosts, so we can read it without the lock
+    auto lastIt = lastSerializedHosts.constFind(uuid);
+    bool wasSaved = lastIt != lastSerializedHosts.constEnd();
+
+    NvComputer snapshot;
+    bool exists = false;
+    bool hostChanged = false;
+    bool appsChanged = false;
+    {
+        QReadLocker lock(&m_ComputerManager->m_Lock);
+        NvComputer* computer = m_ComputerManager->m_KnownHosts.value(uuid);
+        if (computer != nullptr) {
+            QReadLocker computerLock(&computer->lock);
+
+            exists = true;
+            hostChanged = !wasSaved || !lastIt->isEqualSerialized(*computer, false);
+
+            // Avoid deleting an existing applist if we couldn't get one
+            appsChanged = !computer->appList.isEmpty() && (!wasSaved || lastIt->appList != computer->appList);
+
+            // Only copy hosts that we actually need to write
+            if (hostChanged || appsChanged) {
+                snapshot = *computer;
             }
-            settings.endArray();
+        }
+    }
 
-            // Finally, delete the backup copy
-            settings.remove(SER_HOSTS_BACKUP);
+    if (!exists) {
+        if (wasSaved) {
+            m_ComputerManager->m_HostStore.deleteHost(uuid);
+
+            QMutexLocker locker(&m_ComputerManager->m_DelayedFlushMutex);
+            lastSerializedHosts.remove(uuid);
         }
+        return 0;
     }
+
+    int recordsWritten = 0;
+    if (hostChanged) {
+        if (!m_ComputerManager->m_HostStore.saveHost(snapshot)) {
+            // We'll try again on the next update to this host
+            return recordsWritten;
+        }
+        recordsWritten++;
+    }
+    if (appsChanged) {
+        if (m_ComputerManager->m_HostStore.saveAppList(uuid, snapshot.appList)) {
+            recordsWritten++;
+        }
+        else {
+            appsChanged = false;
+        }
+    }
+
+    if (recordsWritten > 0) {
+        QMutexLocker locker(&m_ComputerManager->m_DelayedFlushMutex);
+
+        // Keep the stored app list if we didn't write a new one
+        QVector<NvApp> storedAppList = wasSaved ? lastIt->appList : QVector<NvApp>();
+        NvComputer& lastSerialized = lastSerializedHosts[uuid];
+        lastSerialized = snapshot;
+        if (!appsChanged) {
+            lastSerialized.appList = storedAppList;
+        }
+    }
+
+    return recordsWritten;
 }
 
-void ComputerManager::saveHosts()
+void ComputerManager::queueHostFlush(const QString& uuid)
 {
     Q_ASSERT(m_DelayedFlushThread != nullptr && m_DelayedFlushThread->isRunning());
 
-    // Punt to a worker thread because QSettings on macOS can take ages (> 500 ms)
-    // to persist our host list to disk (especially when a host has a bunch of apps).
+    // Punt to a worker thread because disk I/O can take ages on some systems,
+    // especially when a host has a bunch of apps.
     QMutexLocker locker(&m_DelayedFlushMutex);
+    m_DirtyHosts.insert(uuid);
     m_NeedsDelayedFlush = true;
     m_DelayedFlushCondition.wakeOne();
 }
@@ -370,37 +391,14 @@ void ComputerManager::startPolling()
         qWarning() << "mDNS is disabled by user preference";
     }
 
-    // Start polling threads for each known host
-    QMapIterator<QString, NvComputer*> i(m_KnownHosts);
-    while (i.hasNext()) {
-        i.next();
-        startPollingComputer(i.value());
-    }
+    // Poll all known hosts now and periodically afterwards
+    m_PollScheduler->start();
 }
 
-// Must hold m_Lock for write
 void ComputerManager::startPollingComputer(NvComputer* computer)
 {
-    if (m_PollingRef == 0) {
-        return;
-    }
-
-    ComputerPollingEntry* pollingEntry;
-
-    if (!m_PollEntries.contains(computer->uuid)) {
-        pollingEntry = m_PollEntries[computer->uuid] = new ComputerPollingEntry();
-    }
-    else {
-        pollingEntry = m_PollEntries[computer->uuid];
-    }
-
-    if (!pollingEntry->isActive()) {
-        PcMonitorThread* thread = new PcMonitorThread(computer);
-        connect(thread, &PcMonitorThread::computerStateChanged,
-                this, &ComputerManager::handleComputerStateChanged);
-        pollingEntry->setActiveThread(thread);
-        thread->start();
-    }
+    // The scheduler will start polling this host if polling is active
+    m_PollScheduler->addComputer(computer);
 }
 
 void ComputerManager::handleMdnsServiceResolved(MdnsPendingComputer* computer,
@@ -443,20 +441,38 @@ void ComputerManager::handleMdnsServiceResolved(MdnsPendingComputer* computer,
 
 void ComputerManager::saveHost(NvComputer *computer)
 {
-    // If no serializable properties changed, don't bother saving hosts
+    // If no serializable properties changed, don't bother saving this host
     QMutexLocker lock(&m_DelayedFlushMutex);
     QReadLocker computerLock(&computer->lock);
-    if (!m_LastSerializedHosts.value(computer->uuid).isEqualSerialized(*computer)) {
-        // Queue a request for a delayed flush to QSettings outside of the lock
+    auto lastIt = m_LastSerializedHosts.constFind(computer->uuid);
+    if (lastIt == m_LastSerializedHosts.constEnd() ||
+            !lastIt->isEqualSerialized(*computer, false) ||
+            (!computer->appList.isEmpty() && lastIt->appList != computer->appList)) {
+        // Queue a request for a delayed flush to the host store outside of the lock
+        QString uuid = computer->uuid;
         computerLock.unlock();
         lock.unlock();
-        saveHosts();
+        queueHostFlush(uuid);
+    }
+}
+
+void ComputerManager::handleAppListsLoaded()
+{
+    // Hosts are only removed on this thread, so these stay valid after we unlock
+    QList<NvComputer*> computers;
+    {
+        QReadLocker lock(&m_Lock);
+        computers = m_KnownHosts.values();
+    }
+
+    for (NvComputer* computer : computers) {
+        emit computerStateChanged(computer);
     }
 }
 
 void ComputerManager::handleComputerStateChanged(NvComputer* computer)
 {
-    emit computerStateChanged(computer);
+    updateSortedHost(computer);
 
     if (computer->pendingQuit && computer->currentGameId == 0) {
         computer->pendingQuit = false;
@@ -471,46 +487,91 @@ QVector<NvComputer*> ComputerManager::getComputers()
 {
     QReadLocker lock(&m_Lock);
 
-    // Return a sorted host list
-    auto hosts = QVector<NvComputer*>::fromList(m_KnownHosts.values());
-    std::stable_sort(hosts.begin(), hosts.end(), [](const NvComputer* host1, const NvComputer* host2) {
-        return host1->name.toLower() < host2->name.toLower();
-    });
+    QVector<NvComputer*> hosts;
+    hosts.reserve(m_SortedHosts.count());
+    for (const SortedHost& sortedHost : m_SortedHosts) {
+        hosts.append(sortedHost.computer);
+    }
     return hosts;
 }
 
-class DeferredHostDeletionTask : public QRunnable
+bool ComputerManager::isSortedBefore(const SortedHost& host1, const SortedHost& host2)
 {
-public:
-    DeferredHostDeletionTask(ComputerManager* cm, NvComputer* computer)
-        : m_Computer(computer),
-          m_ComputerManager(cm) {}
+    // Break ties by UUID to keep the order stable
+    if (host1.sortKey != host2.sortKey) {
+        return host1.sortKey < host2.sortKey;
+    }
+    return host1.computer->uuid < host2.computer->uuid;
+}
 
-    void run()
+void ComputerManager::updateSortedHost(NvComputer* computer)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    SortedHost sortedHost;
+    sortedHost.computer = computer;
     {
-        ComputerPollingEntry* pollingEntry;
+        QReadLocker lock(&computer->lock);
+        sortedHost.sortKey = computer->name.toLower();
+    }
 
-        // Only do the minimum amount of work while holding the writer lock.
-        // We must release it before calling saveHosts().
-        {
-            QWriteLocker lock(&m_ComputerManager->m_Lock);
+    int from = -1;
+    int to;
+    {
+        QWriteLocker lock(&m_Lock);
 
-            pollingEntry = m_ComputerManager->m_PollEntries.take(m_Computer->uuid);
+        // A host may have been deleted while a state change was queued
+        if (m_KnownHosts.value(computer->uuid) != computer) {
+            return;
+        }
 
-            m_ComputerManager->m_KnownHosts.remove(m_Computer->uuid);
+        for (int i = 0; i < m_SortedHosts.count(); i++) {
+            if (m_SortedHosts[i].computer == computer) {
+                from = i;
+                break;
+            }
         }
 
-        // Persist the new host list with this computer deleted
-        m_ComputerManager->saveHosts();
+        if (from >= 0 && m_SortedHosts[from].sortKey == sortedHost.sortKey) {
+            // It's not moving
+            to = from;
+        }
+        else {
+            if (from >= 0) {
+                m_SortedHosts.remove(from);
+            }
+
+            to = std::lower_bound(m_SortedHosts.begin(), m_SortedHosts.end(), sortedHost, isSortedBefore) - m_SortedHosts.begin();
+            m_SortedHosts.insert(to, sortedHost);
+        }
+    }
+
+    if (from < 0) {
+        emit computerAdded(computer, to);
+    }
+    else if (from != to) {
+        emit computerMoved(computer, from, to);
+    }
+
+    emit computerStateChanged(computer);
+}
+
+class DeferredHostDeletionTask : public QRunnable
+{
+public:
+    DeferredHostDeletionTask(ComputerManager* cm, NvComputer* computer)
+        : m_Computer(computer),
+          m_ComputerManager(cm) {}
 
-        // Delete the polling entry first. This will stop all polling threads too.
-        delete pollingEntry;
+    void run()
+    {
+        // Delete this computer from the host store
+        m_ComputerManager->queueHostFlush(m_Computer->uuid);
 
         // Delete cached box art
         BoxArtManager::deleteBoxArt(m_Computer);
 
-        // Finally, delete the computer itself. This must be done
-        // last because the polling thread might be using it.
+        // Finally, delete the computer itself
         delete m_Computer;
     }
 
@@ -521,8 +582,31 @@ private:
 
 void ComputerManager::deleteHost(NvComputer* computer)
 {
+    // Stop polling synchronously so no requests reference this host
+    m_PollScheduler->removeComputer(computer);
+
+    // Remove the host synchronously too, so hosts in m_KnownHosts
+    // are never deleted out from under the main thread.
+    int index = -1;
+    {
+        QWriteLocker lock(&m_Lock);
+        m_KnownHosts.remove(computer->uuid);
+
+        for (int i = 0; i < m_SortedHosts.count(); i++) {
+            if (m_SortedHosts[i].computer == computer) {
+                index = i;
+                m_SortedHosts.remove(i);
+                break;
+            }
+        }
+    }
+
+    if (index >= 0) {
+        emit computerRemoved(computer, index);
+    }
+
     // Punt to a worker thread to avoid stalling the
-    // UI while waiting for the polling thread to die
+    // UI while persisting the host list and deleting box art
     QThreadPool::globalInstance()->start(new DeferredHostDeletionTask(this, computer));
 }
 
@@ -547,13 +631,9 @@ void ComputerManager::clientSideAttributeUpdated(NvComputer* computer)
 
 void ComputerManager::handleAboutToQuit()
 {
-    QReadLocker lock(&m_Lock);
-
-    // Interrupt polling threads immediately, so they
-    // avoid making additional requests while quitting
-    for (ComputerPollingEntry* entry : m_PollEntries) {
-        entry->interrupt();
-    }
+    // Abort polling immediately, so we avoid
+    // making additional requests while quitting
+    m_PollScheduler->stop();
 }
 
 class PendingPairingTask : public QObject, public QRunnable
@@ -702,10 +782,8 @@ void ComputerManager::stopPollingAsync()
     m_MdnsBrowser = nullptr;
     m_MdnsServer.reset();
 
-    // Interrupt all threads, but don't wait for them to terminate
-    for (ComputerPollingEntry* entry : m_PollEntries) {
-        entry->interrupt();
-    }
+    // Abort any polls in progress
+    m_PollScheduler->stop();
 }
 
 void ComputerManager::addNewHostManually(QString address)
@@ -751,7 +829,7 @@ private:
         m_AboutToQuit = true;
     }
 
-    QString fetchServerInfo(NvHTTP& http)
+    QString fetchServerInfo(NvHTTP& http, bool fastFail = false)
     {
         QString serverInfo;
 
@@ -766,7 +844,7 @@ private:
             // around this issue, we will issue the request again after a few seconds if
             // we see a ServiceUnavailableError error.
             try {
-                serverInfo = http.getServerInfo(NvHTTP::NVLL_VERBOSE);
+                serverInfo = http.getServerInfo(NvHTTP::NVLL_VERBOSE, fastFail);
             } catch (const QtNetworkReplyException& e) {
                 if (e.getError() == QNetworkReply::ServiceUnavailableError) {
                     qWarning() << "Retrying request in 5 seconds after ServiceUnavailableError";
@@ -806,8 +884,9 @@ private:
 
         qInfo() << "Processing new PC at" << m_Address.toString() << "from" << (m_Mdns ? "mDNS" : "user") << "with IPv6 address" << m_MdnsIpv6Address.toString();
 
-        // Perform initial serverinfo fetch over HTTP since we don't know which cert to use
-        QString serverInfo = fetchServerInfo(http);
+        // Perform initial serverinfo fetch over HTTP since we don't know which cert to use.
+        // If we have another address to try, don't wait the full timeout on this one.
+        QString serverInfo = fetchServerInfo(http, !m_MdnsIpv6Address.isNull());
         if (serverInfo.isEmpty() && !m_MdnsIpv6Address.isNull()) {
             // Retry using the global IPv6 address if the IPv4 or link-local IPv6 address fails
             http.setAddress(m_MdnsIpv6Address);
@@ -906,6 +985,9 @@ private:
                 // Drop the lock before notifying
                 m_ComputerManager->m_Lock.unlock();
 
+                // Refresh this host right away rather than waiting out any offline backoff
+                m_ComputerManager->m_PollScheduler->pollNow(existingComputer);
+
                 // For non-mDNS clients, let them know it succeeded
                 if (!m_Mdns) {
                     emit computerAddCompleted(true, false);
@@ -921,7 +1003,7 @@ private:
                 // Store this in our active sets
                 m_ComputerManager->m_KnownHosts[newComputer->uuid] = newComputer;
 
-                // Start polling if enabled (write lock required)
+                // Start polling if enabled
                 m_ComputerManager->startPollingComputer(newComputer);
 
                 // Drop the lock before notifying
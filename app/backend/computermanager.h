@@ -1,6 +1,8 @@
 #pragma once
 
 #include "nvcomputer.h"
+#include "computerpollscheduler.h"
+#include "hoststore.h"
 #include "settings/streamingpreferences.h"
 #include "settings/compatfetcher.h"
 
@@ -17,6 +19,7 @@
 #include <QTimer>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QSet>
 
 class ComputerManager;
 
@@ -34,6 +37,11 @@ public:
     void run();
 
 private:
+    void loadAppLists();
+
+    // Returns the number of records written
+    int flushHost(const QString& uuid);
+
     ComputerManager* m_ComputerManager;
 };
 
@@ -135,79 +143,6 @@ private:
     int m_Retries = 10;
 };
 
-class ComputerPollingEntry
-{
-public:
-    ComputerPollingEntry()
-        : m_ActiveThread(nullptr)
-    {
-
-    }
-
-    virtual ~ComputerPollingEntry()
-    {
-        interrupt();
-
-        // interrupt() should have taken care of this
-        Q_ASSERT(m_ActiveThread == nullptr);
-
-        for (QThread* thread : m_InactiveList) {
-            thread->wait();
-            delete thread;
-        }
-    }
-
-    bool isActive()
-    {
-        cleanInactiveList();
-
-        return m_ActiveThread != nullptr;
-    }
-
-    void setActiveThread(QThread* thread)
-    {
-        cleanInactiveList();
-
-        Q_ASSERT(!isActive());
-        m_ActiveThread = thread;
-    }
-
-    void interrupt()
-    {
-        cleanInactiveList();
-
-        if (m_ActiveThread != nullptr) {
-            // Interrupt the active thread
-            m_ActiveThread->requestInterruption();
-
-            // Place it on the inactive list awaiting death
-            m_InactiveList.append(m_ActiveThread);
-
-            m_ActiveThread = nullptr;
-        }
-    }
-
-private:
-    void cleanInactiveList()
-    {
-        QMutableListIterator<QThread*> i(m_InactiveList);
-
-        // Reap any threads that have finished
-        while (i.hasNext()) {
-            i.next();
-
-            QThread* thread = i.value();
-            if (thread->isFinished()) {
-                delete thread;
-                i.remove();
-            }
-        }
-    }
-
-    QThread* m_ActiveThread;
-    QList<QThread*> m_InactiveList;
-};
-
 class ComputerManager : public QObject
 {
     Q_OBJECT
@@ -248,6 +183,13 @@ public:
 signals:
     void computerStateChanged(NvComputer* computer);
 
+    // These track changes to the sorted list returned by getComputers()
+    void computerAdded(NvComputer* computer, int index);
+
+    void computerRemoved(NvComputer* computer, int index);
+
+    void computerMoved(NvComputer* computer, int from, int to);
+
     void pairingCompleted(NvComputer* computer, QString error);
 
     void computerAddCompleted(QVariant success, QVariant detectedPortBlocking);
@@ -259,10 +201,23 @@ private slots:
 
     void handleComputerStateChanged(NvComputer* computer);
 
+    void handleAppListsLoaded();
+
     void handleMdnsServiceResolved(MdnsPendingComputer* computer, QVector<QHostAddress>& addresses);
 
 private:
-    void saveHosts();
+    struct SortedHost
+    {
+        QString sortKey;
+        NvComputer* computer;
+    };
+
+    static bool isSortedBefore(const SortedHost& host1, const SortedHost& host2);
+
+    // Moves or adds the host in the sorted host list and notifies listeners
+    void updateSortedHost(NvComputer* computer);
+
+    void queueHostFlush(const QString& uuid);
 
     void saveHost(NvComputer* computer);
 
@@ -274,8 +229,12 @@ private:
     int m_PollingRef;
     QReadWriteLock m_Lock;
     QMap<QString, NvComputer*> m_KnownHosts;
-    QMap<QString, ComputerPollingEntry*> m_PollEntries;
-    QHash<QString, NvComputer> m_LastSerializedHosts; // Protected by m_DelayedFlushMutex
+    QVector<SortedHost> m_SortedHosts; // Protected by m_Lock, only modified on the main thread
+    ComputerPollScheduler* m_PollScheduler;
+    HostStore m_HostStore;
+    QHash<QString, NvComputer> m_LastSerializedHosts; // Written under m_DelayedFlushMutex by the flush thread only
+    QSet<QString> m_DirtyHosts; // Protected by m_DelayedFlushMutex
+    bool m_AppListsPending;
     QSharedPointer<QMdnsEngine::Server> m_MdnsServer;
     QMdnsEngine::Browser* m_MdnsBrowser;
     QVector<MdnsPendingComputer*> m_PendingResolution;
@@ -0,0 +1,568 @@
+#include "computerpollscheduler.h"
+
+#include <QDebug>
+#include <QNetworkProxy>
+#include <QThread>
+
+#include <algorithm>
+
+#define TRIES_BEFORE_OFFLINING 2
+#define POLLS_PER_APPLIST_FETCH 10
+
+// Maximum number of hosts being polled at once
+#define MAX_CONCURRENT_POLLS 8
+
+// Online hosts are polled every POLL_INTERVAL_MS +/- POLL_JITTER_PERCENT
+#define POLL_INTERVAL_MS 3000
+#define POLL_JITTER_PERCENT 10
+
+// Offline hosts double their interval each time up to this limit
+#define MAX_OFFLINE_POLL_INTERVAL_MS 30000
+
+#define SERVERINFO_TIMEOUT_MS 2000
+
+// Head start given to each address before we also try the next one
+#define ADDRESS_RACE_DELAY_MS 250
+#define APPLIST_TIMEOUT_MS 5000
+
+ComputerPollScheduler::ComputerPollScheduler(QObject* parent)
+    : QObject(parent),
+      m_Random(std::random_device()()),
+      m_ActivePolls(0),
+      m_Running(false)
+{
+    // Never use a proxy server
+    m_Nam.setProxy(QNetworkProxy(QNetworkProxy::NoProxy));
+
+    m_Timer.setSingleShot(true);
+    m_Timer.setTimerType(Qt::CoarseTimer);
+    connect(&m_Timer, &QTimer::timeout, this, &ComputerPollScheduler::startDuePolls);
+
+    m_Clock.start();
+}
+
+ComputerPollScheduler::~ComputerPollScheduler()
+{
+    stop();
+    qDeleteAll(m_Entries);
+}
+
+void ComputerPollScheduler::addComputer(NvComputer* computer)
+{
+    {
+        QMutexLocker lock(&m_PendingLock);
+        m_PendingAdds.append(computer);
+    }
+
+    // We may be called from a worker thread, so process this on our own thread
+    QMetaObject::invokeMethod(this, "processPendingRequests", Qt::QueuedConnection);
+}
+
+void ComputerPollScheduler::pollNow(NvComputer* computer)
+{
+    {
+        QMutexLocker lock(&m_PendingLock);
+        m_PendingPolls.append(computer);
+    }
+
+    QMetaObject::invokeMethod(this, "processPendingRequests", Qt::QueuedConnection);
+}
+
+void ComputerPollScheduler::processPendingRequests()
+{
+    QVector<NvComputer*> adds;
+    QVector<NvComputer*> polls;
+
+    {
+        QMutexLocker lock(&m_PendingLock);
+        adds.swap(m_PendingAdds);
+        polls.swap(m_PendingPolls);
+    }
+
+    for (NvComputer* computer : adds) {
+        if (!m_Entries.contains(computer)) {
+            HostEntry* entry = new HostEntry();
+            entry->computer = computer;
+            entry->nextPollTime = m_Clock.elapsed();
+            entry->failures = 0;
+
+            // Always fetch the applist the first time
+            entry->pollsSinceLastAppListFetch = POLLS_PER_APPLIST_FETCH;
+
+            entry->polling = false;
+            entry->reply = nullptr;
+
+            entry->raceTimer.setSingleShot(true);
+            connect(&entry->raceTimer, &QTimer::timeout, this, [this, entry]() {
+                raceNextAddress(entry);
+            });
+
+            m_Entries.insert(computer, entry);
+        }
+    }
+
+    for (NvComputer* computer : polls) {
+        HostEntry* entry = m_Entries.value(computer);
+        if (entry != nullptr && !entry->polling) {
+            entry->failures = 0;
+            entry->nextPollTime = m_Clock.elapsed();
+        }
+    }
+
+    startDuePolls();
+}
+
+void ComputerPollScheduler::start()
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    m_Running = true;
+
+    // Refresh everything now that someone is looking
+    qint64 now = m_Clock.elapsed();
+    for (HostEntry* entry : m_Entries) {
+        if (!entry->polling) {
+            entry->nextPollTime = now;
+        }
+    }
+
+    startDuePolls();
+}
+
+void ComputerPollScheduler::stop()
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    m_Running = false;
+    m_Timer.stop();
+
+    for (HostEntry* entry : m_Entries) {
+        cancelRequest(entry);
+        entry->polling = false;
+    }
+
+    m_ActivePolls = 0;
+}
+
+void ComputerPollScheduler::removeComputer(NvComputer* computer)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    {
+        QMutexLocker lock(&m_PendingLock);
+        m_PendingAdds.removeAll(computer);
+        m_PendingPolls.removeAll(computer);
+    }
+
+    HostEntry* entry = m_Entries.take(computer);
+    if (entry == nullptr) {
+        return;
+    }
+
+    cancelRequest(entry);
+    if (entry->polling) {
+        m_ActivePolls--;
+    }
+    delete entry;
+
+    // Let another host have this poll slot
+    startDuePolls();
+}
+
+void ComputerPollScheduler::startDuePolls()
+{
+    if (!m_Running) {
+        return;
+    }
+
+    qint64 now = m_Clock.elapsed();
+
+    QVector<HostEntry*> idleEntries;
+    for (HostEntry* entry : m_Entries) {
+        if (!entry->polling) {
+            idleEntries.append(entry);
+        }
+    }
+
+    // Start with the most overdue hosts
+    std::sort(idleEntries.begin(), idleEntries.end(), [](const HostEntry* a, const HostEntry* b) {
+        return a->nextPollTime < b->nextPollTime;
+    });
+
+    int i = 0;
+    for (; i < idleEntries.size() && m_ActivePolls < MAX_CONCURRENT_POLLS; i++) {
+        if (idleEntries[i]->nextPollTime > now) {
+            break;
+        }
+
+        // A host without addresses finishes its poll right away, which
+        // starts the next due polls before we get to them here.
+        if (idleEntries[i]->polling) {
+            continue;
+        }
+
+        startPoll(idleEntries[i]);
+    }
+
+    // Sleep until the next host is due. If all poll slots are busy,
+    // we'll be called again when one of them finishes.
+    if (i < idleEntries.size() && m_ActivePolls < MAX_CONCURRENT_POLLS) {
+        m_Timer.start((int)qMax(idleEntries[i]->nextPollTime - now, (qint64)0));
+    }
+    else {
+        m_Timer.stop();
+    }
+}
+
+void ComputerPollScheduler::startPoll(HostEntry* entry)
+{
+    Q_ASSERT(!entry->polling);
+    Q_ASSERT(entry->reply == nullptr);
+
+    entry->polling = true;
+    m_ActivePolls++;
+
+    {
+        QReadLocker lock(&entry->computer->lock);
+        entry->wasOnline = entry->computer->state == NvComputer::CS_ONLINE;
+        entry->serverCert = entry->computer->serverCert;
+
+        // GFE misbehaves when connections are reused, but other hosts are
+        // happy to keep them open between polls.
+        entry->keepAlive = !entry->computer->isNvidiaServerSoftware;
+    }
+
+    entry->addresses = entry->computer->uniqueAddresses();
+    entry->addressIndex = 0;
+    entry->triesLeft = entry->wasOnline ? TRIES_BEFORE_OFFLINING : 1;
+    entry->stateChanged = false;
+    entry->httpServerInfo.clear();
+
+    // The active address comes first, so the last winner gets a head start
+    raceNextAddress(entry);
+}
+
+void ComputerPollScheduler::raceNextAddress(HostEntry* entry)
+{
+    if (entry->addresses.isEmpty()) {
+        // There's nothing we can try
+        finishServerInfo(entry, false);
+        return;
+    }
+
+    if (entry->addressIndex >= entry->addresses.size()) {
+        if (!entry->raceReplies.isEmpty()) {
+            // Wait for the requests still in flight
+            return;
+        }
+
+        if (--entry->triesLeft <= 0) {
+            // We failed after all retry attempts
+            finishServerInfo(entry, false);
+            return;
+        }
+
+        entry->addressIndex = 0;
+    }
+
+    NvAddress address = entry->addresses[entry->addressIndex++];
+
+    QUrl baseUrl;
+    baseUrl.setScheme("http");
+    baseUrl.setHost(address.address());
+    baseUrl.setPort(address.port());
+
+    QNetworkReply* reply = m_Nam.get(createRequest(entry, baseUrl, "serverinfo"));
+    entry->raceReplies.append(reply);
+
+    connect(reply, &QNetworkReply::finished, this, [this, entry, reply, address]() {
+        entry->raceReplies.removeOne(reply);
+        reply->deleteLater();
+
+        handleHttpServerInfo(entry, address, reply);
+    });
+
+    // The timer is cancelled if the reply is destroyed first
+    QTimer::singleShot(SERVERINFO_TIMEOUT_MS, reply, [reply]() {
+        reply->abort();
+    });
+
+    // Try the next address too if this one doesn't answer quickly
+    if (entry->addressIndex < entry->addresses.size()) {
+        entry->raceTimer.start(ADDRESS_RACE_DELAY_MS);
+    }
+}
+
+void ComputerPollScheduler::cancelAddressRace(HostEntry* entry)
+{
+    entry->raceTimer.stop();
+
+    for (QNetworkReply* reply : entry->raceReplies) {
+        // Disconnect first so aborting doesn't run our finished handler
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+    entry->raceReplies.clear();
+}
+
+QNetworkRequest ComputerPollScheduler::createRequest(HostEntry* entry, QUrl baseUrl, QString command)
+{
+    return NvHTTP::createRequest(baseUrl, command, nullptr, entry->keepAlive);
+}
+
+void ComputerPollScheduler::sendRequest(HostEntry* entry, QUrl baseUrl, QString command, int timeoutMs, ReplyHandler handler)
+{
+    QNetworkReply* reply = m_Nam.get(createRequest(entry, baseUrl, command));
+    NvHTTP::watchTlsHandshake(reply);
+    entry->reply = reply;
+
+    QSslCertificate serverCert = entry->serverCert;
+    connect(reply, &QNetworkReply::sslErrors, this, [reply, serverCert](const QList<QSslError>& errors) {
+        NvHTTP::ignorePinnedCertSslErrors(reply, errors, serverCert);
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, entry, reply, handler]() {
+        Q_ASSERT(entry->reply == reply);
+        entry->reply = nullptr;
+        reply->deleteLater();
+
+        NvHTTP::saveTlsSession(reply);
+
+        (this->*handler)(entry, reply);
+    });
+
+    // The timer is cancelled if the reply is destroyed first
+    QTimer::singleShot(timeoutMs, reply, [reply]() {
+        reply->abort();
+    });
+}
+
+void ComputerPollScheduler::cancelRequest(HostEntry* entry)
+{
+    cancelAddressRace(entry);
+
+    if (entry->reply != nullptr) {
+        QNetworkReply* reply = entry->reply;
+        entry->reply = nullptr;
+
+        // Disconnect first so aborting doesn't run our finished handler
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+QString ComputerPollScheduler::readReply(QNetworkReply* reply)
+{
+    if (reply->error() != QNetworkReply::NoError) {
+        return QString();
+    }
+
+    return QString::fromUtf8(reply->readAll());
+}
+
+void ComputerPollScheduler::handleHttpServerInfo(HostEntry* entry, NvAddress address, QNetworkReply* reply)
+{
+    QString serverInfo = readReply(reply);
+
+    try {
+        // Throws if the request failed
+        NvHTTP::verifyResponseStatus(serverInfo);
+    } catch (...) {
+        // Move on to the next address without waiting out the head start
+        entry->raceTimer.stop();
+        raceNextAddress(entry);
+        return;
+    }
+
+    // Ensure the machine that responded is the one we intended to contact
+    QString uuid = NvHTTP::getXmlString(serverInfo, "uniqueid");
+    if (entry->computer->uuid != uuid) {
+        qInfo() << "Found unexpected PC" << NvHTTP::getXmlString(serverInfo, "hostname")
+                << "looking for" << entry->computer->name;
+        entry->raceTimer.stop();
+        raceNextAddress(entry);
+        return;
+    }
+
+    // The first valid response wins the race
+    cancelAddressRace(entry);
+    entry->address = address;
+
+    if (entry->serverCert.isNull()) {
+        // Only use HTTP prior to pairing
+        handleServerInfo(entry, serverInfo);
+        return;
+    }
+
+    if (!IdentityManager::get()->hasCredentials()) {
+        // Our credentials are still being generated, so no host can have
+        // paired with them yet. Don't block this thread waiting for them
+        // just to have the host reject us.
+        handleServerInfo(entry, serverInfo);
+        return;
+    }
+
+    // Always try HTTPS when we have a pinned cert, since it properly
+    // reports pairing status (and a few other attributes).
+    uint16_t httpsPort = NvHTTP::getXmlString(serverInfo, "HttpsPort").toUShort();
+    if (httpsPort == 0) {
+        httpsPort = DEFAULT_HTTPS_PORT;
+    }
+
+    QUrl baseUrl;
+    baseUrl.setScheme("https");
+    baseUrl.setHost(entry->address.address());
+    baseUrl.setPort(httpsPort);
+
+    entry->httpServerInfo = serverInfo;
+    sendRequest(entry, baseUrl, "serverinfo", SERVERINFO_TIMEOUT_MS, &ComputerPollScheduler::handleHttpsServerInfo);
+}
+
+void ComputerPollScheduler::handleHttpsServerInfo(HostEntry* entry, QNetworkReply* reply)
+{
+    if (reply->error() == QNetworkReply::SslHandshakeFailedError) {
+        // Certificate mismatch, so fall back to the HTTP serverinfo
+        NvHTTP::clearTlsSession(reply->url());
+        handleServerInfo(entry, entry->httpServerInfo);
+        return;
+    }
+
+    QString serverInfo = readReply(reply);
+
+    try {
+        NvHTTP::verifyResponseStatus(serverInfo);
+    } catch (const GfeHttpResponseException& e) {
+        if (e.getStatusCode() == 401) {
+            // Certificate validation error, fall back to the HTTP serverinfo
+            handleServerInfo(entry, entry->httpServerInfo);
+        }
+        else {
+            raceNextAddress(entry);
+        }
+        return;
+    }
+
+    handleServerInfo(entry, serverInfo);
+}
+
+void ComputerPollScheduler::handleServerInfo(HostEntry* entry, QString serverInfo)
+{
+    NvComputer newState(entry->address, entry->serverCert, serverInfo);
+
+    // Ensure the machine that responded is the one we intended to contact
+    if (entry->computer->uuid != newState.uuid) {
+        qInfo() << "Found unexpected PC" << newState.name << "looking for" << entry->computer->name;
+        raceNextAddress(entry);
+        return;
+    }
+
+    entry->stateChanged = entry->computer->update(newState);
+    if (!entry->wasOnline) {
+        qInfo() << entry->computer->name << "is now online at" << entry->computer->activeAddress.toString();
+    }
+
+    finishServerInfo(entry, true);
+}
+
+void ComputerPollScheduler::finishServerInfo(HostEntry* entry, bool online)
+{
+    NvComputer* computer = entry->computer;
+    bool fetchAppList;
+
+    if (online) {
+        entry->failures = 0;
+    }
+    else {
+        entry->failures++;
+
+        QWriteLocker lock(&computer->lock);
+        if (computer->state != NvComputer::CS_OFFLINE) {
+            qInfo() << computer->name << "is now offline";
+            computer->state = NvComputer::CS_OFFLINE;
+            entry->stateChanged = true;
+        }
+    }
+
+    // Grab the applist if it's empty or it's been long enough that we need to refresh
+    entry->pollsSinceLastAppListFetch++;
+
+    QUrl baseUrl;
+    {
+        QReadLocker lock(&computer->lock);
+        fetchAppList = computer->state == NvComputer::CS_ONLINE &&
+                computer->pairState == NvComputer::PS_PAIRED &&
+                IdentityManager::get()->hasCredentials() &&
+                (computer->appList.isEmpty() || entry->pollsSinceLastAppListFetch >= POLLS_PER_APPLIST_FETCH);
+        if (fetchAppList) {
+            baseUrl.setScheme("https");
+            baseUrl.setHost(computer->activeAddress.address());
+            baseUrl.setPort(computer->activeHttpsPort);
+        }
+    }
+
+    if (fetchAppList) {
+        // Notify prior to the app list poll since it may take a while, and we don't
+        // want to delay onlining of a machine, especially if we already have a cached list.
+        if (entry->stateChanged) {
+            emit computerStateChanged(computer);
+            entry->stateChanged = false;
+        }
+
+        sendRequest(entry, baseUrl, "applist", APPLIST_TIMEOUT_MS, &ComputerPollScheduler::handleAppList);
+        return;
+    }
+
+    finishPoll(entry);
+}
+
+void ComputerPollScheduler::handleAppList(HostEntry* entry, QNetworkReply* reply)
+{
+    QString appxml = readReply(reply);
+    QVector<NvApp> appList;
+
+    try {
+        NvHTTP::verifyResponseStatus(appxml);
+        appList = NvHTTP::parseAppList(appxml);
+    } catch (...) {
+        // Keep the cached app list
+    }
+
+    if (!appList.isEmpty()) {
+        QWriteLocker lock(&entry->computer->lock);
+        entry->stateChanged = entry->computer->updateAppList(appList);
+        entry->pollsSinceLastAppListFetch = 0;
+    }
+
+    finishPoll(entry);
+}
+
+void ComputerPollScheduler::finishPoll(HostEntry* entry)
+{
+    if (entry->stateChanged) {
+        // Tell anyone listening that we've changed state
+        emit computerStateChanged(entry->computer);
+        entry->stateChanged = false;
+    }
+
+    entry->polling = false;
+    entry->nextPollTime = m_Clock.elapsed() + getPollInterval(entry);
+    m_ActivePolls--;
+
+    startDuePolls();
+}
+
+int ComputerPollScheduler::getPollInterval(HostEntry* entry)
+{
+    int interval = POLL_INTERVAL_MS;
+
+    // Back off exponentially while the host stays offline
+    if (entry->failures > 0) {
+        interval = qMin(POLL_INTERVAL_MS << qMin(entry->failures - 1, 4), MAX_OFFLINE_POLL_INTERVAL_MS);
+    }
+
+    // Jitter the interval so hosts don't stay in lockstep
+    int jitter = interval * POLL_JITTER_PERCENT / 100;
+    std::uniform_int_distribution<int> dist(-jitter, jitter);
+    return interval + dist(m_Random);
+}
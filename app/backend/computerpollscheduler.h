@@ -0,0 +1,120 @@
+#pragma once
+
+#include "nvcomputer.h"
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+#include <random>
+
+// Polls all known hosts from a single thread using asynchronous requests.
+// Hosts are polled on jittered intervals with a global limit on concurrent
+// polls, and offline hosts back off exponentially until they're seen again.
+class ComputerPollScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ComputerPollScheduler(QObject* parent = nullptr);
+
+    virtual ~ComputerPollScheduler();
+
+    // These may be called from any thread
+    void addComputer(NvComputer* computer);
+
+    // Resets any backoff and polls the host as soon as possible
+    void pollNow(NvComputer* computer);
+
+    // These must be called on the scheduler's thread
+
+    // Polls all hosts immediately and keeps polling until stop() is called
+    void start();
+
+    // Aborts all polls in progress
+    void stop();
+
+    // No requests for this host are outstanding once this returns
+    void removeComputer(NvComputer* computer);
+
+signals:
+    void computerStateChanged(NvComputer* computer);
+
+private slots:
+    void processPendingRequests();
+
+    void startDuePolls();
+
+private:
+    struct HostEntry
+    {
+        NvComputer* computer;
+        qint64 nextPollTime;
+        int failures;
+        int pollsSinceLastAppListFetch;
+        bool polling;
+
+        // State of the poll in progress
+        QNetworkReply* reply;
+        QVector<NvAddress> addresses;
+        int addressIndex;
+        QVector<QNetworkReply*> raceReplies;
+        QTimer raceTimer;
+        int triesLeft;
+        bool wasOnline;
+        bool stateChanged;
+        bool keepAlive;
+        NvAddress address;
+        QSslCertificate serverCert;
+        QString httpServerInfo;
+    };
+
+    typedef void (ComputerPollScheduler::*ReplyHandler)(HostEntry*, QNetworkReply*);
+
+    void startPoll(HostEntry* entry);
+
+    // Starts a serverinfo request to the next candidate address, racing
+    // it against any requests to earlier addresses that are still pending
+    void raceNextAddress(HostEntry* entry);
+
+    void cancelAddressRace(HostEntry* entry);
+
+    QNetworkRequest createRequest(HostEntry* entry, QUrl baseUrl, QString command);
+
+    void sendRequest(HostEntry* entry, QUrl baseUrl, QString command, int timeoutMs, ReplyHandler handler);
+
+    void cancelRequest(HostEntry* entry);
+
+    void handleHttpServerInfo(HostEntry* entry, NvAddress address, QNetworkReply* reply);
+
+    void handleHttpsServerInfo(HostEntry* entry, QNetworkReply* reply);
+
+    void handleServerInfo(HostEntry* entry, QString serverInfo);
+
+    void finishServerInfo(HostEntry* entry, bool online);
+
+    void handleAppList(HostEntry* entry, QNetworkReply* reply);
+
+    void finishPoll(HostEntry* entry);
+
+    int getPollInterval(HostEntry* entry);
+
+    static
+    QString readReply(QNetworkReply* reply);
+
+    QNetworkAccessManager m_Nam;
+    QHash<NvComputer*, HostEntry*> m_Entries;
+    QTimer m_Timer;
+    QElapsedTimer m_Clock;
+    std::mt19937 m_Random;
+    int m_ActivePolls;
+    bool m_Running;
+
+    QMutex m_PendingLock;
+    QVector<NvComputer*> m_PendingAdds; // Protected by m_PendingLock
+    QVector<NvComputer*> m_PendingPolls; // Protected by m_PendingLock
+};
@@ -0,0 +1,110 @@
+#include "hoststore.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+
+#define HOST_PREFIX "host-"
+#define APPLIST_PREFIX "apps-"
+#define RECORD_SUFFIX ".ini"
+
+HostStore::HostStore(QString directory)
+    : m_Directory(directory)
+{
+
+}
+
+QStringList HostStore::getHostUuids() const
+{
+    QStringList uuids;
+
+    const QStringList fileNames = QDir(m_Directory).entryList(QStringList(HOST_PREFIX "*" RECORD_SUFFIX), QDir::Files);
+    for (const QString& fileName : fileNames) {
+        uuids.append(fileName.mid(sizeof(HOST_PREFIX) - 1,
+                                  fileName.length() - (sizeof(HOST_PREFIX) - 1) - (sizeof(RECORD_SUFFIX) - 1)));
+    }
+
+    return uuids;
+}
+
+NvComputer* HostStore::loadHost(QString uuid) const
+{
+    QSettings settings(getHostPath(uuid), QSettings::IniFormat);
+    if (settings.status() != QSettings::NoError) {
+        qWarning() << "Unable to read host record:" << settings.fileName();
+        return nullptr;
+    }
+
+    NvComputer* computer = new NvComputer(settings);
+    if (computer->uuid != uuid) {
+        qWarning() << "Host record has mismatched UUID:" << settings.fileName();
+        delete computer;
+        return nullptr;
+    }
+
+    return computer;
+}
+
+QVector<NvApp> HostStore::loadAppList(QString uuid) const
+{
+    if (!QFile::exists(getAppListPath(uuid))) {
+        return QVector<NvApp>();
+    }
+
+    QSettings settings(getAppListPath(uuid), QSettings::IniFormat);
+    return NvComputer::deserializeAppList(settings);
+}
+
+bool HostStore::saveHost(const NvComputer& computer)
+{
+    QSettings settings(getHostPath(computer.uuid), QSettings::IniFormat);
+    settings.clear();
+    computer.serialize(settings, false);
+    return commit(settings);
+}
+
+bool HostStore::saveAppList(QString uuid, const QVector<NvApp>& appList)
+{
+    QSettings settings(getAppListPath(uuid), QSettings::IniFormat);
+    settings.clear();
+    NvComputer::serializeAppList(settings, appList);
+    return commit(settings);
+}
+
+void HostStore::deleteHost(QString uuid)
+{
+    // Remove the host record first, so we never leave a host without its apps
+    QFile::remove(getHostPath(uuid));
+    QFile::remove(getAppListPath(uuid));
+}
+
+QString HostStore::getHostPath(QString uuid) const
+{
+    return m_Directory + "/" HOST_PREFIX + uuid + RECORD_SUFFIX;
+}
+
+QString HostStore::getAppListPath(QString uuid) const
+{
+    return m_Directory + "/" APPLIST_PREFIX + uuid + RECORD_SUFFIX;
+}
+
+bool HostStore::commit(QSettings& settings)
+{
+    if (!QDir().mkpath(m_Directory)) {
+        qWarning() << "Unable to create host store directory:" << m_Directory;
+        return false;
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    // Never overwrite a record in place, or a crash could leave it truncated
+    settings.setAtomicSyncRequired(true);
+#endif
+
+    settings.sync();
+    if (settings.status() != QSettings::NoError) {
+        qWarning() << "Unable to write host store record:" << settings.fileName();
+        return false;
+    }
+
+    return true;
+}
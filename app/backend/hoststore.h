@@ -0,0 +1,37 @@
+#pragma once
+
+#include "nvcomputer.h"
+
+#include <QStringList>
+
+// Stores each host as its own record, with its app list in a separate
+// file, so an update to one host only rewrites the records that changed.
+// Records are committed by renaming a temporary file over the old one.
+class HostStore
+{
+public:
+    explicit HostStore(QString directory);
+
+    QStringList getHostUuids() const;
+
+    // The returned host has no app list. Returns nullptr if the record is unreadable.
+    NvComputer* loadHost(QString uuid) const;
+
+    // Returns an empty list if no app list is stored for this host
+    QVector<NvApp> loadAppList(QString uuid) const;
+
+    bool saveHost(const NvComputer& computer);
+
+    bool saveAppList(QString uuid, const QVector<NvApp>& appList);
+
+    void deleteHost(QString uuid);
+
+private:
+    QString getHostPath(QString uuid) const;
+
+    QString getAppListPath(QString uuid) const;
+
+    bool commit(QSettings& settings);
+
+    QString m_Directory;
+};
@@ -1,7 +1,11 @@
 #include "identitymanager.h"
+#include "startuptracer.h"
 #include "utils.h"
 
 #include <QDebug>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
 
 #include <openssl/pem.h>
 #include <openssl/rsa.h>
@@ -14,6 +18,27 @@
 
 IdentityManager* IdentityManager::s_Im = nullptr;
 
+class IdentityGenerationTask : public QRunnable
+{
+public:
+    IdentityGenerationTask(IdentityManager* im)
+        : m_Im(im) {}
+
+    void run()
+    {
+        StartupTracer::Span span("Identity generation");
+
+        QSettings settings;
+        m_Im->createCredentials(settings);
+        span.end();
+
+        m_Im->finishCredentials();
+    }
+
+private:
+    IdentityManager* m_Im;
+};
+
 IdentityManager*
 IdentityManager::get()
 {
@@ -102,6 +127,7 @@ void IdentityManager::createCredentials(QSettings& settings)
 }
 
 IdentityManager::IdentityManager()
+    : m_HasCredentials(false)
 {
     QSettings settings;
 
@@ -110,17 +136,27 @@ IdentityManager::IdentityManager()
 
     if (m_CachedPemCert.isEmpty() || m_CachedPrivateKey.isEmpty()) {
         qInfo() << "No existing credentials found";
-        createCredentials(settings);
     }
     else if (getSslCertificate().isNull()) {
         qWarning() << "Certificate is unreadable";
-        createCredentials(settings);
     }
     else if (getSslKey().isNull()) {
         qWarning() << "Private key is unreadable";
-        createCredentials(settings);
     }
+    else {
+        finishCredentials();
+        return;
+    }
+
+    // Generating an RSA key can take seconds on slow CPUs, so do it in the
+    // background and only block callers once they actually need credentials.
+    m_CachedSslCert = QSslCertificate();
+    m_CachedSslKey = QSslKey();
+    QThreadPool::globalInstance()->start(new IdentityGenerationTask(this));
+}
 
+void IdentityManager::finishCredentials()
+{
     // We should have valid credentials now. If not, we're screwed
     if (getSslCertificate().isNull()) {
         qFatal("Newly generated certificate is unreadable");
@@ -128,6 +164,33 @@ IdentityManager::IdentityManager()
     if (getSslKey().isNull()) {
         qFatal("Newly generated private key is unreadable");
     }
+
+    // Build the SSL configuration once. We allow session persistence so NvHTTP
+    // can reuse session tickets and skip full handshakes on later connections.
+    m_CachedSslConfig = QSslConfiguration::defaultConfiguration();
+    m_CachedSslConfig.setLocalCertificate(getSslCertificate());
+    m_CachedSslConfig.setPrivateKey(getSslKey());
+    m_CachedSslConfig.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+    QMutexLocker lock(&m_CredentialsLock);
+    m_HasCredentials = true;
+    m_CredentialsReady.wakeAll();
+}
+
+void IdentityManager::waitForCredentials()
+{
+    QMutexLocker lock(&m_CredentialsLock);
+
+    if (!m_HasCredentials) {
+        QElapsedTimer timer;
+        timer.start();
+
+        while (!m_HasCredentials) {
+            m_CredentialsReady.wait(&m_CredentialsLock);
+        }
+
+        qInfo() << "Waited" << timer.elapsed() << "ms for identity credentials";
+    }
 }
 
 QSslCertificate
@@ -176,10 +239,15 @@ IdentityManager::getSslKey()
 QSslConfiguration
 IdentityManager::getSslConfig()
 {
-    QSslConfiguration sslConfig(QSslConfiguration::defaultConfiguration());
-    sslConfig.setLocalCertificate(getSslCertificate());
-    sslConfig.setPrivateKey(getSslKey());
-    return sslConfig;
+    waitForCredentials();
+    return m_CachedSslConfig;
+}
+
+bool
+IdentityManager::hasCredentials()
+{
+    QMutexLocker lock(&m_CredentialsLock);
+    return m_HasCredentials;
 }
 
 QString
@@ -210,11 +278,13 @@ IdentityManager::getUniqueId()
 QByteArray
 IdentityManager::getCertificate()
 {
+    waitForCredentials();
     return m_CachedPemCert;
 }
 
 QByteArray
 IdentityManager::getPrivateKey()
 {
+    waitForCredentials();
     return m_CachedPrivateKey;
 }
@@ -4,9 +4,13 @@
 #include <QSslCertificate>
 #include <QSslKey>
 #include <QSettings>
+#include <QMutex>
+#include <QWaitCondition>
 
 class IdentityManager
 {
+    friend class IdentityGenerationTask;
+
 public:
     QString
     getUniqueId();
@@ -17,9 +21,14 @@ public:
     QByteArray
     getPrivateKey();
 
+    // Blocks until credentials are available
     QSslConfiguration
     getSslConfig();
 
+    // Returns whether credentials are available without blocking
+    bool
+    hasCredentials();
+
     static
     IdentityManager*
     get();
@@ -27,6 +36,14 @@ public:
 private:
     IdentityManager();
 
+    // Called once the credentials are loaded or generated
+    void
+    finishCredentials();
+
+    // Blocks until credentials are available
+    void
+    waitForCredentials();
+
     QSslCertificate
     getSslCertificate();
 
@@ -36,14 +53,19 @@ private:
     void
     createCredentials(QSettings& settings);
 
-    // Initialized in constructor
+    // Initialized in constructor or by IdentityGenerationTask
     QByteArray m_CachedPrivateKey;
     QByteArray m_CachedPemCert;
+    QSslConfiguration m_CachedSslConfig;
 
     // Lazy initialized
     QString m_CachedUniqueId;
     QSslCertificate m_CachedSslCert;
     QSslKey m_CachedSslKey;
 
+    QMutex m_CredentialsLock;
+    QWaitCondition m_CredentialsReady;
+    bool m_HasCredentials; // Protected by m_CredentialsLock
+
     static IdentityManager* s_Im;
 };
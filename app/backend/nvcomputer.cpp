@@ -6,6 +6,7 @@
 #include <QHostInfo>
 #include <QNetworkInterface>
 #include <QNetworkProxy>
+#include <QHash>
 
 #define SER_NAME "hostname"
 #define SER_UUID "uuid"
@@ -40,15 +41,7 @@ NvComputer::NvComputer(QSettings& settings)
     this->serverCert = QSslCertificate(settings.value(SER_SRVCERT).toByteArray());
     this->isNvidiaServerSoftware = settings.value(SER_NVIDIASOFTWARE).toBool();
 
-    int appCount = settings.beginReadArray(SER_APPLIST);
-    this->appList.reserve(appCount);
-    for (int i = 0; i < appCount; i++) {
-        settings.setArrayIndex(i);
-
-        NvApp app(settings);
-        this->appList.append(app);
-    }
-    settings.endArray();
+    this->appList = deserializeAppList(settings);
     sortAppList();
 
     this->currentGameId = 0;
@@ -95,17 +88,39 @@ void NvComputer::serialize(QSettings& settings, bool serializeApps) const
 
     // Avoid deleting an existing applist if we couldn't get one
     if (!appList.isEmpty() && serializeApps) {
-        settings.remove(SER_APPLIST);
-        settings.beginWriteArray(SER_APPLIST);
-        for (int i = 0; i < appList.count(); i++) {
-            settings.setArrayIndex(i);
-            appList[i].serialize(settings);
-        }
-        settings.endArray();
+        serializeAppList(settings, appList);
+    }
+}
+
+QVector<NvApp> NvComputer::deserializeAppList(QSettings& settings)
+{
+    QVector<NvApp> appList;
+
+    int appCount = settings.beginReadArray(SER_APPLIST);
+    appList.reserve(appCount);
+    for (int i = 0; i < appCount; i++) {
+        settings.setArrayIndex(i);
+
+        NvApp app(settings);
+        appList.append(app);
     }
+    settings.endArray();
+
+    return appList;
 }
 
-bool NvComputer::isEqualSerialized(const NvComputer &that) const
+void NvComputer::serializeAppList(QSettings& settings, const QVector<NvApp>& appList)
+{
+    settings.remove(SER_APPLIST);
+    settings.beginWriteArray(SER_APPLIST);
+    for (int i = 0; i < appList.count(); i++) {
+        settings.setArrayIndex(i);
+        appList[i].serialize(settings);
+    }
+    settings.endArray();
+}
+
+bool NvComputer::isEqualSerialized(const NvComputer &that, bool compareApps) const
 {
     return this->name == that.name &&
            this->hasCustomName == that.hasCustomName &&
@@ -117,19 +132,39 @@ bool NvComputer::isEqualSerialized(const NvComputer &that) const
            this->manualAddress == that.manualAddress &&
            this->serverCert == that.serverCert &&
            this->isNvidiaServerSoftware == that.isNvidiaServerSoftware &&
-           this->appList == that.appList;
+           (!compareApps || this->appList == that.appList);
 }
 
 void NvComputer::sortAppList()
 {
-    std::stable_sort(appList.begin(), appList.end(), [](const NvApp& app1, const NvApp& app2) {
-       return app1.name.toLower() < app2.name.toLower();
+    // Compute each sort key once rather than for every comparison
+    QVector<QPair<QString, int>> sortKeys;
+    sortKeys.reserve(appList.count());
+    for (int i = 0; i < appList.count(); i++) {
+        sortKeys.append(qMakePair(appList[i].name.toLower(), i));
+    }
+
+    std::stable_sort(sortKeys.begin(), sortKeys.end(), [](const QPair<QString, int>& key1, const QPair<QString, int>& key2) {
+       return key1.first < key2.first;
     });
+
+    QVector<NvApp> sortedAppList;
+    sortedAppList.reserve(appList.count());
+    for (const QPair<QString, int>& key : sortKeys) {
+        sortedAppList.append(appList[key.second]);
+    }
+    appList = sortedAppList;
 }
 
 NvComputer::NvComputer(NvHTTP& http, QString serverInfo)
+    : NvComputer(http.address(), http.serverCert(), serverInfo)
 {
-    this->serverCert = http.serverCert();
+
+}
+
+NvComputer::NvComputer(NvAddress address, QSslCertificate serverCert, QString serverInfo)
+{
+    this->serverCert = serverCert;
 
     this->hasCustomName = false;
     this->name = NvHTTP::getXmlString(serverInfo, "hostname");
@@ -171,7 +206,7 @@ NvComputer::NvComputer(NvHTTP& http, QString serverInfo)
     });
 
     // We can get an IPv4 loopback address if we're using the GS IPv6 Forwarder
-    this->localAddress = NvAddress(NvHTTP::getXmlString(serverInfo, "LocalIP"), http.httpPort());
+    this->localAddress = NvAddress(NvHTTP::getXmlString(serverInfo, "LocalIP"), address.port());
     if (this->localAddress.address().startsWith("127.")) {
         this->localAddress = NvAddress();
     }
@@ -185,7 +220,7 @@ NvComputer::NvComputer(NvHTTP& http, QString serverInfo)
     // to support dynamic HTTP WAN ports without requiring the user to manually enter the port.
     QString remotePortStr = NvHTTP::getXmlString(serverInfo, "ExternalPort");
     if (remotePortStr.isEmpty() || (this->externalPort = remotePortStr.toUShort()) == 0) {
-        this->externalPort = http.httpPort();
+        this->externalPort = address.port();
     }
 
     QString remoteAddress = NvHTTP::getXmlString(serverInfo, "ExternalIP");
@@ -207,7 +242,7 @@ NvComputer::NvComputer(NvHTTP& http, QString serverInfo)
     this->appVersion = NvHTTP::getXmlString(serverInfo, "appversion");
     this->gfeVersion = NvHTTP::getXmlString(serverInfo, "GfeVersion");
     this->gpuModel = NvHTTP::getXmlString(serverInfo, "gputype");
-    this->activeAddress = http.address();
+    this->activeAddress = address;
     this->state = NvComputer::CS_ONLINE;
     this->pendingQuit = false;
     this->isSupportedServerVersion = CompatFetcher::isGfeVersionSupported(this->gfeVersion);
@@ -477,6 +512,31 @@ bool NvComputer::updateAppList(QVector<NvApp> newAppList) {
     return true;
 }
 
+void NvComputer::mergeStoredAppList(const QVector<NvApp>& storedAppList)
+{
+    if (appList.isEmpty()) {
+        appList = storedAppList;
+        sortAppList();
+        return;
+    }
+
+    // We already fetched a newer app list from the host,
+    // so just restore the client-side attributes.
+    QHash<int, const NvApp*> storedAppsById;
+    storedAppsById.reserve(storedAppList.size());
+    for (const NvApp& storedApp : storedAppList) {
+        storedAppsById.insert(storedApp.id, &storedApp);
+    }
+
+    for (NvApp& app : appList) {
+        const NvApp* storedApp = storedAppsById.value(app.id);
+        if (storedApp != nullptr) {
+            app.hidden = storedApp->hidden;
+            app.directLaunch = storedApp->directLaunch;
+        }
+    }
+}
+
 QVector<NvAddress> NvComputer::uniqueAddresses() const
 {
     QReadLocker readLocker(&lock);
@@ -20,15 +20,18 @@ public:
 
 class NvComputer
 {
-    friend class PcMonitorThread;
+    friend class ComputerPollScheduler;
     friend class ComputerManager;
     friend class PendingQuitTask;
+    friend class DelayedFlushThread;
 
 private:
     void sortAppList();
 
     bool updateAppList(QVector<NvApp> newAppList);
 
+    void mergeStoredAppList(const QVector<NvApp>& storedAppList);
+
     bool pendingQuit;
 
 public:
@@ -42,6 +45,8 @@ public:
 
     explicit NvComputer(NvHTTP& http, QString serverInfo);
 
+    explicit NvComputer(NvAddress address, QSslCertificate serverCert, QString serverInfo);
+
     explicit NvComputer(QSettings& settings);
 
     void
@@ -69,9 +74,17 @@ public:
     void
     serialize(QSettings& settings, bool serializeApps) const;
 
+    static
+    QVector<NvApp>
+    deserializeAppList(QSettings& settings);
+
+    static
+    void
+    serializeAppList(QSettings& settings, const QVector<NvApp>& appList);
+
     // Caller is responsible for synchronizing read access to both hosts
     bool
-    isEqualSerialized(const NvComputer& that) const;
+    isEqualSerialized(const NvComputer& that, bool compareApps = true) const;
 
     enum PairState
     {
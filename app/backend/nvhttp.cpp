@@ -11,6 +11,8 @@
 #include <QImageReader>
 #include <QtEndian>
 #include <QNetworkProxy>
+#include <QElapsedTimer>
+#include <QMutex>
 
 #define FAST_FAIL_TIMEOUT_MS 2000
 #define REQUEST_TIMEOUT_MS 5000
@@ -18,8 +20,24 @@
 #define RESUME_TIMEOUT_MS 30000
 #define QUIT_TIMEOUT_MS 30000
 
+// TLS session tickets shared by all NvHTTP instances, keyed by host and port
+static QMutex s_TlsSessionLock;
+static QHash<QString, QByteArray> s_TlsSessions;
+static QAtomicInt s_TlsFullHandshakes;
+static QAtomicInt s_TlsResumedHandshakes;
+static QAtomicInt s_TlsReusedConnections;
+
+// Set on replies whose connection performed a TLS handshake
+#define TLS_HANDSHAKE_PROPERTY "nvTlsHandshake"
+
+static QString getTlsSessionKey(const QUrl& url)
+{
+    return url.host() + ":" + QString::number(url.port());
+}
+
 NvHTTP::NvHTTP(NvAddress address, uint16_t httpsPort, QSslCertificate serverCert) :
-    m_ServerCert(serverCert)
+    m_ServerCert(serverCert),
+    m_KeepAlive(false)
 {
     m_BaseUrlHttp.setScheme("http");
     m_BaseUrlHttps.setScheme("https");
@@ -37,7 +55,8 @@ NvHTTP::NvHTTP(NvAddress address, uint16_t httpsPort, QSslCertificate serverCert
 NvHTTP::NvHTTP(NvComputer* computer) :
     NvHTTP(computer->activeAddress, computer->activeHttpsPort, computer->serverCert)
 {
-
+    // Only GFE has trouble with reused connections
+    m_KeepAlive = !computer->isNvidiaServerSoftware;
 }
 
 void NvHTTP::setServerCert(QSslCertificate serverCert)
@@ -295,6 +314,12 @@ NvHTTP::getAppList()
                                             NvLogLevel::NVLL_ERROR);
     verifyResponseStatus(appxml);
 
+    return parseAppList(appxml);
+}
+
+QVector<NvApp>
+NvHTTP::parseAppList(QString appxml)
+{
     QXmlStreamReader xmlReader(appxml);
     QVector<NvApp> apps;
     while (!xmlReader.atEnd()) {
@@ -417,17 +442,65 @@ NvHTTP::getXmlString(QString xml,
 }
 
 void NvHTTP::handleSslErrors(QNetworkReply* reply, const QList<QSslError>& errors)
+{
+    ignorePinnedCertSslErrors(reply, errors, m_ServerCert);
+}
+
+void NvHTTP::watchTlsHandshake(QNetworkReply* reply)
+{
+    // encrypted() is only emitted when a new connection completes its
+    // handshake, not when the request goes out on a kept-alive connection.
+    connect(reply, &QNetworkReply::encrypted, reply, [reply]() {
+        reply->setProperty(TLS_HANDSHAKE_PROPERTY, true);
+
+        // The session was resumed if the handshake kept the ticket we offered.
+        // A resumption where the host issued a fresh ticket is counted as a
+        // full handshake, so the resumed count never overstates.
+        QByteArray offeredTicket = reply->request().sslConfiguration().sessionTicket();
+        if (!offeredTicket.isEmpty() && reply->sslConfiguration().sessionTicket() == offeredTicket) {
+            s_TlsResumedHandshakes.fetchAndAddRelaxed(1);
+        }
+        else {
+            s_TlsFullHandshakes.fetchAndAddRelaxed(1);
+        }
+    });
+}
+
+void NvHTTP::saveTlsSession(QNetworkReply* reply)
+{
+    if (reply->url().scheme() != "https" || reply->error() != QNetworkReply::NoError) {
+        return;
+    }
+
+    if (!reply->property(TLS_HANDSHAKE_PROPERTY).toBool()) {
+        s_TlsReusedConnections.fetchAndAddRelaxed(1);
+    }
+
+    QByteArray sessionTicket = reply->sslConfiguration().sessionTicket();
+    if (!sessionTicket.isEmpty()) {
+        QMutexLocker lock(&s_TlsSessionLock);
+        s_TlsSessions.insert(getTlsSessionKey(reply->url()), sessionTicket);
+    }
+}
+
+void NvHTTP::clearTlsSession(QUrl baseUrl)
+{
+    QMutexLocker lock(&s_TlsSessionLock);
+    s_TlsSessions.remove(getTlsSessionKey(baseUrl));
+}
+
+void NvHTTP::ignorePinnedCertSslErrors(QNetworkReply* reply, const QList<QSslError>& errors, const QSslCertificate& serverCert)
 {
     bool ignoreErrors = true;
 
-    if (m_ServerCert.isNull()) {
+    if (serverCert.isNull()) {
         // We should never make an HTTPS request without a cert
-        Q_ASSERT(!m_ServerCert.isNull());
+        Q_ASSERT(!serverCert.isNull());
         return;
     }
 
     for (const QSslError& error : errors) {
-        if (m_ServerCert != error.certificate()) {
+        if (serverCert != error.certificate()) {
             ignoreErrors = false;
             break;
         }
@@ -462,12 +535,11 @@ NvHTTP::openConnectionToString(QUrl baseUrl,
     return ret;
 }
 
-QNetworkReply*
-NvHTTP::openConnection(QUrl baseUrl,
-                       QString command,
-                       QString arguments,
-                       int timeoutMs,
-                       NvLogLevel logLevel)
+QNetworkRequest
+NvHTTP::createRequest(QUrl baseUrl,
+                      QString command,
+                      QString arguments,
+                      bool keepAlive)
 {
     // Port must be set
     Q_ASSERT(baseUrl.port(0) != 0);
@@ -485,14 +557,41 @@ NvHTTP::openConnection(QUrl baseUrl,
 
     QNetworkRequest request(url);
 
-    // Add our client certificate
-    request.setSslConfiguration(IdentityManager::get()->getSslConfig());
+    if (url.scheme() == "https") {
+        // Add our client certificate. This waits for the credentials if they
+        // are still being generated, so plain HTTP requests skip it.
+        QSslConfiguration sslConfig = IdentityManager::get()->getSslConfig();
+
+        // Offer the last session we had with this host for resumption
+        QMutexLocker lock(&s_TlsSessionLock);
+        sslConfig.setSessionTicket(s_TlsSessions.value(getTlsSessionKey(url)));
+        request.setSslConfiguration(sslConfig);
+    }
+
+    // GFE misbehaves when connections are reused, so ask for the
+    // connection to be closed unless we know the host handles it.
+    if (!keepAlive) {
+        request.setRawHeader("Connection", "close");
+    }
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     // Disable HTTP/2 (GFE 3.22 doesn't like it) and Qt 6 enables it by default
     request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
 #endif
 
+    return request;
+}
+
+QNetworkReply*
+NvHTTP::openConnection(QUrl baseUrl,
+                       QString command,
+                       QString arguments,
+                       int timeoutMs,
+                       NvLogLevel logLevel)
+{
+    QNetworkRequest request = createRequest(baseUrl, command, arguments, m_KeepAlive);
+    QUrl url = request.url();
+
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0) && QT_VERSION < QT_VERSION_CHECK(5, 15, 1) && !defined(QT_NO_BEARERMANAGEMENT)
     // HACK: Set network accessibility to work around QTBUG-80947 (introduced in Qt 5.14.0 and fixed in Qt 5.15.1)
     QT_WARNING_PUSH
@@ -501,7 +600,11 @@ NvHTTP::openConnection(QUrl baseUrl,
     QT_WARNING_POP
 #endif
 
+    QElapsedTimer requestTimer;
+    requestTimer.start();
+
     QNetworkReply* reply = m_Nam.get(request);
+    NvHTTP::watchTlsHandshake(reply);
 
     // Run the request with a timeout if requested
     QEventLoop loop;
@@ -524,9 +627,14 @@ NvHTTP::openConnection(QUrl baseUrl,
         reply->abort();
     }
 
-    // We must clear out cached authentication and connections or
-    // GFE will puke next time
-    m_Nam.clearAccessCache();
+    NvHTTP::saveTlsSession(reply);
+
+    if (logLevel >= NvLogLevel::NVLL_VERBOSE && reply->isFinished()) {
+        qInfo().nospace() << command << " request completed in " << requestTimer.elapsed() << " ms"
+                          << " (TLS handshakes: " << (int)s_TlsFullHandshakes << " full, "
+                          << (int)s_TlsResumedHandshakes << " resumed; "
+                          << (int)s_TlsReusedConnections << " reused connections)";
+    }
 
     // Handle error
     if (reply->error() != QNetworkReply::NoError)
@@ -536,6 +644,9 @@ NvHTTP::openConnection(QUrl baseUrl,
         }
 
         if (reply->error() == QNetworkReply::SslHandshakeFailedError) {
+            // Don't try to resume a session with a host that failed validation
+            NvHTTP::clearTlsSession(baseUrl);
+
             // This will trigger falling back to HTTP for the serverinfo query
             // then pairing again to get the updated certificate.
             GfeHttpResponseException exception(401, "Server certificate mismatch");
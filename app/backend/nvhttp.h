@@ -175,6 +175,10 @@ public:
     QVector<NvApp>
     getAppList();
 
+    static
+    QVector<NvApp>
+    parseAppList(QString appxml);
+
     QImage
     getBoxArt(int appId);
 
@@ -182,6 +186,41 @@ public:
     QVector<NvDisplayMode>
     getDisplayModeList(QString serverInfo);
 
+    // Builds a GameStream request that can be issued on any QNetworkAccessManager.
+    // Unless keepAlive is set, the host is asked to close the connection afterwards.
+    static
+    QNetworkRequest
+    createRequest(QUrl baseUrl,
+                  QString command,
+                  QString arguments,
+                  bool keepAlive);
+
+    // Ignores SSL errors on the reply only if they are caused by the pinned cert
+    static
+    void
+    ignorePinnedCertSslErrors(QNetworkReply* reply,
+                              const QList<QSslError>& errors,
+                              const QSslCertificate& serverCert);
+
+    // Counts whether the reply's connection performed a full TLS handshake,
+    // resumed a session, or reused an open connection. Call right after
+    // issuing the request.
+    static
+    void
+    watchTlsHandshake(QNetworkReply* reply);
+
+    // Remembers the TLS session of a finished HTTPS reply, so the next
+    // connection to the same host can resume it instead of performing
+    // a full handshake with client certificate authentication.
+    static
+    void
+    saveTlsSession(QNetworkReply* reply);
+
+    // Forgets the TLS session for the host (after a certificate mismatch)
+    static
+    void
+    clearTlsSession(QUrl baseUrl);
+
     QUrl m_BaseUrlHttp;
     QUrl m_BaseUrlHttps;
 private:
@@ -198,4 +237,5 @@ private:
     NvAddress m_Address;
     QNetworkAccessManager m_Nam;
     QSslCertificate m_ServerCert;
+    bool m_KeepAlive;
 };
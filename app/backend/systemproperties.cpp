@@ -1,8 +1,16 @@
 #include "systemproperties.h"
+#include "startuptracer.h"
 #include "utils.h"
 
 #include <QGuiApplication>
 #include <QLibraryInfo>
+#include <QScreen>
+#include <QSettings>
+#include <QDir>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
 
 #include "streaming/session.h"
 #include "streaming/streamutils.h"
@@ -12,7 +20,26 @@
 #include <Windows.h>
 #endif
 
+#define SER_SYSPROPS "sysprops"
+#define SER_SNAPSHOTKEY "key"
+#define SER_SNAPSHOTTIME "time"
+#define SER_HWACCEL "hwaccel"
+#define SER_ALWAYSFULLSCREEN "alwaysfullscreen"
+#define SER_HDR "hdr"
+#define SER_MAXRES "maxres"
+#define SER_NATIVERES "nativeres"
+#define SER_SAFEAREARES "safeareares"
+#define SER_REFRESHRATES "refreshrates"
+
+// Snapshots that can't be revalidated in the background expire after a week
+#define MAX_SNAPSHOT_AGE_SECS (7 * 24 * 60 * 60)
+
+QThread* SystemProperties::s_ProbeThread;
+
 SystemProperties::SystemProperties()
+    : hasHardwareAcceleration(false),
+      rendererAlwaysFullScreen(false),
+      supportsHdr(false)
 {
     versionString = QString(VERSION_STR);
     hasDesktopEnvironment = WMUtils::isRunningDesktopEnvironment();
@@ -69,8 +96,20 @@ SystemProperties::SystemProperties()
     unmappedGamepads = SdlInputHandler::getUnmappedGamepads();
 
     // Populate data that requires talking to SDL. We do it all in one shot
-    // and cache the results to speed up future queries on this data.
-    querySdlVideoInfo();
+    // and cache the results to speed up future queries on this data. If
+    // the displays and GPU haven't changed since we last probed, use the
+    // saved results instead.
+    if (loadSnapshot()) {
+        if (canProbeInBackground()) {
+            // Revalidate the saved results once the UI is up
+            StartupTracer::runWhenInteractive(this, [this] {
+                startProbeThread(false);
+            });
+        }
+    }
+    else if (querySdlVideoInfo()) {
+        saveSnapshot();
+    }
 
     Q_ASSERT(!monitorRefreshRates.isEmpty());
     Q_ASSERT(!monitorNativeResolutions.isEmpty());
@@ -95,39 +134,61 @@ int SystemProperties::getRefreshRate(int displayIndex)
     return monitorRefreshRates.value(displayIndex);
 }
 
+SystemProperties::~SystemProperties()
+{
+    waitForBackgroundProbe();
+}
+
 class QuerySdlVideoThread : public QThread
 {
 public:
-    QuerySdlVideoThread(SystemProperties* me) :
+    QuerySdlVideoThread(bool displaysOnly) :
         QThread(nullptr),
-        m_Me(me) {}
+        m_DisplaysOnly(displaysOnly) {}
 
     void run() override
     {
-        m_Me->querySdlVideoInfoInternal();
+        if (m_DisplaysOnly) {
+            SystemProperties::refreshDisplaysInternal(m_Info);
+        }
+        else {
+            SystemProperties::querySdlVideoInfoInternal(m_Info);
+        }
     }
 
-    SystemProperties* m_Me;
+    bool m_DisplaysOnly;
+    SystemProperties::VideoInfo m_Info;
 };
 
-void SystemProperties::querySdlVideoInfo()
+bool SystemProperties::canProbeInBackground()
 {
-    if (WMUtils::isRunningX11() || WMUtils::isRunningWayland()) {
+    // SDL video can only be isolated on its own thread on X11 and Wayland.
+    // Elsewhere, it must be used on the main thread.
+    return WMUtils::isRunningX11() || WMUtils::isRunningWayland();
+}
+
+bool SystemProperties::querySdlVideoInfo()
+{
+    VideoInfo info;
+
+    if (canProbeInBackground()) {
         // Use a separate thread to temporarily initialize SDL
         // video to avoid stomping on Qt's X11 and OGL state.
-        QuerySdlVideoThread thread(this);
+        QuerySdlVideoThread thread(false);
         thread.start();
         thread.wait();
+        info = thread.m_Info;
     }
     else {
-        querySdlVideoInfoInternal();
+        querySdlVideoInfoInternal(info);
     }
+
+    applyVideoInfo(info, false);
+    return info.decoderInfoValid;
 }
 
-void SystemProperties::querySdlVideoInfoInternal()
+void SystemProperties::querySdlVideoInfoInternal(VideoInfo& info)
 {
-    hasHardwareAcceleration = false;
-
     if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                      "SDL_InitSubSystem(SDL_INIT_VIDEO) failed: %s",
@@ -137,7 +198,7 @@ void SystemProperties::querySdlVideoInfoInternal()
 
     // Update display related attributes (max FPS, native resolution, etc).
     // We call the internal variant because we're already in a safe thread context.
-    refreshDisplaysInternal();
+    refreshDisplaysInternal(info);
 
     SDL_Window* testWindow = SDL_CreateWindow("", 0, 0, 1280, 720,
                                               SDL_WINDOW_HIDDEN | StreamUtils::getPlatformWindowFlags());
@@ -151,48 +212,232 @@ void SystemProperties::querySdlVideoInfoInternal()
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                          "Failed to create window for hardware decode test: %s",
                          SDL_GetError());
-            SDL_QuitSubSystem(SDL_INIT_VIDEO);
+            StreamUtils::quitVideoSubsystem();
             return;
         }
     }
 
-    Session::getDecoderInfo(testWindow, hasHardwareAcceleration, rendererAlwaysFullScreen, supportsHdr, maximumResolution);
+    Session::getDecoderInfo(testWindow, info.hasHardwareAcceleration, info.rendererAlwaysFullScreen,
+                            info.supportsHdr, info.maximumResolution);
+    info.decoderInfoValid = true;
 
     SDL_DestroyWindow(testWindow);
 
-    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    StreamUtils::quitVideoSubsystem();
 }
 
-class RefreshDisplaysThread : public QThread
+void SystemProperties::startProbeThread(bool displaysOnly)
 {
-public:
-    RefreshDisplaysThread(SystemProperties* me) :
-        QThread(nullptr),
-        m_Me(me) {}
+    Q_ASSERT(canProbeInBackground());
 
-    void run() override
-    {
-        m_Me->refreshDisplaysInternal();
+    // Don't touch SDL video while a stream is using it. The snapshot
+    // will be revalidated on the next launch instead.
+    if (Session::get() != nullptr || s_ProbeThread != nullptr) {
+        return;
     }
 
-    SystemProperties* m_Me;
-};
+    QuerySdlVideoThread* thread = new QuerySdlVideoThread(displaysOnly);
+    connect(thread, &QThread::finished, this,
+            [this, thread] {
+                if (s_ProbeThread == thread) {
+                    s_ProbeThread = nullptr;
+                }
+
+                applyVideoInfo(thread->m_Info, thread->m_DisplaysOnly);
+                if (!thread->m_DisplaysOnly && thread->m_Info.decoderInfoValid) {
+                    saveSnapshot();
+                }
+
+                thread->deleteLater();
+            });
+    s_ProbeThread = thread;
+    thread->start();
+}
+
+void SystemProperties::waitForBackgroundProbe()
+{
+    if (s_ProbeThread != nullptr) {
+        s_ProbeThread->wait();
+    }
+}
+
+void SystemProperties::applyVideoInfo(const VideoInfo& info, bool displaysOnly)
+{
+    if (!displaysOnly && info.decoderInfoValid) {
+        if (hasHardwareAcceleration != info.hasHardwareAcceleration) {
+            hasHardwareAcceleration = info.hasHardwareAcceleration;
+            emit hasHardwareAccelerationChanged();
+        }
+        if (rendererAlwaysFullScreen != info.rendererAlwaysFullScreen) {
+            rendererAlwaysFullScreen = info.rendererAlwaysFullScreen;
+            emit rendererAlwaysFullScreenChanged();
+        }
+        if (supportsHdr != info.supportsHdr) {
+            supportsHdr = info.supportsHdr;
+            emit supportsHdrChanged();
+        }
+        if (maximumResolution != info.maximumResolution) {
+            maximumResolution = info.maximumResolution;
+            emit maximumResolutionChanged();
+        }
+    }
+
+    if (info.displaysValid &&
+            (monitorNativeResolutions != info.monitorNativeResolutions ||
+             monitorSafeAreaResolutions != info.monitorSafeAreaResolutions ||
+             monitorRefreshRates != info.monitorRefreshRates)) {
+        monitorNativeResolutions = info.monitorNativeResolutions;
+        monitorSafeAreaResolutions = info.monitorSafeAreaResolutions;
+        monitorRefreshRates = info.monitorRefreshRates;
+        emit displaysChanged();
+    }
+}
+
+QString SystemProperties::getSnapshotKey()
+{
+    QStringList components;
+
+    SDL_version sdlVersion;
+    SDL_GetVersion(&sdlVersion);
+
+    // Decoder selection logic may change between versions
+    components << VERSION_STR;
+    components << QString("SDL %1.%2.%3").arg(sdlVersion.major).arg(sdlVersion.minor).arg(sdlVersion.patch);
+    components << QGuiApplication::platformName();
+
+    for (const QScreen* screen : QGuiApplication::screens()) {
+        QSize pixelSize = screen->size() * screen->devicePixelRatio();
+        components << QString("%1 %2x%3@%4").arg(screen->name())
+                                            .arg(pixelSize.width())
+                                            .arg(pixelSize.height())
+                                            .arg(qRound(screen->refreshRate()));
+    }
+
+#if defined(Q_OS_WIN32)
+    DISPLAY_DEVICEW device;
+    device.cb = sizeof(device);
+    for (DWORD i = 0; EnumDisplayDevicesW(nullptr, i, &device, 0); i++) {
+        if (device.StateFlags & DISPLAY_DEVICE_ACTIVE) {
+            components << QString::fromWCharArray(device.DeviceString) + " " + QString::fromWCharArray(device.DeviceID);
+        }
+    }
+#elif defined(Q_OS_LINUX)
+    QDir drmDir("/sys/class/drm");
+    QRegularExpression cardRegex("^card\\d+$");
+    for (const QString& card : drmDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name)) {
+        if (!cardRegex.match(card).hasMatch()) {
+            continue;
+        }
+
+        QDir deviceDir(drmDir.filePath(card + "/device"));
+        QFile vendorFile(deviceDir.filePath("vendor"));
+        QFile deviceFile(deviceDir.filePath("device"));
+        if (vendorFile.open(QIODevice::ReadOnly) && deviceFile.open(QIODevice::ReadOnly)) {
+            components << QString("%1 %2:%3 %4").arg(card,
+                                                     QString::fromLatin1(vendorFile.readAll().trimmed()),
+                                                     QString::fromLatin1(deviceFile.readAll().trimmed()),
+                                                     QFileInfo(deviceDir.filePath("driver")).symLinkTarget().section('/', -1));
+        }
+    }
+#endif
+
+    return components.join('|');
+}
+
+bool SystemProperties::loadSnapshot()
+{
+    QSettings settings;
+    settings.beginGroup(SER_SYSPROPS);
+
+    QString key = settings.value(SER_SNAPSHOTKEY).toString();
+    if (key.isEmpty()) {
+        return false;
+    }
+    else if (key != getSnapshotKey()) {
+        qInfo() << "Display or GPU configuration changed since last launch";
+        return false;
+    }
+    else if (!canProbeInBackground() &&
+             QDateTime::currentSecsSinceEpoch() - settings.value(SER_SNAPSHOTTIME).toLongLong() > MAX_SNAPSHOT_AGE_SECS) {
+        // We can't revalidate the snapshot without blocking the UI here,
+        // so we only trust it for a limited time (to pick up driver updates).
+        qInfo() << "Video info snapshot is too old";
+        return false;
+    }
+
+    VideoInfo info;
+    info.hasHardwareAcceleration = settings.value(SER_HWACCEL).toBool();
+    info.rendererAlwaysFullScreen = settings.value(SER_ALWAYSFULLSCREEN).toBool();
+    info.supportsHdr = settings.value(SER_HDR).toBool();
+    info.maximumResolution = settings.value(SER_MAXRES).toSize();
+    for (const QVariant& rect : settings.value(SER_NATIVERES).toList()) {
+        info.monitorNativeResolutions.append(rect.toRect());
+    }
+    for (const QVariant& rect : settings.value(SER_SAFEAREARES).toList()) {
+        info.monitorSafeAreaResolutions.append(rect.toRect());
+    }
+    for (const QVariant& rate : settings.value(SER_REFRESHRATES).toList()) {
+        info.monitorRefreshRates.append(rate.toInt());
+    }
+
+    if (info.monitorRefreshRates.isEmpty() || info.monitorNativeResolutions.isEmpty() || info.monitorSafeAreaResolutions.isEmpty()) {
+        return false;
+    }
+
+    info.displaysValid = true;
+    info.decoderInfoValid = true;
+    applyVideoInfo(info, false);
+    return true;
+}
+
+void SystemProperties::saveSnapshot()
+{
+    QSettings settings;
+    settings.beginGroup(SER_SYSPROPS);
+
+    QVariantList nativeResolutions, safeAreaResolutions, refreshRates;
+    for (const QRect& rect : monitorNativeResolutions) {
+        nativeResolutions.append(rect);
+    }
+    for (const QRect& rect : monitorSafeAreaResolutions) {
+        safeAreaResolutions.append(rect);
+    }
+    for (int rate : monitorRefreshRates) {
+        refreshRates.append(rate);
+    }
+
+    settings.setValue(SER_SNAPSHOTKEY, getSnapshotKey());
+    settings.setValue(SER_SNAPSHOTTIME, QDateTime::currentSecsSinceEpoch());
+    settings.setValue(SER_HWACCEL, hasHardwareAcceleration);
+    settings.setValue(SER_ALWAYSFULLSCREEN, rendererAlwaysFullScreen);
+    settings.setValue(SER_HDR, supportsHdr);
+    settings.setValue(SER_MAXRES, maximumResolution);
+    settings.setValue(SER_NATIVERES, nativeResolutions);
+    settings.setValue(SER_SAFEAREARES, safeAreaResolutions);
+    settings.setValue(SER_REFRESHRATES, refreshRates);
+}
 
 void SystemProperties::refreshDisplays()
 {
-    if (WMUtils::isRunningX11() || WMUtils::isRunningWayland()) {
+    if (s_ProbeThread != nullptr) {
+        // The probe in progress will refresh the displays too
+        return;
+    }
+
+    if (canProbeInBackground()) {
         // Use a separate thread to temporarily initialize SDL
         // video to avoid stomping on Qt's X11 and OGL state.
-        RefreshDisplaysThread thread(this);
-        thread.start();
-        thread.wait();
+        // Listeners are notified by displaysChanged().
+        startProbeThread(true);
     }
     else {
-        refreshDisplaysInternal();
+        VideoInfo info;
+        refreshDisplaysInternal(info);
+        applyVideoInfo(info, true);
     }
 }
 
-void SystemProperties::refreshDisplaysInternal()
+void SystemProperties::refreshDisplaysInternal(VideoInfo& info)
 {
     if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
@@ -201,7 +446,9 @@ void SystemProperties::refreshDisplaysInternal()
         return;
     }
 
-    monitorNativeResolutions.clear();
+    info.monitorNativeResolutions.clear();
+    info.monitorSafeAreaResolutions.clear();
+    info.monitorRefreshRates.clear();
 
     SDL_DisplayMode bestMode;
     for (int displayIndex = 0; displayIndex < SDL_GetNumVideoDisplays(); displayIndex++) {
@@ -210,8 +457,8 @@ void SystemProperties::refreshDisplaysInternal()
 
         if (StreamUtils::getNativeDesktopMode(displayIndex, &desktopMode, &safeArea)) {
             if (desktopMode.w <= 8192 && desktopMode.h <= 8192) {
-                monitorNativeResolutions.insert(displayIndex, QRect(0, 0, desktopMode.w, desktopMode.h));
-                monitorSafeAreaResolutions.insert(displayIndex, QRect(0, 0, safeArea.w, safeArea.h));
+                info.monitorNativeResolutions.insert(displayIndex, QRect(0, 0, desktopMode.w, desktopMode.h));
+                info.monitorSafeAreaResolutions.insert(displayIndex, QRect(0, 0, safeArea.w, safeArea.h));
             }
             else {
                 SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
@@ -235,16 +482,18 @@ void SystemProperties::refreshDisplaysInternal()
             // Try to normalize values around our our standard refresh rates.
             // Some displays/OSes report values that are slightly off.
             if (bestMode.refresh_rate >= 58 && bestMode.refresh_rate <= 62) {
-                monitorRefreshRates.append(60);
+                info.monitorRefreshRates.append(60);
             }
             else if (bestMode.refresh_rate >= 28 && bestMode.refresh_rate <= 32) {
-                monitorRefreshRates.append(30);
+                info.monitorRefreshRates.append(30);
             }
             else {
-                monitorRefreshRates.append(bestMode.refresh_rate);
+                info.monitorRefreshRates.append(bestMode.refresh_rate);
             }
         }
     }
 
-    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    info.displaysValid = true;
+
+    StreamUtils::quitVideoSubsystem();
 }
@@ -2,19 +2,26 @@
 
 #include <QObject>
 #include <QRect>
+#include <QSize>
+#include <QThread>
 
 class SystemProperties : public QObject
 {
     Q_OBJECT
 
     friend class QuerySdlVideoThread;
-    friend class RefreshDisplaysThread;
 
 public:
     SystemProperties();
 
-    Q_PROPERTY(bool hasHardwareAcceleration MEMBER hasHardwareAcceleration CONSTANT)
-    Q_PROPERTY(bool rendererAlwaysFullScreen MEMBER rendererAlwaysFullScreen CONSTANT)
+    virtual ~SystemProperties();
+
+    // Blocks until a background video probe (if any) has finished
+    // using the SDL video subsystem. Must be called on the main thread.
+    static void waitForBackgroundProbe();
+
+    Q_PROPERTY(bool hasHardwareAcceleration MEMBER hasHardwareAcceleration NOTIFY hasHardwareAccelerationChanged)
+    Q_PROPERTY(bool rendererAlwaysFullScreen MEMBER rendererAlwaysFullScreen NOTIFY rendererAlwaysFullScreenChanged)
     Q_PROPERTY(bool isRunningWayland MEMBER isRunningWayland CONSTANT)
     Q_PROPERTY(bool isRunningXWayland MEMBER isRunningXWayland CONSTANT)
     Q_PROPERTY(bool isWow64 MEMBER isWow64 CONSTANT)
@@ -23,11 +30,13 @@ public:
     Q_PROPERTY(bool hasBrowser MEMBER hasBrowser CONSTANT)
     Q_PROPERTY(bool hasDiscordIntegration MEMBER hasDiscordIntegration CONSTANT)
     Q_PROPERTY(QString unmappedGamepads MEMBER unmappedGamepads NOTIFY unmappedGamepadsChanged)
-    Q_PROPERTY(QSize maximumResolution MEMBER maximumResolution CONSTANT)
+    Q_PROPERTY(QSize maximumResolution MEMBER maximumResolution NOTIFY maximumResolutionChanged)
     Q_PROPERTY(QString versionString MEMBER versionString CONSTANT)
-    Q_PROPERTY(bool supportsHdr MEMBER supportsHdr CONSTANT)
+    Q_PROPERTY(bool supportsHdr MEMBER supportsHdr NOTIFY supportsHdrChanged)
     Q_PROPERTY(bool usesMaterial3Theme MEMBER usesMaterial3Theme CONSTANT)
 
+    // May complete asynchronously, in which case displaysChanged()
+    // is emitted if anything changed
     Q_INVOKABLE void refreshDisplays();
     Q_INVOKABLE QRect getNativeResolution(int displayIndex);
     Q_INVOKABLE QRect getSafeAreaResolution(int displayIndex);
@@ -35,11 +44,50 @@ public:
 
 signals:
     void unmappedGamepadsChanged();
+    void hasHardwareAccelerationChanged();
+    void rendererAlwaysFullScreenChanged();
+    void maximumResolutionChanged();
+    void supportsHdrChanged();
+    void displaysChanged();
 
 private:
-    void querySdlVideoInfo();
-    void querySdlVideoInfoInternal();
-    void refreshDisplaysInternal();
+    struct VideoInfo
+    {
+        VideoInfo()
+            : displaysValid(false),
+              decoderInfoValid(false),
+              hasHardwareAcceleration(false),
+              rendererAlwaysFullScreen(false),
+              supportsHdr(false) {}
+
+        bool displaysValid;
+        bool decoderInfoValid;
+        bool hasHardwareAcceleration;
+        bool rendererAlwaysFullScreen;
+        bool supportsHdr;
+        QSize maximumResolution;
+        QList<QRect> monitorNativeResolutions;
+        QList<QRect> monitorSafeAreaResolutions;
+        QList<int> monitorRefreshRates;
+    };
+
+    bool querySdlVideoInfo();
+    static void querySdlVideoInfoInternal(VideoInfo& info);
+    static void refreshDisplaysInternal(VideoInfo& info);
+
+    static bool canProbeInBackground();
+
+    // Probes the displays (and decoder unless displaysOnly is set) on
+    // another thread, then applies the results on the main thread
+    void startProbeThread(bool displaysOnly);
+
+    // Only emits change signals for properties that differ
+    void applyVideoInfo(const VideoInfo& info, bool displaysOnly);
+
+    // Snapshots of the video info are keyed by display topology and GPU
+    static QString getSnapshotKey();
+    bool loadSnapshot();
+    void saveSnapshot();
 
     bool hasHardwareAcceleration;
     bool rendererAlwaysFullScreen;
@@ -58,5 +106,7 @@ private:
     QString versionString;
     bool supportsHdr;
     bool usesMaterial3Theme;
+
+    static QThread* s_ProbeThread; // Only accessed on the main thread
 };
 
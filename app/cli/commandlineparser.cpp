@@ -164,7 +164,7 @@ GlobalCommandLineParser::ParseResult GlobalCommandLineParser::parse(const QStrin
         "Starts Moonlight normally if no arguments are given.\n"
         "\n"
         "Available actions:\n"
-        "  list            List the available apps on a host\n"
+        "  list            List the available apps on one or more hosts\n"
         "  quit            Quit the currently running app\n"
         "  stream          Start streaming an app\n"
         "  pair            Pair a new host\n"
@@ -328,6 +328,11 @@ StreamCommandLineParser::StreamCommandLineParser()
         {"fullscreen", StreamingPreferences::CSK_FULLSCREEN},
         {"always",     StreamingPreferences::CSK_ALWAYS},
     };
+    m_VbanGateModeMap = {
+        {"off",       StreamingPreferences::VGM_OFF},
+        {"silence",   StreamingPreferences::VGM_SILENCE},
+        {"keepalive", StreamingPreferences::VGM_KEEPALIVE},
+    };
 }
 
 StreamCommandLineParser::~StreamCommandLineParser()
@@ -379,8 +384,12 @@ void StreamCommandLineParser::parse(const QStringList &args, StreamingPreference
     parser.addChoiceOption("video-decoder", "video decoder", m_VideoDecoderMap.keys());
     parser.addToggleOption("combine-joy-cons", "Combine Joy-Con (L) and Joy-Con (R)");
     parser.addToggleOption("vertical-joy-cons", "Use vertical mode for Joy-Cons");
+    parser.addValueOption("gamepad-send-rate", "maximum gamepad analog update rate in Hz");
     parser.addToggleOption("cemuhook-server", "CemuHook Server");
+    parser.addValueOption("cemuhook-rate", "CemuHook Server update rate in Hz");
     parser.addToggleOption("vban-emitter", "VBAN Emitter");
+    parser.addChoiceOption("vban-gate", "VBAN Emitter voice activity gate", m_VbanGateModeMap.keys());
+    parser.addValueOption("vban-gate-threshold", "VBAN Emitter gate threshold in dBFS");
 
     if (!parser.parse(args)) {
         parser.showError(parser.errorText());
@@ -519,12 +528,41 @@ void StreamCommandLineParser::parse(const QStringList &args, StreamingPreference
     // Resolve --vertical-joy-cons and --no-vertical-joy-cons options
     preferences->verticalJoyCons = parser.getToggleOptionValue("vertical-joy-cons", preferences->verticalJoyCons);
 
+    // Resolve --gamepad-send-rate option
+    if (parser.isSet("gamepad-send-rate")) {
+        preferences->gamepadSendRate = parser.getIntOption("gamepad-send-rate");
+        if (!inRange(preferences->gamepadSendRate, 1, 1000)) {
+            parser.showError("Gamepad send rate must be in range: 1 - 1000");
+        }
+    }
+
     // Resolve --cemuhook-server and --no-cemuhook-server options
     preferences->cemuhookServer = parser.getToggleOptionValue("cemuhook-server", preferences->cemuhookServer);
 
+    // Resolve --cemuhook-rate option
+    if (parser.isSet("cemuhook-rate")) {
+        preferences->cemuhookRate = parser.getIntOption("cemuhook-rate");
+        if (!inRange(preferences->cemuhookRate, 1, 1000)) {
+            parser.showError("CemuHook rate must be in range: 1 - 1000");
+        }
+    }
+
     // Resolve --vban-emitter and --no-vban-emitter options
     preferences->vbanEmitter = parser.getToggleOptionValue("vban-emitter", preferences->vbanEmitter);
 
+    // Resolve --vban-gate option
+    if (parser.isSet("vban-gate")) {
+        preferences->vbanGateMode = mapValue(m_VbanGateModeMap, parser.getChoiceOptionValue("vban-gate"));
+    }
+
+    // Resolve --vban-gate-threshold option
+    if (parser.isSet("vban-gate-threshold")) {
+        preferences->vbanGateThreshold = parser.getIntOption("vban-gate-threshold");
+        if (!inRange(preferences->vbanGateThreshold, -96, 0)) {
+            parser.showError("VBAN gate threshold must be in range: -96 - 0");
+        }
+    }
+
     // This method will not return and terminates the process if --version or
     // --help is specified
     parser.handleHelpAndVersionOptions();
@@ -566,13 +604,20 @@ void ListCommandLineParser::parse(const QStringList &args)
     parser.setupCommonOptions();
     parser.setApplicationDescription(
         "\n"
-        "List the available apps on the given host."
+        "List the available apps on the given host.\n"
+        "\n"
+        "When multiple hosts or --all are given, the hosts are queried concurrently\n"
+        "and one JSON object is printed per line as each host answers."
     );
     parser.addPositionalArgument("list", "list available apps");
-    parser.addPositionalArgument("host", "Host computer name, UUID, or IP address", "<host>");
+    parser.addPositionalArgument("host", "Host computer name, UUID, or IP address", "<host> [<host>...]");
 
     parser.addFlagOption("csv",     "Print as CSV with additional information");
+    parser.addFlagOption("json",    "Print as JSON lines with host state and apps");
+    parser.addFlagOption("all",     "List apps on all known hosts");
     parser.addFlagOption("verbose", "Displays additional information");
+    parser.addValueOption("parallel", "maximum number of hosts to query at once");
+    parser.addValueOption("timeout", "per-host timeout in seconds");
 
     if (!parser.parse(args)) {
         parser.showError(parser.errorText());
@@ -582,23 +627,75 @@ void ListCommandLineParser::parse(const QStringList &args)
 
 
     m_PrintCSV = parser.isSet("csv");
+    m_PrintJSON = parser.isSet("json");
+    m_AllHosts = parser.isSet("all");
     m_Verbose = parser.isSet("verbose");
 
     // This method will not return and terminates the process if --version or
     // --help is specified
     parser.handleHelpAndVersionOptions();
 
-    // Verify that host has been provided
-    auto posArgs = parser.positionalArguments();
-    if (posArgs.length() < 2) {
+    // Verify that a host has been provided
+    m_Hosts = parser.positionalArguments().mid(1);
+    if (m_Hosts.isEmpty() && !m_AllHosts) {
         parser.showError("Host not provided");
     }
-    m_Host = parser.positionalArguments().at(1);
+
+    // Querying multiple hosts always produces JSON lines
+    if (m_Hosts.length() > 1 || m_AllHosts) {
+        m_PrintJSON = true;
+    }
+    if (m_PrintJSON && m_PrintCSV) {
+        parser.showError("--csv cannot be combined with --json, --all, or multiple hosts");
+    }
+
+    // Resolve --parallel option
+    m_Parallelism = 16;
+    if (parser.isSet("parallel")) {
+        m_Parallelism = parser.getIntOption("parallel");
+        if (!inRange(m_Parallelism, 1, 256)) {
+            parser.showError("Parallelism must be in range: 1 - 256");
+        }
+    }
+
+    // Resolve --timeout option
+    m_TimeoutSecs = 10;
+    if (parser.isSet("timeout")) {
+        m_TimeoutSecs = parser.getIntOption("timeout");
+        if (!inRange(m_TimeoutSecs, 1, 300)) {
+            parser.showError("Timeout must be in range: 1 - 300");
+        }
+    }
 }
 
 QString ListCommandLineParser::getHost() const
 {
-    return m_Host;
+    return m_Hosts.value(0);
+}
+
+QStringList ListCommandLineParser::getHosts() const
+{
+    return m_Hosts;
+}
+
+bool ListCommandLineParser::isAllHosts() const
+{
+    return m_AllHosts;
+}
+
+bool ListCommandLineParser::isPrintJSON() const
+{
+    return m_PrintJSON;
+}
+
+int ListCommandLineParser::getParallelism() const
+{
+    return m_Parallelism;
+}
+
+int ListCommandLineParser::getTimeoutSecs() const
+{
+    return m_TimeoutSecs;
 }
 
 bool ListCommandLineParser::isPrintCSV() const
@@ -4,6 +4,7 @@
 
 #include <QMap>
 #include <QString>
+#include <QStringList>
 
 class GlobalCommandLineParser
 {
@@ -72,6 +73,7 @@ private:
     QMap<QString, StreamingPreferences::VideoCodecConfig> m_VideoCodecMap;
     QMap<QString, StreamingPreferences::VideoDecoderSelection> m_VideoDecoderMap;
     QMap<QString, StreamingPreferences::CaptureSysKeysMode> m_CaptureSysKeysModeMap;
+    QMap<QString, StreamingPreferences::VbanGateMode> m_VbanGateModeMap;
 };
 
 class ListCommandLineParser
@@ -83,11 +85,20 @@ public:
     void parse(const QStringList &args);
 
     QString getHost() const;
+    QStringList getHosts() const;
+    bool isAllHosts() const;
     bool isPrintCSV() const;
+    bool isPrintJSON() const;
     bool isVerbose() const;
+    int getParallelism() const;
+    int getTimeoutSecs() const;
 
 private:
-    QString m_Host;
+    QStringList m_Hosts;
+    bool m_AllHosts;
     bool m_PrintCSV;
+    bool m_PrintJSON;
     bool m_Verbose;
+    int m_Parallelism;
+    int m_TimeoutSecs;
 };
@@ -0,0 +1,327 @@
+#include "listhosts.h"
+
+#include "backend/computermanager.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+
+// Time allowed for each address of a host before moving to the next one
+#define ADDRESS_TIMEOUT_MS 2000
+
+namespace CliListHosts
+{
+
+struct ListTarget
+{
+    QString query;
+    QString uuid;
+    QString name;
+    QVector<NvAddress> addresses;
+    uint16_t httpsPort;
+    QSslCertificate serverCert;
+};
+
+class ListHostTask : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    ListHostTask(ListTarget target, int timeoutMs)
+        : m_Target(target),
+          m_TimeoutMs(timeoutMs) {}
+
+signals:
+    void hostListed(QJsonObject result, bool online);
+
+private:
+    static
+    QString fetchServerInfo(NvHTTP& http, int timeoutMs, qint64& rttMs)
+    {
+        QElapsedTimer timer;
+
+        if (!http.serverCert().isNull() && http.httpsPort() != 0) {
+            try {
+                // HTTPS properly reports the pairing status
+                timer.start();
+                QString serverInfo = http.openConnectionToString(http.m_BaseUrlHttps,
+                                                                 "serverinfo",
+                                                                 nullptr,
+                                                                 timeoutMs,
+                                                                 NvHTTP::NVLL_NONE);
+                NvHTTP::verifyResponseStatus(serverInfo);
+                rttMs = timer.elapsed();
+                return serverInfo;
+            } catch (const GfeHttpResponseException& e) {
+                // Certificate validation error, fallback to HTTP
+                if (e.getStatusCode() != 401) {
+                    throw e;
+                }
+            }
+        }
+
+        bool needHttpsPort = http.httpsPort() == 0;
+
+        timer.start();
+        QString serverInfo = http.openConnectionToString(http.m_BaseUrlHttp,
+                                                         "serverinfo",
+                                                         nullptr,
+                                                         timeoutMs,
+                                                         NvHTTP::NVLL_NONE);
+        NvHTTP::verifyResponseStatus(serverInfo);
+        rttMs = timer.elapsed();
+
+        if (needHttpsPort) {
+            uint16_t httpsPort = NvHTTP::getXmlString(serverInfo, "HttpsPort").toUShort();
+            http.setHttpsPort(httpsPort != 0 ? httpsPort : DEFAULT_HTTPS_PORT);
+
+            // Try again over HTTPS now that we know the port
+            if (!http.serverCert().isNull()) {
+                return fetchServerInfo(http, timeoutMs, rttMs);
+            }
+        }
+
+        return serverInfo;
+    }
+
+    void run()
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        QJsonObject result;
+        result["host"] = m_Target.query;
+        if (!m_Target.uuid.isEmpty()) {
+            result["uuid"] = m_Target.uuid;
+            result["name"] = m_Target.name;
+        }
+
+        QString lastError = "No address to connect to";
+        for (int i = 0; i < m_Target.addresses.length(); i++) {
+            qint64 remainingMs = m_TimeoutMs - timer.elapsed();
+            if (remainingMs <= 0) {
+                lastError = "Timed out";
+                break;
+            }
+
+            // Don't let one dead address consume the whole budget
+            int timeoutMs = (int)remainingMs;
+            if (i + 1 < m_Target.addresses.length()) {
+                timeoutMs = qMin(timeoutMs, ADDRESS_TIMEOUT_MS);
+            }
+
+            NvHTTP http(m_Target.addresses[i], m_Target.httpsPort, m_Target.serverCert);
+            QString serverInfo;
+            qint64 rttMs;
+            try {
+                serverInfo = fetchServerInfo(http, timeoutMs, rttMs);
+            } catch (const GfeHttpResponseException& e) {
+                lastError = e.toQString();
+                continue;
+            } catch (const QtNetworkReplyException& e) {
+                lastError = e.toQString();
+                continue;
+            }
+
+            NvComputer computer(http, serverInfo);
+            if (!m_Target.uuid.isEmpty() && computer.uuid != m_Target.uuid) {
+                lastError = QString("Found unexpected host %1 at %2").arg(computer.uuid, m_Target.addresses[i].toString());
+                continue;
+            }
+
+            result["uuid"] = computer.uuid;
+            result["name"] = computer.name;
+            result["address"] = m_Target.addresses[i].toString();
+            result["state"] = "online";
+            result["paired"] = computer.pairState == NvComputer::PS_PAIRED;
+            result["rttMs"] = rttMs;
+            result["runningAppId"] = computer.currentGameId;
+
+            if (computer.pairState == NvComputer::PS_PAIRED) {
+                try {
+                    remainingMs = m_TimeoutMs - timer.elapsed();
+                    if (remainingMs <= 0) {
+                        throw QtNetworkReplyException(QNetworkReply::TimeoutError, "Timed out");
+                    }
+
+                    QString appxml = http.openConnectionToString(http.m_BaseUrlHttps,
+                                                                 "applist",
+                                                                 nullptr,
+                                                                 (int)remainingMs,
+                                                                 NvHTTP::NVLL_NONE);
+                    NvHTTP::verifyResponseStatus(appxml);
+
+                    QJsonArray apps;
+                    for (const NvApp& app : NvHTTP::parseAppList(appxml)) {
+                        QJsonObject appObj;
+                        appObj["id"] = app.id;
+                        appObj["name"] = app.name;
+                        appObj["hdrSupported"] = app.hdrSupported;
+                        appObj["isAppCollectorGame"] = app.isAppCollectorGame;
+                        apps.append(appObj);
+
+                        if (app.id == computer.currentGameId) {
+                            result["runningApp"] = app.name;
+                        }
+                    }
+                    result["apps"] = apps;
+                } catch (const GfeHttpResponseException& e) {
+                    result["error"] = e.toQString();
+                } catch (const QtNetworkReplyException& e) {
+                    result["error"] = e.toQString();
+                }
+            }
+
+            emit hostListed(result, true);
+            return;
+        }
+
+        result["state"] = "offline";
+        result["error"] = lastError;
+        emit hostListed(result, false);
+    }
+
+    ListTarget m_Target;
+    int m_TimeoutMs;
+};
+
+Launcher::Launcher(ListCommandLineParser arguments, QObject *parent)
+    : QObject(parent),
+      m_Arguments(arguments),
+      m_Pool(new QThreadPool(this)),
+      m_PendingHosts(0),
+      m_AllOnline(true)
+{
+    m_Pool->setMaxThreadCount(m_Arguments.getParallelism());
+}
+
+Launcher::~Launcher()
+{
+}
+
+static bool matchComputer(NvComputer *computer, const QVector<NvAddress>& addresses, QString query)
+{
+    QString value = query.toLower();
+
+    {
+        QReadLocker lock(&computer->lock);
+        if (computer->name.toLower() == value || computer->uuid.toLower() == value) {
+            return true;
+        }
+    }
+
+    for (const NvAddress& addr : addresses) {
+        if (addr.address().toLower() == value || addr.toString().toLower() == value) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static ListTarget createTarget(NvComputer *computer, const QVector<NvAddress>& addresses, QString query)
+{
+    ListTarget target;
+    target.query = query;
+
+    QReadLocker lock(&computer->lock);
+
+    target.uuid = computer->uuid;
+    target.name = computer->name;
+    target.httpsPort = computer->activeHttpsPort;
+    target.serverCert = computer->serverCert;
+
+    // Try the last working address first
+    if (!computer->activeAddress.isNull()) {
+        target.addresses.append(computer->activeAddress);
+    }
+    for (const NvAddress& addr : addresses) {
+        if (!target.addresses.contains(addr)) {
+            target.addresses.append(addr);
+        }
+    }
+
+    return target;
+}
+
+void Launcher::execute(ComputerManager *manager)
+{
+    QVector<NvComputer*> computers = manager->getComputers();
+    QVector<QVector<NvAddress>> computerAddresses;
+    for (NvComputer* computer : computers) {
+        // This takes the computer lock itself
+        computerAddresses.append(computer->uniqueAddresses());
+    }
+
+    QVector<ListTarget> targets;
+    if (m_Arguments.isAllHosts()) {
+        for (int i = 0; i < computers.length(); i++) {
+            targets.append(createTarget(computers[i], computerAddresses[i], computers[i]->uuid));
+        }
+    }
+
+    for (const QString& query : m_Arguments.getHosts()) {
+        bool found = false;
+        for (int i = 0; i < computers.length(); i++) {
+            if (matchComputer(computers[i], computerAddresses[i], query)) {
+                targets.append(createTarget(computers[i], computerAddresses[i], query));
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            // Not a known host, so query it by address without a pinned cert
+            ListTarget target;
+            target.query = query;
+            target.httpsPort = 0;
+
+            QUrl url = QUrl::fromUserInput("moonlight://" + query);
+            if (url.isValid() && !url.host().isEmpty() && url.scheme() == "moonlight") {
+                target.addresses.append(NvAddress(url.host(), url.port(DEFAULT_HTTP_PORT)));
+            }
+
+            targets.append(target);
+        }
+    }
+
+    if (targets.isEmpty()) {
+        fprintf(stderr, "No known hosts to list\n");
+
+        // We're called before the event loop starts
+        QTimer::singleShot(0, [] { QCoreApplication::exit(-1); });
+        return;
+    }
+
+    if (m_Arguments.isVerbose()) {
+        fprintf(stderr, "Querying %d hosts...\n", (int)targets.length());
+    }
+
+    m_PendingHosts = targets.length();
+    for (const ListTarget& target : targets) {
+        ListHostTask* task = new ListHostTask(target, m_Arguments.getTimeoutSecs() * 1000);
+        connect(task, &ListHostTask::hostListed,
+                this, &Launcher::onHostListed);
+        m_Pool->start(task);
+    }
+}
+
+void Launcher::onHostListed(QJsonObject result, bool online)
+{
+    fprintf(stdout, "%s\n", QJsonDocument(result).toJson(QJsonDocument::Compact).constData());
+    fflush(stdout);
+
+    m_AllOnline = m_AllOnline && online;
+
+    if (--m_PendingHosts == 0) {
+        QCoreApplication::exit(m_AllOnline ? 0 : -1);
+    }
+}
+
+}
+
+#include "listhosts.moc"
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "commandlineparser.h"
+
+#include <QObject>
+#include <QJsonObject>
+
+class ComputerManager;
+class QThreadPool;
+
+namespace CliListHosts
+{
+
+// Lists the apps on several hosts at once. Each host is queried directly
+// on a bounded thread pool and the result is printed as a JSON line as
+// soon as that host answers or times out.
+class Launcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Launcher(ListCommandLineParser arguments, QObject *parent = nullptr);
+    ~Launcher();
+
+    void execute(ComputerManager *manager);
+
+private slots:
+    void onHostListed(QJsonObject result, bool online);
+
+private:
+    ListCommandLineParser m_Arguments;
+    QThreadPool *m_Pool;
+    int m_PendingHosts;
+    bool m_AllOnline;
+};
+
+}
@@ -162,10 +162,13 @@ Flickable {
                             }
                         }
 
-                        // ignore setting the index at first, and actually set it when the component is loaded
-                        Component.onCompleted: {
-                            // Refresh display data before using it to build the list
-                            SystemProperties.refreshDisplays()
+                        function reinitialize() {
+                            // Remove the custom entry, since it's added again below
+                            for (var k = resolutionListModel.count - 1; k >= 0; k--) {
+                                if (resolutionListModel.get(k).is_custom) {
+                                    resolutionListModel.remove(k)
+                                }
+                            }
 
                             // Add native and safe area resolutions for all attached displays
                             var done = false
@@ -239,6 +242,17 @@ Flickable {
                             lastIndexValue = currentIndex
                         }
 
+                        // ignore setting the index at first, and actually set it when the component is loaded
+                        Component.onCompleted: {
+                            reinitialize()
+
+                            // Display data is refreshed in the background, so
+                            // rebuild the list whenever it comes back changed
+                            SystemProperties.displaysChanged.connect(reinitialize)
+                            SystemProperties.maximumResolutionChanged.connect(reinitialize)
+                            SystemProperties.refreshDisplays()
+                        }
+
                         id: resolutionComboBox
                         maximumWidth: parent.width / 2
                         textRole: "text"
@@ -628,6 +642,7 @@ Flickable {
                         Component.onCompleted: {
                             reinitialize()
                             languageChanged.connect(reinitialize)
+                            SystemProperties.displaysChanged.connect(reinitialize)
                         }
 
                         model: ListModel {
@@ -1487,6 +1502,95 @@ Flickable {
                         StreamingPreferences.vbanEmitter = checked
                     }
                 }
+
+                Row {
+                    spacing: 5
+                    width: parent.width
+                    visible: vbanEmitter.checked
+
+                    Label {
+                        anchors.verticalCenter: parent.verticalCenter
+                        text: qsTr("Microphone silence suppression")
+                        font.pointSize: 12
+                    }
+
+                    AutoResizingComboBox {
+                        // ignore setting the index at first, and actually set it when the component is loaded
+                        Component.onCompleted: {
+                            var saved_gatemode = StreamingPreferences.vbanGateMode
+                            currentIndex = 0
+                            for (var i = 0; i < vbanGateModeListModel.count; i++) {
+                                var el_gatemode = vbanGateModeListModel.get(i).val;
+                                if (saved_gatemode === el_gatemode) {
+                                    currentIndex = i
+                                    break
+                                }
+                            }
+
+                            activated(currentIndex)
+                        }
+
+                        textRole: "text"
+                        model: ListModel {
+                            id: vbanGateModeListModel
+                            ListElement {
+                                text: qsTr("Off")
+                                val: StreamingPreferences.VGM_OFF
+                            }
+                            ListElement {
+                                text: qsTr("Send nothing")
+                                val: StreamingPreferences.VGM_SILENCE
+                            }
+                            ListElement {
+                                text: qsTr("Send keepalive")
+                                val: StreamingPreferences.VGM_KEEPALIVE
+                            }
+                        }
+
+                        // ::onActivated must be used, as it only listens for when the index is changed by a human
+                        onActivated: {
+                            StreamingPreferences.vbanGateMode = vbanGateModeListModel.get(currentIndex).val
+                        }
+
+                        ToolTip.delay: 1000
+                        ToolTip.timeout: 5000
+                        ToolTip.visible: hovered
+                        ToolTip.text: qsTr("Stops streaming microphone audio to the host while it stays below the threshold")
+                    }
+                }
+
+                Label {
+                    width: parent.width
+                    id: vbanGateThresholdTitle
+                    text: qsTr("Silence threshold:")
+                    font.pointSize: 12
+                    wrapMode: Text.Wrap
+                    visible: vbanEmitter.checked && StreamingPreferences.vbanGateMode !== StreamingPreferences.VGM_OFF
+                }
+
+                Slider {
+                    id: vbanGateThresholdSlider
+
+                    value: StreamingPreferences.vbanGateThreshold
+
+                    stepSize: 1
+                    from : -96
+                    to: 0
+
+                    snapMode: "SnapOnRelease"
+                    width: parent.width
+                    visible: vbanGateThresholdTitle.visible
+
+                    onValueChanged: {
+                        vbanGateThresholdTitle.text = qsTr("Silence threshold: %1 dBFS").arg(value)
+                        StreamingPreferences.vbanGateThreshold = value
+                    }
+
+                    Component.onCompleted: {
+                        // Refresh the text after translations change
+                        languageChanged.connect(valueChanged)
+                    }
+                }
             }
         }
 
@@ -0,0 +1,188 @@
+#include "applistmodel.h"
+
+#include <QHash>
+#include <QSet>
+
+AppListModel::AppListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+
+}
+
+int AppListModel::rowCount(const QModelIndex &parent) const
+{
+    // For list models only the root node (an invalid parent) should return the list's size. For all
+    // other (valid) parents, rowCount() should return 0 so that it does not become a tree model.
+    if (parent.isValid())
+        return 0;
+
+    return m_VisibleApps.count();
+}
+
+// Returns which elements belong to a longest strictly increasing subsequence
+static QVector<bool> getLongestIncreasingSubsequence(const QVector<int>& values)
+{
+    // tails[k] is the index of the smallest tail of an increasing run of length k + 1
+    QVector<int> tails;
+    QVector<int> predecessors(values.count(), -1);
+
+    for (int i = 0; i < values.count(); i++) {
+        int low = 0, high = tails.count();
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (values.at(tails.at(mid)) < values.at(i)) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+
+        if (low > 0) {
+            predecessors[i] = tails.at(low - 1);
+        }
+
+        if (low == tails.count()) {
+            tails.append(i);
+        }
+        else {
+            tails[low] = i;
+        }
+    }
+
+    QVector<bool> members(values.count(), false);
+    for (int i = tails.isEmpty() ? -1 : tails.last(); i >= 0; i = predecessors.at(i)) {
+        members[i] = true;
+    }
+
+    return members;
+}
+
+void AppListModel::setVisibleApps(const QVector<NvApp>& newVisibleList)
+{
+    // Transform m_VisibleApps into the new list with as few row operations as possible
+    QSet<int> newAppIds;
+    newAppIds.reserve(newVisibleList.count());
+    for (const NvApp& newApp : newVisibleList) {
+        newAppIds.insert(newApp.id);
+    }
+
+    // Process removals first, in contiguous ranges from the end of the list
+    QSet<int> survivingAppIds;
+    survivingAppIds.reserve(m_VisibleApps.count());
+    for (int i = m_VisibleApps.count() - 1; i >= 0; i--) {
+        if (newAppIds.contains(m_VisibleApps.at(i).id)) {
+            survivingAppIds.insert(m_VisibleApps.at(i).id);
+            continue;
+        }
+
+        int last = i;
+        while (i > 0 && !newAppIds.contains(m_VisibleApps.at(i - 1).id)) {
+            i--;
+        }
+
+        beginRemoveRows(QModelIndex(), i, last);
+        m_VisibleApps.remove(i, last - i + 1);
+        endRemoveRows();
+    }
+
+    // Reorder the surviving rows. Rows whose relative order didn't change form
+    // an increasing run of new positions, so we keep the longest such run in
+    // place and move each remaining row once, right after its new predecessor.
+    QHash<int, int> newRanks;
+    newRanks.reserve(survivingAppIds.count());
+    for (const NvApp& newApp : newVisibleList) {
+        if (survivingAppIds.contains(newApp.id)) {
+            newRanks.insert(newApp.id, newRanks.count());
+        }
+    }
+
+    QVector<int> ranks;
+    ranks.reserve(m_VisibleApps.count());
+    QHash<int, int> currentRows;
+    currentRows.reserve(m_VisibleApps.count());
+    for (int i = 0; i < m_VisibleApps.count(); i++) {
+        ranks.append(newRanks.value(m_VisibleApps.at(i).id));
+        currentRows.insert(m_VisibleApps.at(i).id, i);
+    }
+
+    QVector<bool> staysInPlace = getLongestIncreasingSubsequence(ranks);
+    QSet<int> stationaryAppIds;
+    for (int i = 0; i < m_VisibleApps.count(); i++) {
+        if (staysInPlace.at(i)) {
+            stationaryAppIds.insert(m_VisibleApps.at(i).id);
+        }
+    }
+
+    int previousRow = -1;
+    for (const NvApp& newApp : newVisibleList) {
+        if (!survivingAppIds.contains(newApp.id)) {
+            continue;
+        }
+
+        int from = currentRows.value(newApp.id);
+        if (stationaryAppIds.contains(newApp.id)) {
+            previousRow = from;
+            continue;
+        }
+
+        int to = from > previousRow ? previousRow + 1 : previousRow;
+        if (from != to) {
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), from < to ? to + 1 : to);
+            m_VisibleApps.move(from, to);
+            endMoveRows();
+
+            // Only the rows between the two positions shifted
+            for (int i = qMin(from, to); i <= qMax(from, to); i++) {
+                currentRows.insert(m_VisibleApps.at(i).id, i);
+            }
+        }
+
+        previousRow = to;
+    }
+
+    // Now walk the new list, inserting rows as needed. The surviving
+    // rows are already in their final order.
+    QVector<int> changedRows;
+    for (int i = 0; i < newVisibleList.count(); i++) {
+        const NvApp& newApp = newVisibleList.at(i);
+
+        if (!survivingAppIds.contains(newApp.id)) {
+            // Insert this app along with any other new apps that follow it
+            int last = i;
+            while (last + 1 < newVisibleList.count() && !survivingAppIds.contains(newVisibleList.at(last + 1).id)) {
+                last++;
+            }
+
+            beginInsertRows(QModelIndex(), i, last);
+            m_VisibleApps.insert(i, last - i + 1, NvApp());
+            for (int j = i; j <= last; j++) {
+                m_VisibleApps[j] = newVisibleList.at(j);
+            }
+            endInsertRows();
+
+            i = last;
+            continue;
+        }
+
+        Q_ASSERT(m_VisibleApps.at(i).id == newApp.id);
+
+        // If the data changed, update it in our list
+        if (m_VisibleApps.at(i) != newApp) {
+            m_VisibleApps.replace(i, newApp);
+            changedRows.append(i);
+        }
+    }
+
+    // Coalesce updated rows into contiguous ranges
+    for (int i = 0; i < changedRows.count(); i++) {
+        int first = changedRows[i];
+        while (i + 1 < changedRows.count() && changedRows[i + 1] == changedRows[i] + 1) {
+            i++;
+        }
+        emit dataChanged(createIndex(first, 0), createIndex(changedRows[i], 0));
+    }
+
+    Q_ASSERT(newVisibleList == m_VisibleApps);
+}
+
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "backend/nvapp.h"
+
+#include <QAbstractListModel>
+#include <QVector>
+
+// The rows of the app grid, kept separate from AppModel so the
+// list updates can be tested without a ComputerManager
+class AppListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit AppListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent) const override;
+
+protected:
+    // Updates the rows to match the new list, which must be in display order
+    void setVisibleApps(const QVector<NvApp>& newVisibleList);
+
+    QVector<NvApp> m_VisibleApps;
+};
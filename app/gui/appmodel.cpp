@@ -1,7 +1,9 @@
 #include "appmodel.h"
 
+#include <QHash>
+
 AppModel::AppModel(QObject *parent)
-    : QAbstractListModel(parent)
+    : AppListModel(parent)
 {
     connect(&m_BoxArtManager, &BoxArtManager::boxArtLoadComplete,
             this, &AppModel::handleBoxArtLoaded);
@@ -58,16 +60,6 @@ int AppModel::getDirectLaunchAppIndex()
     return -1;
 }
 
-int AppModel::rowCount(const QModelIndex &parent) const
-{
-    // For list models only the root node (an invalid parent) should return the list's size. For all
-    // other (valid) parents, rowCount() should return 0 so that it does not become a tree model.
-    if (parent.isValid())
-        return 0;
-
-    return m_VisibleApps.count();
-}
-
 QVariant AppModel::data(const QModelIndex &index, int role) const
 {
     if (!index.isValid())
@@ -118,26 +110,23 @@ void AppModel::quitRunningApp()
     m_ComputerManager->quitRunningApp(m_Computer);
 }
 
-bool AppModel::isAppCurrentlyVisible(const NvApp& app)
-{
-    for (const NvApp& visibleApp : m_VisibleApps) {
-        if (app.id == visibleApp.id) {
-            return true;
-        }
-    }
-
-    return false;
-}
-
 QVector<NvApp> AppModel::getVisibleApps(const QVector<NvApp>& appList)
 {
     QVector<NvApp> visibleApps;
+    QSet<int> currentlyVisibleAppIds;
 
+    if (!m_ShowHiddenGames) {
+        for (const NvApp& visibleApp : m_VisibleApps) {
+            currentlyVisibleAppIds.insert(visibleApp.id);
+        }
+    }
+
+    visibleApps.reserve(appList.count());
     for (const NvApp& app : appList) {
         // Don't immediately hide games that were previously visible. This
         // allows users to easily uncheck the "Hide App" checkbox if they
         // check it by mistake.
-        if (m_ShowHiddenGames || !app.hidden || isAppCurrentlyVisible(app)) {
+        if (m_ShowHiddenGames || !app.hidden || currentlyVisibleAppIds.contains(app.id)) {
             visibleApps.append(app);
         }
     }
@@ -149,60 +138,8 @@ void AppModel::updateAppList(QVector<NvApp> newList)
 {
     m_AllApps = newList;
 
-    QVector<NvApp> newVisibleList = getVisibleApps(newList);
-
-    // Process removals and updates first
-    for (int i = 0; i < m_VisibleApps.count(); i++) {
-        const NvApp& existingApp = m_VisibleApps.at(i);
-
-        bool found = false;
-        for (const NvApp& newApp : newVisibleList) {
-            if (existingApp.id == newApp.id) {
-                // If the data changed, update it in our list
-                if (existingApp != newApp) {
-                    m_VisibleApps.replace(i, newApp);
-                    emit dataChanged(createIndex(i, 0), createIndex(i, 0));
-                }
-
-                found = true;
-                break;
-            }
-        }
-
-        if (!found) {
-            beginRemoveRows(QModelIndex(), i, i);
-            m_VisibleApps.removeAt(i);
-            endRemoveRows();
-            i--;
-        }
-    }
-
-    // Process additions now
-    for (const NvApp& newApp : newVisibleList) {
-        int insertionIndex = m_VisibleApps.size();
-        bool found = false;
-
-        for (int i = 0; i < m_VisibleApps.count(); i++) {
-            const NvApp& existingApp = m_VisibleApps.at(i);
-
-            if (existingApp.id == newApp.id) {
-                found = true;
-                break;
-            }
-            else if (existingApp.name.toLower() > newApp.name.toLower()) {
-                insertionIndex = i;
-                break;
-            }
-        }
-
-        if (!found) {
-            beginInsertRows(QModelIndex(), insertionIndex, insertionIndex);
-            m_VisibleApps.insert(insertionIndex, newApp);
-            endInsertRows();
-        }
-    }
-
-    Q_ASSERT(newVisibleList == m_VisibleApps);
+    // The new list is already in display order (see NvComputer::sortAppList())
+    setVisibleApps(getVisibleApps(newList));
 }
 
 void AppModel::setAppHidden(int appIndex, bool hidden)
@@ -1,12 +1,13 @@
 #pragma once
 
+#include "applistmodel.h"
 #include "backend/boxartmanager.h"
 #include "backend/computermanager.h"
 #include "streaming/session.h"
 
-#include <QAbstractListModel>
+#include <QSet>
 
-class AppModel : public QAbstractListModel
+class AppModel : public AppListModel
 {
     Q_OBJECT
 
@@ -43,8 +44,6 @@ public:
 
     QVariant data(const QModelIndex &index, int role) const override;
 
-    int rowCount(const QModelIndex &parent) const override;
-
     virtual QHash<int, QByteArray> roleNames() const override;
 
 private slots:
@@ -60,12 +59,10 @@ private:
 
     QVector<NvApp> getVisibleApps(const QVector<NvApp>& appList);
 
-    bool isAppCurrentlyVisible(const NvApp& app);
-
     NvComputer* m_Computer;
     BoxArtManager m_BoxArtManager;
     ComputerManager* m_ComputerManager;
-    QVector<NvApp> m_VisibleApps, m_AllApps;
+    QVector<NvApp> m_AllApps;
     int m_CurrentGameId;
     bool m_ShowHiddenGames;
 };
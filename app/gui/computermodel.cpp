@@ -10,6 +10,12 @@ void ComputerModel::initialize(ComputerManager* computerManager)
     m_ComputerManager = computerManager;
     connect(m_ComputerManager, &ComputerManager::computerStateChanged,
             this, &ComputerModel::handleComputerStateChanged);
+    connect(m_ComputerManager, &ComputerManager::computerAdded,
+            this, &ComputerModel::handleComputerAdded);
+    connect(m_ComputerManager, &ComputerManager::computerRemoved,
+            this, &ComputerModel::handleComputerRemoved);
+    connect(m_ComputerManager, &ComputerManager::computerMoved,
+            this, &ComputerModel::handleComputerMoved);
     connect(m_ComputerManager, &ComputerManager::pairingCompleted,
             this, &ComputerModel::handlePairingCompleted);
 
@@ -141,15 +147,9 @@ void ComputerModel::deleteComputer(int computerIndex)
 {
     Q_ASSERT(computerIndex < m_Computers.count());
 
-    beginRemoveRows(QModelIndex(), computerIndex, computerIndex);
-
-    // m_Computer[computerIndex] will be deleted by this call
+    // m_Computer[computerIndex] will be deleted by this call. Our row
+    // is removed when ComputerManager emits computerRemoved().
     m_ComputerManager->deleteHost(m_Computers[computerIndex]);
-
-    // Remove the now invalid item
-    m_Computers.removeAt(computerIndex);
-
-    endRemoveRows();
 }
 
 class DeferredWakeHostTask : public QRunnable
@@ -230,19 +230,39 @@ void ComputerModel::handlePairingCompleted(NvComputer*, QString error)
 
 void ComputerModel::handleComputerStateChanged(NvComputer* computer)
 {
-    QVector<NvComputer*> newComputerList = m_ComputerManager->getComputers();
-
-    // Reset the model if the structural layout of the list has changed
-    if (m_Computers != newComputerList) {
-        beginResetModel();
-        m_Computers = newComputerList;
-        endResetModel();
-    }
-    else {
-        // Let the view know that this specific computer changed
-        int index = m_Computers.indexOf(computer);
+    // Let the view know that this specific computer changed
+    int index = m_Computers.indexOf(computer);
+    if (index >= 0) {
         emit dataChanged(createIndex(index, 0), createIndex(index, 0));
     }
 }
 
+void ComputerModel::handleComputerAdded(NvComputer* computer, int index)
+{
+    beginInsertRows(QModelIndex(), index, index);
+    m_Computers.insert(index, computer);
+    endInsertRows();
+}
+
+void ComputerModel::handleComputerRemoved(NvComputer* computer, int index)
+{
+    Q_ASSERT(m_Computers[index] == computer);
+    Q_UNUSED(computer);
+
+    beginRemoveRows(QModelIndex(), index, index);
+    m_Computers.removeAt(index);
+    endRemoveRows();
+}
+
+void ComputerModel::handleComputerMoved(NvComputer* computer, int from, int to)
+{
+    Q_ASSERT(m_Computers[from] == computer);
+    Q_UNUSED(computer);
+
+    // The destination row is counted before the source row is removed
+    beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to);
+    m_Computers.move(from, to);
+    endMoveRows();
+}
+
 #include "computermodel.moc"
@@ -53,6 +53,12 @@ signals:
 private slots:
     void handleComputerStateChanged(NvComputer* computer);
 
+    void handleComputerAdded(NvComputer* computer, int index);
+
+    void handleComputerRemoved(NvComputer* computer, int index);
+
+    void handleComputerMoved(NvComputer* computer, int from, int to);
+
     void handlePairingCompleted(NvComputer* computer, QString error);
 
 private:
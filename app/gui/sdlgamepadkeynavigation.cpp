@@ -187,6 +187,9 @@ void SdlGamepadKeyNavigation::onPollingTimerFired()
             }
             break;
         }
+        case SDL_JOYDEVICEADDED:
+            MappingManager::handleJoystickArrival(&event.jdevice);
+            break;
         case SDL_CONTROLLERDEVICEADDED:
             SDL_GameController* gc = SDL_GameControllerOpen(event.cdevice.which);
             if (gc != nullptr) {
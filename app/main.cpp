@@ -12,6 +12,10 @@
 #include <QElapsedTimer>
 #include <QTemporaryFile>
 #include <QRegularExpression>
+#include <QQuickWindow>
+#include <QTimer>
+
+#include <memory>
 
 // Don't let SDL hook our main function, since Qt is already
 // doing the same thing. This needs to be before any headers
@@ -33,16 +37,20 @@
 #endif
 
 #include "cli/listapps.h"
+#include "cli/listhosts.h"
 #include "cli/quitstream.h"
 #include "cli/startstream.h"
 #include "cli/pair.h"
 #include "cli/commandlineparser.h"
 #include "path.h"
+#include "asynclogger.h"
+#include "startuptracer.h"
 #include "utils.h"
 #include "gui/computermodel.h"
 #include "gui/appmodel.h"
 #include "backend/autoupdatechecker.h"
 #include "backend/computermanager.h"
+#include "backend/boxartmanager.h"
 #include "backend/systemproperties.h"
 #include "streaming/session.h"
 #include "settings/streamingpreferences.h"
@@ -60,6 +68,9 @@
 // Log to console for debug Mac builds
 #endif
 
+// Maximum time to hold back deferred initialization if the UI never draws
+#define STARTUP_DEFER_TIMEOUT_MS 10000
+
 static QElapsedTimer s_LoggerTime;
 static QTextStream s_LoggerStream(stderr);
 static QMutex s_LoggerLock;
@@ -74,26 +85,9 @@ static bool s_LogLimitReached = false;
 static QFile* s_LoggerFile;
 #endif
 
-void logToLoggerStream(QString& message)
+// Runs on the AsyncLogger writer thread
+static void writeLogBatch(const QByteArray& batch)
 {
-    QMutexLocker lock(&s_LoggerLock);
-
-#if defined(QT_DEBUG) && defined(Q_OS_WIN32)
-    // Output log messages to a debugger if attached
-    if (IsDebuggerPresent()) {
-        static QString lineBuffer;
-        lineBuffer += message;
-        if (message.endsWith('\n')) {
-            OutputDebugStringW(lineBuffer.toStdWString().c_str());
-            lineBuffer.clear();
-        }
-    }
-#endif
-
-    // Strip session encryption keys and IVs from the logs
-    message.replace(k_RikeyRegex, "&rikey=REDACTED");
-    message.replace(k_RikeyIdRegex, "&rikeyid=REDACTED");
-
 #ifdef LOG_TO_FILE
     if (s_LogLimitReached) {
         return;
@@ -109,14 +103,40 @@ void logToLoggerStream(QString& message)
         return;
     }
     else {
-        s_LogBytesWritten += message.size();
+        s_LogBytesWritten += batch.size();
     }
 #endif
 
-    s_LoggerStream << message;
+    s_LoggerStream << QString::fromUtf8(batch);
     s_LoggerStream.flush();
 }
 
+void logToLoggerStream(QString& message)
+{
+#if defined(QT_DEBUG) && defined(Q_OS_WIN32)
+    // Output log messages to a debugger if attached
+    if (IsDebuggerPresent()) {
+        QMutexLocker lock(&s_LoggerLock);
+        static QString lineBuffer;
+        lineBuffer += message;
+        if (message.endsWith('\n')) {
+            OutputDebugStringW(lineBuffer.toStdWString().c_str());
+            lineBuffer.clear();
+        }
+    }
+#endif
+
+    // Strip session encryption keys and IVs from the logs. Only the launch
+    // request contains them, so skip the regexes for everything else.
+    if (message.contains("&rikey")) {
+        message.replace(k_RikeyRegex, "&rikey=REDACTED");
+        message.replace(k_RikeyIdRegex, "&rikeyid=REDACTED");
+    }
+
+    // This never blocks on I/O, since logging threads may be real-time
+    AsyncLogger::log(message);
+}
+
 void sdlLogToDiskHandler(void*, int category, SDL_LogPriority priority, const char* message)
 {
     QString priorityTxt;
@@ -198,6 +218,11 @@ void qtLogToDiskHandler(QtMsgType type, const QMessageLogContext&, const QString
     QString txt = QString("%1 - Qt %2: %3\n").arg(logTime.toString()).arg(typeTxt).arg(msg);
 
     logToLoggerStream(txt);
+
+    // Qt will abort after a fatal message, so write it out now
+    if (type == QtFatalMsg) {
+        AsyncLogger::flush();
+    }
 }
 
 #ifdef HAVE_FFMPEG
@@ -284,6 +309,9 @@ LONG WINAPI UnhandledExceptionHandler(struct _EXCEPTION_POINTERS *ExceptionInfo)
         qCritical() << "Unhandled exception! Failed to open dump file:" << qDmpFileName << "with error" << GetLastError();
     }
 
+    // The process is about to die, so write out the log before it does
+    AsyncLogger::flush();
+
     // Let the program crash and WER collect a dump
     return EXCEPTION_CONTINUE_SEARCH;
 }
@@ -292,6 +320,8 @@ LONG WINAPI UnhandledExceptionHandler(struct _EXCEPTION_POINTERS *ExceptionInfo)
 
 int main(int argc, char *argv[])
 {
+    StartupTracer::initialize();
+
     SDL_SetMainReady();
 
     // Set the app version for the QCommandLineParser's showVersion() command
@@ -345,6 +375,8 @@ int main(int argc, char *argv[])
 #endif
 
     s_LoggerTime.start();
+    AsyncLogger::start(writeLogBatch);
+    atexit(AsyncLogger::stop);
     qInstallMessageHandler(qtLogToDiskHandler);
     SDL_LogSetOutputFunction(sdlLogToDiskHandler, nullptr);
 
@@ -567,7 +599,9 @@ int main(int argc, char *argv[])
     SDL_SetHint(SDL_HINT_WINDOWS_DISABLE_THREAD_NAMING, "0");
 #endif
 
+    StartupTracer::Span appSpan("QGuiApplication");
     QGuiApplication app(argc, argv);
+    appSpan.end();
 
 #ifndef STEAM_LINK
     // Force use of the KMSDRM backend for SDL when using Qt platform plugins
@@ -620,7 +654,10 @@ int main(int argc, char *argv[])
                 runtimeVersion.major, runtimeVersion.minor, runtimeVersion.patch);
 
     // Apply the initial translation based on user preference
-    StreamingPreferences::get()->retranslate();
+    {
+        StartupTracer::Span span("Translations");
+        StreamingPreferences::get()->retranslate();
+    }
 
     // Trickily declare the translation for dialog buttons
     QCoreApplication::translate("QPlatformTheme", "&Yes");
@@ -686,6 +723,7 @@ int main(int argc, char *argv[])
     qmlRegisterSingletonType<ComputerManager>("ComputerManager", 1, 0,
                                               "ComputerManager",
                                               [](QQmlEngine* qmlEngine, QJSEngine*) -> QObject* {
+                                                  StartupTracer::Span span("ComputerManager");
                                                   return new ComputerManager(StreamingPreferences::get(qmlEngine));
                                               });
     qmlRegisterSingletonType<AutoUpdateChecker>("AutoUpdateChecker", 1, 0,
@@ -696,11 +734,13 @@ int main(int argc, char *argv[])
     qmlRegisterSingletonType<SystemProperties>("SystemProperties", 1, 0,
                                                "SystemProperties",
                                                [](QQmlEngine*, QJSEngine*) -> QObject* {
+                                                   StartupTracer::Span span("SystemProperties");
                                                    return new SystemProperties();
                                                });
     qmlRegisterSingletonType<SdlGamepadKeyNavigation>("SdlGamepadKeyNavigation", 1, 0,
                                                       "SdlGamepadKeyNavigation",
                                                       [](QQmlEngine* qmlEngine, QJSEngine*) -> QObject* {
+                                                          StartupTracer::Span span("SdlGamepadKeyNavigation");
                                                           return new SdlGamepadKeyNavigation(StreamingPreferences::get(qmlEngine));
                                                       });
     qmlRegisterSingletonType<StreamingPreferences>("StreamingPreferences", 1, 0,
@@ -709,8 +749,12 @@ int main(int argc, char *argv[])
                                                        return StreamingPreferences::get(qmlEngine);
                                                    });
 
-    // Create the identity manager on the main thread
-    IdentityManager::get();
+    // Create the identity manager on the main thread. If we need to generate
+    // new credentials, that happens in the background while the UI loads.
+    {
+        StartupTracer::Span span("IdentityManager");
+        IdentityManager::get();
+    }
 
     // We require the Material theme
     QQuickStyle::setStyle("Material");
@@ -768,8 +812,14 @@ int main(int argc, char *argv[])
         {
             ListCommandLineParser listParser;
             listParser.parse(app.arguments());
-            auto launcher = new CliListApps::Launcher(listParser.getHost(), listParser, &app);
-            launcher->execute(new ComputerManager(StreamingPreferences::get()));
+            if (listParser.isPrintJSON()) {
+                auto launcher = new CliListHosts::Launcher(listParser, &app);
+                launcher->execute(new ComputerManager(StreamingPreferences::get()));
+            }
+            else {
+                auto launcher = new CliListApps::Launcher(listParser.getHost(), listParser, &app);
+                launcher->execute(new ComputerManager(StreamingPreferences::get()));
+            }
             hasGUI = false;
             break;
         }
@@ -778,10 +828,33 @@ int main(int argc, char *argv[])
     if (hasGUI) {
         engine.rootContext()->setContextProperty("initialView", initialView);
 
+        // Serve box art thumbnails from our decoded image cache
+        BoxArtManager::initializeImageCache(StreamingPreferences::get()->boxArtCacheSizeMb);
+        engine.addImageProvider("boxart", new BoxArtImageProvider());
+
         // Load the main.qml file
+        StartupTracer::Span loadSpan("QML load");
         engine.load(QUrl(QStringLiteral("qrc:/gui/main.qml")));
         if (engine.rootObjects().isEmpty())
             return -1;
+        loadSpan.end();
+
+        // Deferred initialization runs once the first frame of the UI is on screen
+        QQuickWindow* window = qobject_cast<QQuickWindow*>(engine.rootObjects().first());
+        if (window != nullptr) {
+            auto frameConnection = std::make_shared<QMetaObject::Connection>();
+            *frameConnection = QObject::connect(window, &QQuickWindow::frameSwapped,
+                                                &app, [frameConnection] {
+                                                    QObject::disconnect(*frameConnection);
+                                                    StartupTracer::markInteractive();
+                                                }, Qt::QueuedConnection);
+        }
+
+        // Don't hold deferred work back forever if we never draw a frame
+        QTimer::singleShot(STARTUP_DEFER_TIMEOUT_MS, &StartupTracer::markInteractive);
+    }
+    else {
+        StartupTracer::markInteractive();
     }
 
     int err = app.exec();
@@ -1,7 +1,13 @@
 #include "mappingmanager.h"
 #include "path.h"
+#include "startuptracer.h"
 
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 
 #include <SDL.h>
 
@@ -10,16 +16,32 @@
 #define SER_GUID "guid"
 #define SER_MAPPING "mapping"
 
+#define MAPPING_DB_FILE "gamecontrollerdb.txt"
+#define COMPILED_MAPPING_DB_FILE "gamecontrollerdb.bin"
+
+#define COMPILED_MAPPING_DB_MAGIC 0x4D4C4743
+#define COMPILED_MAPPING_DB_VERSION 1
+
 MappingFetcher* MappingManager::s_MappingFetcher;
+bool MappingManager::s_MappingFetchQueued;
+QMutex MappingManager::s_CompiledMappingsLock;
+QString MappingManager::s_CompiledMappingsSource;
+QHash<QString, QString> MappingManager::s_CompiledMappings;
+bool MappingManager::s_UserMappingGuidsLoaded;
+QSet<QString> MappingManager::s_UserMappingGuids;
 
 MappingManager::MappingManager()
 {
     QSettings settings;
 
-    // Load updated mappings from the Internet once per Moonlight launch
-    if (s_MappingFetcher == nullptr) {
-        s_MappingFetcher = new MappingFetcher();
-        s_MappingFetcher->start();
+    // Load updated mappings from the Internet once per Moonlight launch,
+    // but wait until the UI is up since they're only needed for streaming
+    if (!s_MappingFetchQueued) {
+        s_MappingFetchQueued = true;
+        StartupTracer::runWhenInteractive(QCoreApplication::instance(), [] {
+            s_MappingFetcher = new MappingFetcher();
+            s_MappingFetcher->start();
+        });
     }
 
     // First load existing saved mappings. This ensures the user's
@@ -33,6 +55,8 @@ MappingManager::MappingManager()
     }
     settings.endArray();
 
+    QMap<QString, SdlGamepadMapping> savedMappings = m_Mappings;
+
     // Finally load mappings from SDL_HINT_GAMECONTROLLERCONFIG
     QStringList sdlMappings =
             QString::fromLocal8Bit(SDL_GetHint(SDL_HINT_GAMECONTROLLERCONFIG))
@@ -46,8 +70,25 @@ MappingManager::MappingManager()
         addMapping(mapping);
     }
 
-    // Save the updated mappings to settings
-    save();
+    // Save the updated mappings to settings if the hints changed anything
+    if (m_Mappings != savedMappings) {
+        save();
+    }
+    else {
+        updateUserMappingGuids();
+    }
+}
+
+void MappingManager::updateUserMappingGuids()
+{
+    QSet<QString> guids;
+    for (const QString& guid : m_Mappings.keys()) {
+        guids.insert(guid);
+    }
+
+    QMutexLocker locker(&s_CompiledMappingsLock);
+    s_UserMappingGuids = guids;
+    s_UserMappingGuidsLoaded = true;
 }
 
 void MappingManager::save()
@@ -64,38 +105,223 @@ void MappingManager::save()
         settings.setValue(SER_MAPPING, mappings[i].getMapping());
     }
     settings.endArray();
+
+    updateUserMappingGuids();
 }
 
-void MappingManager::applyMappings()
+bool MappingManager::compileMappings(QString sourcePath, QHash<QString, QString>& mappings)
 {
-    QByteArray mappingData = Path::readDataFile("gamecontrollerdb.txt");
-    if (!mappingData.isEmpty()) {
-        int newMappings = SDL_GameControllerAddMappingsFromRW(
-                    SDL_RWFromConstMem(mappingData.constData(), mappingData.size()), 1);
+    QFile sourceFile(sourcePath);
+    if (sourcePath.isEmpty() || !sourceFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
 
-        if (newMappings > 0) {
-            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
-                        "Loaded %d new gamepad mappings",
-                        newMappings);
+    // Like SDL_GameControllerAddMappingsFromRW(), only mappings that specify
+    // our platform are used. Later mappings replace earlier ones for a GUID.
+    QString platformField = QString("platform:%1,").arg(SDL_GetPlatform());
+    while (!sourceFile.atEnd()) {
+        QString line = QString::fromUtf8(sourceFile.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
         }
-        else {
-            if (newMappings < 0) {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                             "Error loading gamepad mappings: %s",
-                             SDL_GetError());
-            }
-            else if (newMappings == 0) {
-                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
-                            "0 new mappings found in gamecontrollerdb.txt. Is it corrupt?");
+
+        if (!line.endsWith(',')) {
+            line += ',';
+        }
+
+        if (!line.contains(platformField, Qt::CaseInsensitive)) {
+            continue;
+        }
+
+        mappings[line.section(',', 0, 0).toLower()] = line;
+    }
+
+    return true;
+}
+
+void MappingManager::loadCompiledMappings()
+{
+    QString sourcePath = Path::getDataFilePath(MAPPING_DB_FILE);
+    QFileInfo sourceInfo(sourcePath);
+
+    // The compiled index is only valid for the exact source file it was built from
+    QString source = QString("%1|%2|%3|%4|%5")
+            .arg(VERSION_STR, SDL_GetPlatform(), sourcePath)
+            .arg(sourceInfo.size())
+            .arg(sourceInfo.lastModified().toMSecsSinceEpoch());
+
+    QMutexLocker locker(&s_CompiledMappingsLock);
+
+    if (source == s_CompiledMappingsSource) {
+        return;
+    }
+
+    QHash<QString, QString> mappings;
+    bool loaded = false;
+
+    QFile compiledFile(Path::getCacheFileInfo(COMPILED_MAPPING_DB_FILE).absoluteFilePath());
+    if (compiledFile.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&compiledFile);
+        stream.setVersion(QDataStream::Qt_5_9);
+
+        quint32 magic = 0, version = 0;
+        QString compiledSource;
+        stream >> magic >> version;
+        if (magic == COMPILED_MAPPING_DB_MAGIC && version == COMPILED_MAPPING_DB_VERSION) {
+            stream >> compiledSource;
+            if (compiledSource == source) {
+                stream >> mappings;
+                loaded = stream.status() == QDataStream::Ok && !mappings.isEmpty();
             }
+        }
+        compiledFile.close();
+    }
+
+    if (!loaded) {
+        mappings.clear();
+        if (!compileMappings(sourcePath, mappings)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "Unable to load gamepad mapping file");
+        }
+        else if (mappings.isEmpty()) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                        "0 mappings found in gamecontrollerdb.txt. Is it corrupt?");
 
             // Try deleting the cached mapping list just in case it's corrupt
-            Path::deleteCacheFile("gamecontrollerdb.txt");
+            Path::deleteCacheFile(MAPPING_DB_FILE);
+        }
+        else {
+            QByteArray data;
+            QDataStream stream(&data, QIODevice::WriteOnly);
+            stream.setVersion(QDataStream::Qt_5_9);
+            stream << (quint32)COMPILED_MAPPING_DB_MAGIC << (quint32)COMPILED_MAPPING_DB_VERSION
+                   << source << mappings;
+            Path::writeCacheFile(COMPILED_MAPPING_DB_FILE, data);
+
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Compiled %d gamepad mappings",
+                        mappings.count());
         }
     }
-    else {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "Unable to load gamepad mapping file");
+
+    s_CompiledMappings = mappings;
+    s_CompiledMappingsSource = source;
+}
+
+QString MappingManager::findCompiledMapping(QString guid)
+{
+    QMutexLocker locker(&s_CompiledMappingsLock);
+
+    guid = guid.toLower();
+
+    auto it = s_CompiledMappings.constFind(guid);
+    if (it != s_CompiledMappings.constEnd()) {
+        return it.value();
+    }
+
+    // Like SDL, fall back to matching without the CRC and version fields
+    if (guid.length() == 32) {
+        QString noCrc = QString(guid).replace(4, 4, "0000");
+        QString noVersion = QString(guid).replace(24, 4, "0000");
+        QString noCrcOrVersion = QString(noCrc).replace(24, 4, "0000");
+
+        for (const QString& candidate : { noCrc, noVersion, noCrcOrVersion }) {
+            it = s_CompiledMappings.constFind(candidate);
+            if (it != s_CompiledMappings.constEnd()) {
+                return it.value();
+            }
+        }
+    }
+
+    return QString();
+}
+
+bool MappingManager::applyMappingForDevice(int deviceIndex)
+{
+    char guidStr[33];
+    SDL_JoystickGetGUIDString(SDL_JoystickGetDeviceGUID(deviceIndex),
+                              guidStr, sizeof(guidStr));
+
+    bool compiledMappingsLoaded;
+    {
+        QMutexLocker locker(&s_CompiledMappingsLock);
+
+        // Saved user mappings are added by applyMappings() and always win
+        if (s_UserMappingGuids.contains(guidStr)) {
+            return false;
+        }
+
+        // This is normally already loaded by applyMappings()
+        compiledMappingsLoaded = !s_CompiledMappingsSource.isEmpty();
+    }
+    if (!compiledMappingsLoaded) {
+        loadCompiledMappings();
+    }
+
+    QString sdlMappingString = findCompiledMapping(guidStr);
+    if (sdlMappingString.isEmpty()) {
+        return false;
+    }
+
+    int ret = SDL_GameControllerAddMapping(qPrintable(sdlMappingString));
+    if (ret < 0) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Unable to add mapping: %s",
+                    qPrintable(sdlMappingString));
+        return false;
+    }
+    else if (ret == 1) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Loaded gamepad mapping for %s",
+                    guidStr);
+    }
+
+    return true;
+}
+
+bool MappingManager::handleJoystickArrival(const SDL_JoyDeviceEvent* event)
+{
+    SDL_assert(event->type == SDL_JOYDEVICEADDED);
+
+    // Database mappings are only applied when a device arrives, so
+    // SDL may not recognize this joystick as a gamepad until now.
+    if (SDL_IsGameController(event->which)) {
+        return false;
+    }
+
+    // The user mappings are cached by the MappingManager that applied
+    // them when the gamecontroller subsystem was initialized
+    bool userMappingGuidsLoaded;
+    {
+        QMutexLocker locker(&s_CompiledMappingsLock);
+        userMappingGuidsLoaded = s_UserMappingGuidsLoaded;
+    }
+    if (!userMappingGuidsLoaded) {
+        MappingManager mappingManager;
+    }
+
+    if (!applyMappingForDevice(event->which) || !SDL_IsGameController(event->which)) {
+        return false;
+    }
+
+    // Post the arrival so it's delivered to the input thread if active
+    SDL_Event controllerEvent = {};
+    controllerEvent.cdevice.type = SDL_CONTROLLERDEVICEADDED;
+    controllerEvent.cdevice.timestamp = event->timestamp;
+    controllerEvent.cdevice.which = event->which;
+    SDL_PushEvent(&controllerEvent);
+    return true;
+}
+
+void MappingManager::applyMappings()
+{
+    loadCompiledMappings();
+
+    // Database mappings are only added for attached devices. Devices that
+    // arrive later are handled by handleJoystickArrival().
+    int joystickCount = SDL_NumJoysticks();
+    for (int i = 0; i < joystickCount; i++) {
+        applyMappingForDevice(i);
     }
 
     QList<SdlGamepadMapping> mappings = m_Mappings.values();
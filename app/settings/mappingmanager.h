@@ -3,6 +3,11 @@
 #include "mappingfetcher.h"
 
 #include <QSettings>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+
+#include <SDL.h>
 
 class SdlGamepadMapping
 {
@@ -70,9 +75,37 @@ public:
 
     void save();
 
+    // Applies the database mapping for a newly attached joystick. Returns
+    // true if the joystick became a gamepad and an SDL_CONTROLLERDEVICEADDED
+    // event was posted for it.
+    static
+    bool handleJoystickArrival(const SDL_JoyDeviceEvent* event);
+
 private:
+    // Adds the database mapping for a device without a user mapping.
+    // Returns true if a mapping for this device was added to SDL.
+    static
+    bool applyMappingForDevice(int deviceIndex);
+
+    void updateUserMappingGuids();
+
+    // Loads the compiled gamecontrollerdb.txt index, recompiling it if
+    // the source file has changed since it was last compiled
+    static void loadCompiledMappings();
+
+    static bool compileMappings(QString sourcePath, QHash<QString, QString>& mappings);
+
+    static QString findCompiledMapping(QString guid);
+
     QMap<QString, SdlGamepadMapping> m_Mappings;
 
     static MappingFetcher* s_MappingFetcher;
+    static bool s_MappingFetchQueued;
+
+    static QMutex s_CompiledMappingsLock;
+    static QString s_CompiledMappingsSource; // Protected by s_CompiledMappingsLock
+    static QHash<QString, QString> s_CompiledMappings; // Protected by s_CompiledMappingsLock
+    static bool s_UserMappingGuidsLoaded; // Protected by s_CompiledMappingsLock
+    static QSet<QString> s_UserMappingGuids; // Protected by s_CompiledMappingsLock
 };
 
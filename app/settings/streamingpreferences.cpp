@@ -49,8 +49,13 @@
 #define SER_LANGUAGE "language"
 #define SER_COMBINEJOYCONS "combinejoycons"
 #define SER_VERTICALJOYCONS "verticaljoycons"
+#define SER_GAMEPADSENDRATE "gamepadsendrate"
 #define SER_CEMUHOOKSERVER "cemuhookserver"
+#define SER_CEMUHOOKRATE "cemuhookrate"
 #define SER_VBANEMITTER "vbanemitter"
+#define SER_VBANGATEMODE "vbangatemode"
+#define SER_VBANGATETHRESHOLD "vbangatethreshold"
+#define SER_BOXARTCACHESIZE "boxartcachesize"
 
 #define CURRENT_DEFAULT_VER 2
 
@@ -163,8 +168,14 @@ void StreamingPreferences::reload()
                                                     static_cast<int>(Language::LANG_AUTO)).toInt());
     combineJoyCons = settings.value(SER_COMBINEJOYCONS, true).toBool();
     verticalJoyCons = settings.value(SER_VERTICALJOYCONS, false).toBool();
+    gamepadSendRate = settings.value(SER_GAMEPADSENDRATE, 500).toInt();
     cemuhookServer = settings.value(SER_CEMUHOOKSERVER, false).toBool();
+    cemuhookRate = settings.value(SER_CEMUHOOKRATE, 250).toInt();
     vbanEmitter = settings.value(SER_VBANEMITTER, false).toBool();
+    vbanGateMode = static_cast<VbanGateMode>(settings.value(SER_VBANGATEMODE,
+                                                            static_cast<int>(VbanGateMode::VGM_OFF)).toInt());
+    vbanGateThreshold = settings.value(SER_VBANGATETHRESHOLD, -50).toInt();
+    boxArtCacheSizeMb = settings.value(SER_BOXARTCACHESIZE, 64).toInt();
 
 
     // Perform default settings updates as required based on last default version
@@ -345,8 +356,13 @@ void StreamingPreferences::save()
     settings.setValue(SER_KEEPAWAKE, keepAwake);
     settings.setValue(SER_COMBINEJOYCONS, combineJoyCons);
     settings.setValue(SER_VERTICALJOYCONS, verticalJoyCons);
+    settings.setValue(SER_GAMEPADSENDRATE, gamepadSendRate);
     settings.setValue(SER_CEMUHOOKSERVER, cemuhookServer);
+    settings.setValue(SER_CEMUHOOKRATE, cemuhookRate);
     settings.setValue(SER_VBANEMITTER, vbanEmitter);
+    settings.setValue(SER_VBANGATEMODE, static_cast<int>(vbanGateMode));
+    settings.setValue(SER_VBANGATETHRESHOLD, vbanGateThreshold);
+    settings.setValue(SER_BOXARTCACHESIZE, boxArtCacheSizeMb);
 }
 
 int StreamingPreferences::getDefaultBitrate(int width, int height, int fps)
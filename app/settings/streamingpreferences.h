@@ -104,6 +104,15 @@ public:
     };
     Q_ENUM(CaptureSysKeysMode);
 
+    // Must match Vban::Emitter::GateMode
+    enum VbanGateMode
+    {
+        VGM_OFF,
+        VGM_SILENCE,
+        VGM_KEEPALIVE,
+    };
+    Q_ENUM(VbanGateMode);
+
     Q_PROPERTY(int width MEMBER width NOTIFY displayModeChanged)
     Q_PROPERTY(int height MEMBER height NOTIFY displayModeChanged)
     Q_PROPERTY(int fps MEMBER fps NOTIFY displayModeChanged)
@@ -139,8 +148,13 @@ public:
     Q_PROPERTY(Language language MEMBER language NOTIFY languageChanged)
     Q_PROPERTY(bool combineJoyCons MEMBER combineJoyCons NOTIFY combineJoyConsChanged)
     Q_PROPERTY(bool verticalJoyCons MEMBER verticalJoyCons NOTIFY verticalJoyConsChanged)
+    Q_PROPERTY(int gamepadSendRate MEMBER gamepadSendRate NOTIFY gamepadSendRateChanged)
     Q_PROPERTY(bool cemuhookServer MEMBER cemuhookServer NOTIFY cemuhookServerChanged)
+    Q_PROPERTY(int cemuhookRate MEMBER cemuhookRate NOTIFY cemuhookRateChanged)
     Q_PROPERTY(bool vbanEmitter MEMBER vbanEmitter NOTIFY vbanEmitterChanged);
+    Q_PROPERTY(VbanGateMode vbanGateMode MEMBER vbanGateMode NOTIFY vbanGateModeChanged);
+    Q_PROPERTY(int vbanGateThreshold MEMBER vbanGateThreshold NOTIFY vbanGateThresholdChanged);
+    Q_PROPERTY(int boxArtCacheSizeMb MEMBER boxArtCacheSizeMb NOTIFY boxArtCacheSizeMbChanged)
 
     Q_INVOKABLE bool retranslate();
 
@@ -181,8 +195,13 @@ public:
     CaptureSysKeysMode captureSysKeysMode;
     bool combineJoyCons;
     bool verticalJoyCons;
+    int gamepadSendRate;
     bool cemuhookServer;
+    int cemuhookRate;
     bool vbanEmitter;
+    VbanGateMode vbanGateMode;
+    int vbanGateThreshold;
+    int boxArtCacheSizeMb;
 
 signals:
     void displayModeChanged();
@@ -218,8 +237,13 @@ signals:
     void languageChanged();
     void combineJoyConsChanged();
     void verticalJoyConsChanged();
+    void gamepadSendRateChanged();
     void cemuhookServerChanged();
+    void cemuhookRateChanged();
     void vbanEmitterChanged();
+    void vbanGateModeChanged();
+    void vbanGateThresholdChanged();
+    void boxArtCacheSizeMbChanged();
 
 private:
     explicit StreamingPreferences(QQmlEngine *qmlEngine);
@@ -0,0 +1,148 @@
+#include "startuptracer.h"
+
+#include <QtDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QTimer>
+
+QElapsedTimer StartupTracer::s_Timer;
+QMutex StartupTracer::s_Lock;
+QVector<StartupTracer::Event> StartupTracer::s_Events;
+QVector<StartupTracer::DeferredWork> StartupTracer::s_DeferredWork;
+bool StartupTracer::s_Interactive;
+qint64 StartupTracer::s_InteractiveUs;
+
+StartupTracer::Span::Span(const char* name)
+    : m_Name(name),
+      m_StartUs(s_Timer.nsecsElapsed() / 1000),
+      m_Ended(false)
+{
+}
+
+StartupTracer::Span::~Span()
+{
+    end();
+}
+
+void StartupTracer::Span::end()
+{
+    if (m_Ended) {
+        return;
+    }
+
+    m_Ended = true;
+
+    Event event;
+    event.name = m_Name;
+    event.startUs = m_StartUs;
+    event.durationUs = s_Timer.nsecsElapsed() / 1000 - m_StartUs;
+    event.threadId = (quintptr)QThread::currentThreadId();
+
+    qInfo().nospace() << "Startup: " << m_Name << " took " << event.durationUs / 1000 << " ms";
+
+    QVector<Event> events;
+    qint64 interactiveUs;
+    {
+        QMutexLocker lock(&s_Lock);
+        s_Events.append(event);
+
+        // Later spans (like stream launches) are added to the saved timeline
+        if (!s_Interactive || !qEnvironmentVariableIsSet("MOONLIGHT_STARTUP_TRACE")) {
+            return;
+        }
+
+        events = s_Events;
+        interactiveUs = s_InteractiveUs;
+    }
+
+    writeTraceFile(events, interactiveUs);
+}
+
+void StartupTracer::initialize()
+{
+    s_Timer.start();
+}
+
+void StartupTracer::markInteractive()
+{
+    QVector<DeferredWork> deferredWork;
+    QVector<Event> events;
+    qint64 interactiveUs = s_Timer.nsecsElapsed() / 1000;
+
+    {
+        QMutexLocker lock(&s_Lock);
+
+        if (s_Interactive) {
+            return;
+        }
+
+        s_Interactive = true;
+        s_InteractiveUs = interactiveUs;
+        deferredWork = s_DeferredWork;
+        s_DeferredWork.clear();
+        events = s_Events;
+    }
+
+    qInfo() << "Startup: interactive after" << interactiveUs / 1000 << "ms";
+
+    if (qEnvironmentVariableIsSet("MOONLIGHT_STARTUP_TRACE")) {
+        writeTraceFile(events, interactiveUs);
+    }
+
+    for (const DeferredWork& work : deferredWork) {
+        if (!work.context.isNull()) {
+            QTimer::singleShot(0, work.context, work.function);
+        }
+    }
+}
+
+void StartupTracer::runWhenInteractive(QObject* context, std::function<void()> function)
+{
+    QMutexLocker lock(&s_Lock);
+
+    if (s_Interactive) {
+        QTimer::singleShot(0, context, function);
+    }
+    else {
+        DeferredWork work;
+        work.context = context;
+        work.function = function;
+        s_DeferredWork.append(work);
+    }
+}
+
+void StartupTracer::writeTraceFile(const QVector<Event>& events, qint64 interactiveUs)
+{
+    QJsonArray traceEvents;
+
+    for (const Event& event : events) {
+        QJsonObject traceEvent;
+        traceEvent["name"] = event.name;
+        traceEvent["ph"] = "X";
+        traceEvent["ts"] = event.startUs;
+        traceEvent["dur"] = event.durationUs;
+        traceEvent["pid"] = 1;
+        traceEvent["tid"] = QString::number(event.threadId);
+        traceEvents.append(traceEvent);
+    }
+
+    QJsonObject interactiveEvent;
+    interactiveEvent["name"] = "Interactive";
+    interactiveEvent["ph"] = "i";
+    interactiveEvent["s"] = "g";
+    interactiveEvent["ts"] = interactiveUs;
+    interactiveEvent["pid"] = 1;
+    traceEvents.append(interactiveEvent);
+
+    QFile traceFile(QString::fromLocal8Bit(qgetenv("MOONLIGHT_STARTUP_TRACE")));
+    if (traceFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        traceFile.write(QJsonDocument(traceEvents).toJson());
+        qInfo() << "Wrote startup trace to" << traceFile.fileName();
+    }
+    else {
+        qWarning() << "Unable to write startup trace:" << traceFile.errorString();
+    }
+}
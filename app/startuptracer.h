@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QPointer>
+#include <QVector>
+
+#include <functional>
+
+// Records a timeline of the work done before the UI becomes interactive
+// and holds back non-essential initialization until that point.
+//
+// Spans are written to the log as they complete. If MOONLIGHT_STARTUP_TRACE
+// is set to a file path, the timeline is also saved there in Chrome trace
+// event format once startup is complete, and updated as later spans end.
+class StartupTracer
+{
+public:
+    // Records the time between construction and end() or destruction
+    class Span
+    {
+    public:
+        explicit Span(const char* name);
+        ~Span();
+
+        void end();
+
+    private:
+        const char* m_Name;
+        qint64 m_StartUs;
+        bool m_Ended;
+    };
+
+    // Must be called first thing in main()
+    static void initialize();
+
+    // Called when the first frame of the UI has been presented, or when the
+    // event loop starts for commands without a UI. Runs deferred work.
+    static void markInteractive();
+
+    // Runs the function on the context object's thread once startup is
+    // complete. If it already is, the function is run on the next event
+    // loop iteration.
+    static void runWhenInteractive(QObject* context, std::function<void()> function);
+
+private:
+    struct Event
+    {
+        const char* name;
+        qint64 startUs;
+        qint64 durationUs;
+        quintptr threadId;
+    };
+
+    struct DeferredWork
+    {
+        QPointer<QObject> context;
+        std::function<void()> function;
+    };
+
+    static void writeTraceFile(const QVector<Event>& events, qint64 interactiveUs);
+
+    static QElapsedTimer s_Timer;
+    static QMutex s_Lock;
+    static QVector<Event> s_Events; // Protected by s_Lock
+    static QVector<DeferredWork> s_DeferredWork; // Protected by s_Lock
+    static bool s_Interactive; // Protected by s_Lock
+    static qint64 s_InteractiveUs; // Protected by s_Lock
+};
@@ -2,6 +2,9 @@
 
 #include "input/input.h"
 
+#include <QThread>
+#include <QTimerEvent>
+
 namespace Cemuhook {
 
 const QMap<SDL_JoystickPowerLevel, SharedResponse::Battery> SharedResponse::k_BatteryMap = {
@@ -44,7 +47,117 @@ bool MotionState::updateByControllerSensorEvent(SDL_ControllerSensorEvent* event
     return accelUpdated && gyroUpdated;
 }
 
-void Server::init(const QHostAddress& addr, uint16_t port, QObject *parent) {
+static_assert(Server::MAX_SLOTS == MAX_GAMEPADS, "Cemuhook slots must match gamepad slots");
+
+// Clients and their subscriptions expire after this long without a request
+static constexpr uint32_t CHECK_TIMEOUT = 5000;
+
+// Data packets beyond this rate to a single client are dropped. This covers
+// four pads at the default rate, and a client may burst one packet per slot.
+static constexpr uint32_t MAX_DATA_PACKETS_PER_SECOND = 1000;
+static constexpr uint32_t MAX_DATA_PACKET_BURST = Server::MAX_SLOTS;
+
+static constexpr int MAX_CLIENTS = 8;
+
+static inline
+bool isActive(uint32_t timestamp, uint32_t curTimestamp) {
+    return timestamp != 0 && curTimestamp - timestamp <= CHECK_TIMEOUT;
+}
+
+bool Server::Client::subscribe(const Request::DataRequest& request, uint32_t curTimestamp) {
+    bool isNewSubscription = false;
+
+    // A zero bitmask subscribes to all slots. Otherwise, bit 0 selects
+    // the slot-based registration and bit 1 the MAC-based one.
+    if (request.bitmask == 0) {
+        isNewSubscription |= !isActive(allSlotsTimestamp, curTimestamp);
+        allSlotsTimestamp = curTimestamp;
+    }
+
+    if ((request.bitmask & 0x1) && request.slot < MAX_SLOTS) {
+        isNewSubscription |= !isActive(slotTimestamps[request.slot], curTimestamp);
+        slotTimestamps[request.slot] = curTimestamp;
+    }
+
+    if (request.bitmask & 0x2) {
+        int freeIndex = -1;
+        int index = 0;
+        for (; index < MAX_SLOTS; ++index) {
+            if (isActive(macs[index].timestamp, curTimestamp)) {
+                if (memcmp(macs[index].mac, request.mac, sizeof(request.mac)) == 0)
+                    break;
+            } else if (freeIndex < 0) {
+                freeIndex = index;
+            }
+        }
+
+        if (index == MAX_SLOTS) {
+            index = freeIndex;
+            isNewSubscription = true;
+        }
+
+        if (index >= 0) {
+            memcpy(macs[index].mac, request.mac, sizeof(request.mac));
+            macs[index].timestamp = curTimestamp;
+        }
+    }
+
+    return isNewSubscription;
+}
+
+bool Server::Client::isSubscribed(uint8_t slot, const uint8_t* mac, uint32_t curTimestamp) const {
+    if (isActive(allSlotsTimestamp, curTimestamp) || isActive(slotTimestamps[slot], curTimestamp))
+        return true;
+
+    for (int index = 0; index < MAX_SLOTS; ++index) {
+        if (isActive(macs[index].timestamp, curTimestamp) &&
+            memcmp(macs[index].mac, mac, sizeof(macs[index].mac)) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+bool Server::Client::allowSend(uint32_t curTimestamp) {
+    // Refill one packet per 1000 credits, up to the burst size
+    uint32_t elapsed = qMin(curTimestamp - sendCreditTimestamp, (uint32_t)1000);
+    sendCreditTimestamp = curTimestamp;
+    sendCredit = qMin(sendCredit + elapsed * MAX_DATA_PACKETS_PER_SECOND, MAX_DATA_PACKET_BURST * 1000);
+
+    if (sendCredit < 1000)
+        return false;
+
+    sendCredit -= 1000;
+    return true;
+}
+
+void Server::Slot::publish() {
+    // An odd sequence number marks a write in progress
+    int seq = SDL_AtomicGet(&sequence);
+    SDL_AtomicSet(&sequence, seq + 1);
+    SDL_MemoryBarrierRelease();
+    memcpy(&shared, &local, sizeof(shared));
+
+    // The slot contents must be visible before the even sequence number
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&sequence, seq + 2);
+}
+
+int Server::Slot::read(PadState& state) const {
+    for (;;) {
+        int before = SDL_AtomicGet(const_cast<SDL_atomic_t*>(&sequence));
+        if (before & 1)
+            continue;
+
+        memcpy(&state, &shared, sizeof(state));
+        SDL_MemoryBarrierAcquire();
+
+        if (SDL_AtomicGet(const_cast<SDL_atomic_t*>(&sequence)) == before)
+            return before;
+    }
+}
+
+void Server::init(const QHostAddress& addr, uint16_t port, int rateHz, QObject *parent) {
     if (s_Server)
         destroy();
 
@@ -52,13 +165,14 @@ void Server::init(const QHostAddress& addr, uint16_t port, QObject *parent) {
     s_Server->bind(addr, port);
 
     constexpr int CHECK_INTERVAL = 3000;
-    s_Server->startTimer(CHECK_INTERVAL);
+    s_Server->m_CheckTimerId = s_Server->startTimer(CHECK_INTERVAL);
+    s_Server->m_SendTimerId = s_Server->startTimer(qMax(1, 1000 / qMax(1, rateHz)), Qt::PreciseTimer);
 
     s_Thread = new QThread();
     s_Server->moveToThread(s_Thread);
     s_Thread->start();
 
-    qInfo("[CemuHook Server] Initialized successfully.");
+    qInfo("[CemuHook Server] Initialized successfully. Rate: %d Hz", rateHz);
 }
 
 void Server::destroy() {
@@ -76,24 +190,79 @@ void Server::destroy() {
     qInfo("[CemuHook Server] Destroyed successfully.");
 }
 
+uint16_t Server::boundPort() {
+    return s_Server ? s_Server->localPort() : 0;
+}
+
+void Server::connectSlot(GamepadState* state) {
+    // The server only exists if it was enabled in the preferences
+    if (!s_Server || state->index < 0 || state->index >= MAX_SLOTS)
+        return;
+
+    // The MAC and battery level are cached here, so the sender
+    // never has to query SDL for them.
+    PadState& pad = s_Server->m_Slots[state->index].local;
+    SDL_zero(pad);
+    pad.connected = true;
+    pad.deviceModel = state->motionState.deviceModel;
+
+    SDL_Joystick* joystick = SDL_GameControllerGetJoystick(state->controller);
+    if (const char* serial = SDL_JoystickGetSerial(joystick)) {
+        sscanf_s(serial, "%hhx-%hhx-%hhx-%hhx-%hhx-%hhx",
+                 &pad.mac[0], &pad.mac[1], &pad.mac[2],
+                 &pad.mac[3], &pad.mac[4], &pad.mac[5]);
+    }
+
+    pad.battery = SharedResponse::k_BatteryMap[SDL_JoystickCurrentPowerLevel(joystick)];
+
+    s_Server->m_Slots[state->index].publish();
+}
+
+void Server::disconnectSlot(GamepadState* state) {
+    if (!s_Server || state->index < 0 || state->index >= MAX_SLOTS)
+        return;
+
+    PadState& pad = s_Server->m_Slots[state->index].local;
+    SDL_zero(pad);
+    s_Server->m_Slots[state->index].publish();
+}
+
+void Server::updateBattery(GamepadState* state, SDL_JoystickPowerLevel level) {
+    if (!s_Server || state->index < 0 || state->index >= MAX_SLOTS)
+        return;
+
+    s_Server->m_Slots[state->index].local.battery = SharedResponse::k_BatteryMap[level];
+    s_Server->m_Slots[state->index].publish();
+}
+
 void Server::send(GamepadState* state) {
-    if (!s_Server)
-        init();
+    if (!s_Server || state->index < 0 || state->index >= MAX_SLOTS)
+        return;
 
-    emit s_Server->sendSignal(*state);
+    PadState& pad = s_Server->m_Slots[state->index].local;
+    pad.deviceModel = state->motionState.deviceModel;
+    pad.buttons = state->buttons;
+    pad.lsX = state->lsX;
+    pad.lsY = state->lsY;
+    pad.rsX = state->rsX;
+    pad.rsY = state->rsY;
+    pad.lt = state->lt;
+    pad.rt = state->rt;
+    memcpy(&pad.motion, &state->motionState.motion, sizeof(pad.motion));
+
+    s_Server->m_Slots[state->index].publish();
 }
 
 Server::Server(QObject *parent) : QUdpSocket(parent),
-    m_ServerId(IdentityManager::get()->getUniqueId().toULongLong(nullptr, 16)) {
-    connect(this, &Server::readyRead, this, &Server::handleReceive);
+    m_ServerId(IdentityManager::get()->getUniqueId().toULongLong(nullptr, 16)),
+    m_CheckTimerId(0), m_SendTimerId(0) {
+    SDL_zero(m_Slots);
 
-    qRegisterMetaType<GamepadState>("GamepadState");
-    connect(this, &Server::sendSignal, this, &Server::handleSend);
+    connect(this, &Server::readyRead, this, &Server::handleReceive);
 }
 
 Server::~Server() {
     disconnect(this, &Server::readyRead, this, &Server::handleReceive);
-    disconnect(this, &Server::sendSignal, this, &Server::handleSend);
 }
 
 void Server::handleReceive() {
@@ -106,11 +275,20 @@ void Server::handleReceive() {
     if (strncmp(request.header.magic, "DSUC", 4) || request.header.version != VERSION)
         return;
 
+    if (request.header.length + 16 > sizeof(request))
+        return;
+
     uint32_t inCrc32 = request.header.crc32;
     request.header.crc32 = 0;
     if (SDL_crc32(0, &request, request.header.length + 16) != inCrc32)
         return;
 
+    // Only data subscriptions register a client. Version and info requests
+    // are answered directly, so other packets can't take up client slots.
+    uint32_t curTimestamp = SDL_GetTicks();
+    Client* client = findClient(inAddress, inPort, request.header.id, curTimestamp,
+                                request.header.eventType == Header::EventType::DATA_TYPE);
+
     switch (request.header.eventType) {
         case Header::EventType::VERSION_TYPE: {
             static VersionResponse response = {
@@ -152,33 +330,23 @@ void Server::handleReceive() {
                 }
             };
 
-            for (size_t i = 0; i < request.info.slotNumber; ++i) {
+            int32_t slotNumber = qBound(0, request.info.slotNumber, (int32_t)sizeof(request.info.slot));
+            for (int32_t i = 0; i < slotNumber; ++i) {
                 uint8_t slot = request.info.slot[i];
                 if (slot >= MAX_GAMEPADS)
                     continue;
 
+                PadState pad;
+                m_Slots[slot].read(pad);
+
                 response.shared.slot = slot;
-                if (SDL_Joystick* joystick = SDL_JoystickFromPlayerIndex(slot)) {
+                if (pad.connected) {
                     response.shared.slotState = SharedResponse::SlotState::CONNECTED;
-
-                    SDL_GameController* gameController = SDL_GameControllerFromInstanceID(
-                        SDL_JoystickInstanceID(joystick));
-                    if (SDL_GameControllerIsSensorEnabled(gameController, SDL_SENSOR_ACCEL) &&
-                        SDL_GameControllerIsSensorEnabled(gameController, SDL_SENSOR_GYRO)) {
-                        response.shared.deviceModel = SharedResponse::DeviceModel::FULL_GYRO;
-                    } else {
-                        response.shared.deviceModel = SharedResponse::DeviceModel::DO_NOT_USE;
-                    }
-
-                    if (const char* serial = SDL_JoystickGetSerial(joystick)) {
-                        sscanf_s(serial, "%hhx-%hhx-%hhx-%hhx-%hhx-%hhx",
-                                 &response.shared.mac[0], &response.shared.mac[1], &response.shared.mac[2],
-                                 &response.shared.mac[3], &response.shared.mac[4], &response.shared.mac[5]);
-                    } else {
-                        memset(response.shared.mac, 0, sizeof(response.shared.mac));
-                    }
-
-                    response.shared.battery = SharedResponse::k_BatteryMap[SDL_JoystickCurrentPowerLevel(joystick)];
+                    response.shared.deviceModel = pad.deviceModel == SharedResponse::DeviceModel::FULL_GYRO ?
+                                                  SharedResponse::DeviceModel::FULL_GYRO :
+                                                  SharedResponse::DeviceModel::DO_NOT_USE;
+                    memcpy(response.shared.mac, pad.mac, sizeof(response.shared.mac));
+                    response.shared.battery = pad.battery;
                 } else {
                     response.shared.slotState = SharedResponse::SlotState::NOT_CONNECTED;
                     response.shared.deviceModel = SharedResponse::DeviceModel::NOT_APPLICABLE;
@@ -194,26 +362,61 @@ void Server::handleReceive() {
         }
 
         case Header::EventType::DATA_TYPE: {
-            uint32_t curTimestamp = SDL_GetTicks();
-            bool isNewClient = true;
-            for (Client& client : m_Clients) {
-                if (client.address == inAddress && client.port == inPort) {
-                    client.lastTimestamp = curTimestamp;
-                    isNewClient = false;
-                }
-            }
-            if (isNewClient) {
-                m_Clients.append(Client {request.header.id, inAddress, inPort, 0, curTimestamp});
-
-                qInfo("[CemuHook Server] Request for data from new client [%s:%d].",
-                      qPrintable(inAddress.toString()), inPort);
+            if (!client)
+                break;
+
+            if (client->subscribe(request.data, curTimestamp)) {
+                qInfo("[CemuHook Server] New data subscription from client [%s:%d]: "
+                      "bitmask[%d] slot[%d] mac[%02x:%02x:%02x:%02x:%02x:%02x].",
+                      qPrintable(inAddress.toString()), inPort,
+                      request.data.bitmask, request.data.slot,
+                      request.data.mac[0], request.data.mac[1], request.data.mac[2],
+                      request.data.mac[3], request.data.mac[4], request.data.mac[5]);
+
+                // Send the current state so the new subscriber doesn't
+                // have to wait for the next change
+                for (int& lastSentSequence : client->lastSentSequences)
+                    lastSentSequence = -1;
             }
             break;
         }
     }
 }
 
-void Server::handleSend(const GamepadState& state) {
+Server::Client* Server::findClient(const QHostAddress& address, uint16_t port, uint32_t id, uint32_t curTimestamp, bool canRegister) {
+    for (Client& client : m_Clients) {
+        if (client.address == address && client.port == port) {
+            client.lastTimestamp = curTimestamp;
+            return &client;
+        }
+    }
+
+    if (!canRegister)
+        return nullptr;
+
+    if (m_Clients.size() >= MAX_CLIENTS) {
+        qWarning("[CemuHook Server] Ignoring client [%s:%d]: too many clients.",
+                 qPrintable(address.toString()), port);
+        return nullptr;
+    }
+
+    Client client {};
+    client.id = id;
+    client.address = address;
+    client.port = port;
+    client.lastTimestamp = curTimestamp;
+    client.sendCreditTimestamp = curTimestamp;
+    client.sendCredit = MAX_DATA_PACKET_BURST * 1000;
+    for (int& lastSentSequence : client.lastSentSequences)
+        lastSentSequence = -1;
+    m_Clients.append(client);
+
+    qInfo("[CemuHook Server] Request from new client [%s:%d].",
+          qPrintable(address.toString()), port);
+    return &m_Clients.last();
+}
+
+void Server::handleSend() {
     if (m_Clients.isEmpty()) {
         return;
     }
@@ -238,70 +441,111 @@ void Server::handleSend(const GamepadState& state) {
         }
     };
 
-    response.shared.slot = state.index;
-
-    response.shared.deviceModel = state.motionState.deviceModel;
-
-    SDL_Joystick* joystick = SDL_JoystickFromInstanceID(state.jsId);
-    if (const char* serial = SDL_JoystickGetSerial(joystick)) {
-        sscanf_s(serial, "%hhx-%hhx-%hhx-%hhx-%hhx-%hhx",
-                 &response.shared.mac[0], &response.shared.mac[1], &response.shared.mac[2],
-                 &response.shared.mac[3], &response.shared.mac[4], &response.shared.mac[5]);
-    } else {
-        memset(response.shared.mac, 0, sizeof(response.shared.mac));
-    }
-
-    response.shared.battery = SharedResponse::k_BatteryMap[SDL_JoystickCurrentPowerLevel(joystick)];
-
-    response.buttons = (state.buttons & BACK_FLAG ? 0x1 : 0) |
-                       (state.buttons & LS_CLK_FLAG ? 0x2 : 0) |
-                       (state.buttons & RS_CLK_FLAG ? 0x4 : 0) |
-                       (state.buttons & PLAY_FLAG ? 0x8 : 0) |
-                       (state.buttons & UP_FLAG ? 0x10 : 0) |
-                       (state.buttons & RIGHT_FLAG ? 0x20 : 0) |
-                       (state.buttons & DOWN_FLAG ? 0x40 : 0) |
-                       (state.buttons & LEFT_FLAG ? 0x80 : 0) |
-                       (state.lt > 0 ? 0x100 : 0) |
-                       (state.rt > 0 ? 0x200 : 0) |
-                       (state.buttons & LB_FLAG ? 0x400 : 0) |
-                       (state.buttons & RB_FLAG ? 0x800 : 0) |
-                       (state.buttons & X_FLAG ? 0x1000 : 0) |
-                       (state.buttons & A_FLAG ? 0x2000 : 0) |
-                       (state.buttons & B_FLAG ? 0x4000 : 0) |
-                       (state.buttons & Y_FLAG ? 0x8000 : 0);
-    response.homeButton = state.buttons & SPECIAL_FLAG ? 1 : 0;
-    response.lsX = (state.lsX >> 8) + 0x80;
-    response.lsY = (state.lsY >> 8) + 0x80;
-    response.rsX = (state.rsX >> 8) + 0x80;
-    response.rsY = (state.rsY >> 8) + 0x80;
-    response.adLeft = state.buttons & LEFT_FLAG ? 0xFF : 0;
-    response.adDown = state.buttons & DOWN_FLAG ? 0xFF : 0;
-    response.adRight = state.buttons & RIGHT_FLAG ? 0xFF : 0;
-    response.adUp = state.buttons & UP_FLAG ? 0xFF : 0;
-    response.aY = state.buttons & Y_FLAG ? 0xFF : 0;
-    response.aB = state.buttons & B_FLAG ? 0xFF : 0;
-    response.aA = state.buttons & A_FLAG ? 0xFF : 0;
-    response.aX = state.buttons & X_FLAG ? 0xFF : 0;
-    response.aR1 = state.buttons & RB_FLAG ? 0xFF : 0;
-    response.aL1 = state.buttons & LB_FLAG ? 0xFF : 0;
-    response.aR2 = state.rt;
-    response.aL2 = state.lt;
-
-    memcpy(&response.motion, &state.motionState.motion, sizeof(response.motion));
+    PadState state;
+    uint32_t curTimestamp = SDL_GetTicks();
+    for (uint8_t slot = 0; slot < MAX_SLOTS; ++slot) {
+        // Skip slots that every client already has the latest state for
+        int sequence = SDL_AtomicGet(&m_Slots[slot].sequence);
+        bool isPending = false;
+        for (const Client& client : m_Clients) {
+            if (client.lastSentSequences[slot] != sequence) {
+                isPending = true;
+                break;
+            }
+        }
+        if (!isPending)
+            continue;
+
+        sequence = m_Slots[slot].read(state);
+        if (!state.connected) {
+            // There's nothing to send until the pad connects again
+            for (Client& client : m_Clients)
+                client.lastSentSequences[slot] = sequence;
+            continue;
+        }
 
-    for (Client& client : m_Clients) {
-        response.packetNumber = client.packetNumber++;
+        // Don't build a packet that no client is waiting for. Clients that
+        // aren't subscribed get the current state when they subscribe.
+        bool isSubscribed = false;
+        for (const Client& client : m_Clients) {
+            if (client.lastSentSequences[slot] != sequence &&
+                client.isSubscribed(slot, state.mac, curTimestamp)) {
+                isSubscribed = true;
+                break;
+            }
+        }
+        if (!isSubscribed)
+            continue;
+
+        response.shared.slot = slot;
+        response.shared.deviceModel = state.deviceModel;
+        memcpy(response.shared.mac, state.mac, sizeof(response.shared.mac));
+        response.shared.battery = state.battery;
+
+        response.buttons = (state.buttons & BACK_FLAG ? 0x1 : 0) |
+                           (state.buttons & LS_CLK_FLAG ? 0x2 : 0) |
+                           (state.buttons & RS_CLK_FLAG ? 0x4 : 0) |
+                           (state.buttons & PLAY_FLAG ? 0x8 : 0) |
+                           (state.buttons & UP_FLAG ? 0x10 : 0) |
+                           (state.buttons & RIGHT_FLAG ? 0x20 : 0) |
+                           (state.buttons & DOWN_FLAG ? 0x40 : 0) |
+                           (state.buttons & LEFT_FLAG ? 0x80 : 0) |
+                           (state.lt > 0 ? 0x100 : 0) |
+                           (state.rt > 0 ? 0x200 : 0) |
+                           (state.buttons & LB_FLAG ? 0x400 : 0) |
+                           (state.buttons & RB_FLAG ? 0x800 : 0) |
+                           (state.buttons & X_FLAG ? 0x1000 : 0) |
+                           (state.buttons & A_FLAG ? 0x2000 : 0) |
+                           (state.buttons & B_FLAG ? 0x4000 : 0) |
+                           (state.buttons & Y_FLAG ? 0x8000 : 0);
+        response.homeButton = state.buttons & SPECIAL_FLAG ? 1 : 0;
+        response.lsX = (state.lsX >> 8) + 0x80;
+        response.lsY = (state.lsY >> 8) + 0x80;
+        response.rsX = (state.rsX >> 8) + 0x80;
+        response.rsY = (state.rsY >> 8) + 0x80;
+        response.adLeft = state.buttons & LEFT_FLAG ? 0xFF : 0;
+        response.adDown = state.buttons & DOWN_FLAG ? 0xFF : 0;
+        response.adRight = state.buttons & RIGHT_FLAG ? 0xFF : 0;
+        response.adUp = state.buttons & UP_FLAG ? 0xFF : 0;
+        response.aY = state.buttons & Y_FLAG ? 0xFF : 0;
+        response.aB = state.buttons & B_FLAG ? 0xFF : 0;
+        response.aA = state.buttons & A_FLAG ? 0xFF : 0;
+        response.aX = state.buttons & X_FLAG ? 0xFF : 0;
+        response.aR1 = state.buttons & RB_FLAG ? 0xFF : 0;
+        response.aL1 = state.buttons & LB_FLAG ? 0xFF : 0;
+        response.aR2 = state.rt;
+        response.aL2 = state.lt;
+
+        memcpy(&response.motion, &state.motion, sizeof(response.motion));
+
+        // The packet number is tracked per slot, so the packet and its
+        // checksum are built once and shared by every client.
+        response.packetNumber = m_Slots[slot].packetNumber++;
         response.header.crc32 = 0;
         response.header.crc32 = SDL_crc32(0, &response, sizeof(response));
-        writeDatagram(reinterpret_cast<char *>(&response), sizeof(response), client.address, client.port);
+
+        // A client that was rate-limited or whose send failed gets
+        // the latest state on a later tick
+        for (Client& client : m_Clients) {
+            if (client.lastSentSequences[slot] != sequence &&
+                client.isSubscribed(slot, state.mac, curTimestamp) &&
+                client.allowSend(curTimestamp) &&
+                writeDatagram(reinterpret_cast<char *>(&response), sizeof(response), client.address, client.port) >= 0) {
+                client.lastSentSequences[slot] = sequence;
+            }
+        }
     }
 }
 
-void Server::timerEvent(QTimerEvent*) {
+void Server::timerEvent(QTimerEvent* event) {
+    if (event->timerId() == m_SendTimerId) {
+        handleSend();
+        return;
+    }
+
     uint32_t curTimestamp = SDL_GetTicks();
 
     for (QList<Client>::iterator c = m_Clients.begin(); c != m_Clients.end();) {
-        constexpr uint32_t CHECK_TIMEOUT = 5000;
         if (curTimestamp - c->lastTimestamp > CHECK_TIMEOUT) {
             qInfo("[CemuHook Server] No packet from client [%s:%d] for some time.",
                   qPrintable(c->address.toString()), c->port);
@@ -132,21 +132,52 @@ struct MotionState {
     bool updateByControllerSensorEvent(SDL_ControllerSensorEvent* event);
 };
 
+// Compact controller state published by the input thread for each slot
+struct PadState {
+    bool connected;
+    SharedResponse::DeviceModel deviceModel;
+    uint8_t mac[6];
+    SharedResponse::Battery battery;
+
+    int buttons;
+    short lsX, lsY;
+    short rsX, rsY;
+    unsigned char lt, rt;
+
+    DataResponse::MotionData motion;
+};
+
 class Server : public QUdpSocket {
     Q_OBJECT
 
 public:
+    static constexpr int DEFAULT_RATE = 250;
+    static constexpr int MAX_SLOTS = 16;
+
     static
-    void init(const QHostAddress& addr = QHostAddress::Any, uint16_t port = 26760, QObject *parent = nullptr);
+    void init(const QHostAddress& addr = QHostAddress::Any, uint16_t port = 26760,
+              int rateHz = DEFAULT_RATE, QObject *parent = nullptr);
 
     static
     void destroy();
 
+    // Returns the port the server is bound to, or 0 if it isn't running
     static
-    void send(GamepadState* state);
+    uint16_t boundPort();
 
-signals:
-    void sendSignal(const GamepadState& state);
+    // The following are only called from the input thread
+
+    static
+    void connectSlot(GamepadState* state);
+
+    static
+    void disconnectSlot(GamepadState* state);
+
+    static
+    void updateBattery(GamepadState* state, SDL_JoystickPowerLevel level);
+
+    static
+    void send(GamepadState* state);
 
 private:
     explicit Server(QObject *parent = nullptr);
@@ -155,19 +186,62 @@ private:
 
     void handleReceive();
 
-    void handleSend(const GamepadState& state);
+    void handleSend();
 
-    void timerEvent(QTimerEvent*) override;
+    void timerEvent(QTimerEvent* event) override;
 
     uint32_t m_ServerId;
+    int m_CheckTimerId;
+    int m_SendTimerId;
+
+    // Single writer (input thread), single reader (server thread) seqlock
+    struct Slot {
+        SDL_atomic_t sequence;
+        PadState shared;
+
+        // Input thread only
+        PadState local;
+
+        // Server thread only
+        uint32_t packetNumber;
+
+        void publish();
+
+        int read(PadState& state) const;
+    } m_Slots[MAX_SLOTS];
 
     struct Client {
         uint32_t id;
         QHostAddress address;
         uint16_t port;
-        uint32_t packetNumber;
         uint32_t lastTimestamp;
+
+        // Data subscriptions, each renewed by the client's periodic data requests
+        uint32_t allSlotsTimestamp;
+        uint32_t slotTimestamps[MAX_SLOTS];
+        struct {
+            uint8_t mac[6];
+            uint32_t timestamp;
+        } macs[MAX_SLOTS];
+
+        // Outgoing data rate limiting, in thousandths of a packet
+        uint32_t sendCreditTimestamp;
+        uint32_t sendCredit;
+
+        // Sequence number of the last state sent for each slot, or -1 to
+        // send the current state even if the slot hasn't changed
+        int lastSentSequences[MAX_SLOTS];
+
+        bool subscribe(const Request::DataRequest& request, uint32_t curTimestamp);
+
+        bool isSubscribed(uint8_t slot, const uint8_t* mac, uint32_t curTimestamp) const;
+
+        bool allowSend(uint32_t curTimestamp);
     };
+
+    // New clients are only registered if canRegister is set
+    Client* findClient(const QHostAddress& address, uint16_t port, uint32_t id, uint32_t curTimestamp, bool canRegister);
+
     QList<Client> m_Clients;
 
     static Server* s_Server;
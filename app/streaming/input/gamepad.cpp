@@ -52,7 +52,7 @@ SdlInputHandler::findStateForGamepad(SDL_JoystickID id)
     return nullptr;
 }
 
-void SdlInputHandler::sendGamepadState(GamepadState* state)
+void SdlInputHandler::sendGamepadState(GamepadState* state, bool immediate)
 {
     SDL_assert(m_GamepadMask == 0x1 || m_MultiController);
 
@@ -79,6 +79,11 @@ void SdlInputHandler::sendGamepadState(GamepadState* state)
     // When in single controller mode, merge all gamepad state together
     if (!m_MultiController) {
         for (int i = 0; i < MAX_GAMEPADS; i++) {
+            // Empty slots are zeroed, so they can't contribute anything
+            if (m_GamepadState[i].controller == nullptr || &m_GamepadState[i] == state) {
+                continue;
+            }
+
             if (m_GamepadState[i].index == state->index) {
                 buttons |= m_GamepadState[i].buttons;
                 if (lt < m_GamepadState[i].lt) {
@@ -102,7 +107,55 @@ void SdlInputHandler::sendGamepadState(GamepadState* state)
         }
     }
 
-    LiSendMultiControllerEvent(state->index,
+    GamepadSendState* sendState = &m_GamepadSendState[state->index];
+
+    // Don't send a packet if the host already has this state
+    if (sendState->valid &&
+            sendState->buttons == buttons &&
+            sendState->lt == lt && sendState->rt == rt &&
+            sendState->lsX == lsX && sendState->lsY == lsY &&
+            sendState->rsX == rsX && sendState->rsY == rsY) {
+        sendState->pending = false;
+        return;
+    }
+
+    // Analog updates arriving faster than the send rate are coalesced
+    // into a single packet that goes out when the interval elapses.
+    Uint32 elapsed = SDL_GetTicks() - sendState->lastSendTime;
+    if (!immediate && sendState->valid && elapsed < m_GamepadSendIntervalMs) {
+        sendState->pending = true;
+        if (sendState->flushTimer == 0) {
+            sendState->flushTimer = SDL_AddTimer(m_GamepadSendIntervalMs - elapsed,
+                                                 SdlInputHandler::gamepadFlushTimerCallback,
+                                                 sendState);
+        }
+        return;
+    }
+
+    sendGamepadPacket(state->index, buttons, lt, rt, lsX, lsY, rsX, rsY);
+}
+
+void SdlInputHandler::sendGamepadPacket(short index, int buttons,
+                                        unsigned char lt, unsigned char rt,
+                                        short lsX, short lsY, short rsX, short rsY)
+{
+    GamepadSendState* sendState = &m_GamepadSendState[index];
+
+    sendState->valid = true;
+    sendState->pending = false;
+    sendState->lastSendTime = SDL_GetTicks();
+    sendState->buttons = buttons;
+    sendState->lt = lt;
+    sendState->rt = rt;
+    sendState->lsX = lsX;
+    sendState->lsY = lsY;
+    sendState->rsX = rsX;
+    sendState->rsY = rsY;
+
+    m_GamepadPacketsSent++;
+    Session::get()->getInputLatencyStats().recordGamepadPacket();
+
+    LiSendMultiControllerEvent(index,
                                m_GamepadMask,
                                buttons,
                                lt,
@@ -113,6 +166,75 @@ void SdlInputHandler::sendGamepadState(GamepadState* state)
                                rsY);
 }
 
+void SdlInputHandler::resetGamepadSendState(short index)
+{
+    GamepadSendState* sendState = &m_GamepadSendState[index];
+
+    if (sendState->flushTimer != 0) {
+        SDL_RemoveTimer(sendState->flushTimer);
+        sendState->flushTimer = 0;
+    }
+
+    sendState->valid = false;
+    sendState->pending = false;
+}
+
+void SdlInputHandler::flushGamepadState(short index)
+{
+    m_GamepadSendState[index].pending = false;
+
+    for (int i = 0; i < MAX_GAMEPADS; i++) {
+        GamepadState* state = &m_GamepadState[i];
+        if (state->controller != nullptr && state->index == index) {
+            if (state->mouseEmulationTimer == 0) {
+                sendGamepadState(state, true);
+            }
+            return;
+        }
+    }
+}
+
+Uint32 SdlInputHandler::gamepadFlushTimerCallback(Uint32, void* param)
+{
+    auto sendState = reinterpret_cast<GamepadSendState*>(param);
+    SdlInputHandler* me = sendState->handler;
+
+    // Timer callbacks run on SDL's timer thread
+    QMutexLocker lock(&me->m_GamepadLock);
+
+    sendState->flushTimer = 0;
+    if (sendState->pending) {
+        me->flushGamepadState(sendState->index);
+    }
+
+    // One-shot timer
+    return 0;
+}
+
+Uint32 SdlInputHandler::timerBarrierCallback(Uint32, void* param)
+{
+    SDL_SemPost(reinterpret_cast<SDL_sem*>(param));
+
+    // One-shot timer
+    return 0;
+}
+
+void SdlInputHandler::waitForTimerCallbacks()
+{
+    // SDL runs all timer callbacks one at a time on its timer thread, so once
+    // a new timer has fired, any callback that was running before has returned.
+    SDL_sem* barrier = SDL_CreateSemaphore(0);
+    if (barrier == nullptr) {
+        return;
+    }
+
+    if (SDL_AddTimer(1, SdlInputHandler::timerBarrierCallback, barrier) != 0) {
+        SDL_SemWait(barrier);
+    }
+
+    SDL_DestroySemaphore(barrier);
+}
+
 void SdlInputHandler::sendGamepadBatteryState(GamepadState* state, SDL_JoystickPowerLevel level)
 {
     uint8_t batteryPercentage;
@@ -189,6 +311,14 @@ Uint32 SdlInputHandler::mouseEmulationTimerCallback(Uint32 interval, void *param
     return interval;
 }
 
+// Integer math is exact here: x^2 + y^2 is at most 2^31 and
+// deadzone^2 is below 2^32, so both fit in an unsigned 32-bit int.
+static inline
+bool inDeadzone(short x, short y, unsigned short deadzone)
+{
+    return (uint32_t)(x * x) + (uint32_t)(y * y) < (uint32_t)deadzone * deadzone;
+}
+
 static inline
 short calibration(short value, const GamepadState::Calibration::Stick::Axis& axis) {
     if (value <= axis.min)
@@ -201,6 +331,78 @@ short calibration(short value, const GamepadState::Calibration::Stick::Axis& axi
         return 32767;
 }
 
+bool SdlInputHandler::getNextBatchedAxisEvent(SDL_JoystickID id, SDL_Event* nextEvent)
+{
+    if (m_InputBatch != nullptr) {
+        // On the input thread, only batch with the axis events that
+        // immediately follow this one in the current batch.
+        if (m_InputBatchIndex + 1 >= m_InputBatch->size()) {
+            return false;
+        }
+
+        const SDL_Event& event = m_InputBatch->at(m_InputBatchIndex + 1);
+        if (event.type != SDL_CONTROLLERAXISMOTION || event.caxis.which != id) {
+            return false;
+        }
+
+        *nextEvent = event;
+        m_InputBatchIndex++;
+        return true;
+    }
+
+    if (SDL_PeepEvents(nextEvent, 1, SDL_PEEKEVENT, SDL_CONTROLLERAXISMOTION, SDL_CONTROLLERAXISMOTION) <= 0) {
+        return false;
+    }
+
+    if (nextEvent->caxis.which != id) {
+        // Stop batching if a different gamepad interrupts us
+        return false;
+    }
+
+    // Remove the next event to batch
+    SDL_PeepEvents(nextEvent, 1, SDL_GETEVENT, SDL_CONTROLLERAXISMOTION, SDL_CONTROLLERAXISMOTION);
+    return true;
+}
+
+void SdlInputHandler::handleGamepadEvent(SDL_Event* event)
+{
+    QMutexLocker lock(&m_GamepadLock);
+
+    switch (event->type) {
+    case SDL_CONTROLLERAXISMOTION:
+        handleControllerAxisEvent(&event->caxis);
+        break;
+    case SDL_CONTROLLERBUTTONDOWN:
+    case SDL_CONTROLLERBUTTONUP:
+        handleControllerButtonEvent(&event->cbutton);
+        break;
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+    case SDL_CONTROLLERSENSORUPDATE:
+        handleControllerSensorEvent(&event->csensor);
+        return;
+    case SDL_CONTROLLERTOUCHPADDOWN:
+    case SDL_CONTROLLERTOUCHPADUP:
+    case SDL_CONTROLLERTOUCHPADMOTION:
+        handleControllerTouchpadEvent(&event->ctouchpad);
+        break;
+#endif
+#if SDL_VERSION_ATLEAST(2, 24, 0)
+    case SDL_JOYBATTERYUPDATED:
+        handleJoystickBatteryEvent(&event->jbattery);
+        return;
+#endif
+    case SDL_CONTROLLERDEVICEADDED:
+    case SDL_CONTROLLERDEVICEREMOVED:
+        handleControllerDeviceEvent(&event->cdevice);
+        return;
+    default:
+        return;
+    }
+
+    // Device, battery, and sensor events don't count toward input latency
+    Session::get()->getInputLatencyStats().record(InputLatencyStats::DC_GAMEPAD, event->common.timestamp);
+}
+
 void SdlInputHandler::handleControllerAxisEvent(SDL_ControllerAxisEvent* event)
 {
     SDL_JoystickID gameControllerId = event->which;
@@ -211,7 +413,9 @@ void SdlInputHandler::handleControllerAxisEvent(SDL_ControllerAxisEvent* event)
 
     // Batch all pending axis motion events for this gamepad to save CPU time
     SDL_Event nextEvent;
+    int events = 0;
     for (;;) {
+        events++;
         switch (event->axis)
         {
             case SDL_CONTROLLER_AXIS_LEFTX:
@@ -245,24 +449,20 @@ void SdlInputHandler::handleControllerAxisEvent(SDL_ControllerAxisEvent* event)
         }
 
         // Check for another event to batch with
-        if (SDL_PeepEvents(&nextEvent, 1, SDL_PEEKEVENT, SDL_CONTROLLERAXISMOTION, SDL_CONTROLLERAXISMOTION) <= 0) {
+        if (!getNextBatchedAxisEvent(gameControllerId, &nextEvent)) {
             break;
         }
 
         event = &nextEvent.caxis;
-        if (event->which != gameControllerId) {
-            // Stop batching if a different gamepad interrupts us
-            break;
-        }
-
-        // Remove the next event to batch
-        SDL_PeepEvents(&nextEvent, 1, SDL_GETEVENT, SDL_CONTROLLERAXISMOTION, SDL_CONTROLLERAXISMOTION);
     }
 
+    m_GamepadEventsIn += events;
+    Session::get()->getInputLatencyStats().recordGamepadEvents(events);
+
     // Apply stick deadzone
-    if (qPow(state->lsX, 2) + qPow(state->lsY, 2) < qPow(state->cal.ls.deadzone, 2))
+    if (inDeadzone(state->lsX, state->lsY, state->cal.ls.deadzone))
         state->lsX = state->lsY = 0;
-    if (qPow(state->rsX, 2) + qPow(state->rsY, 2) < qPow(state->cal.rs.deadzone, 2))
+    if (inDeadzone(state->rsX, state->rsY, state->cal.rs.deadzone))
         state->rsX = state->rsY = 0;
 
     // Only send the gamepad state to the host if it's not in mouse emulation mode
@@ -289,6 +489,9 @@ void SdlInputHandler::handleControllerButtonEvent(SDL_ControllerButtonEvent* eve
         return;
     }
 
+    m_GamepadEventsIn++;
+    Session::get()->getInputLatencyStats().recordGamepadEvents(1);
+
     if (m_SwapFaceButtons) {
         switch (event->button) {
         case SDL_CONTROLLER_BUTTON_A:
@@ -357,7 +560,7 @@ void SdlInputHandler::handleControllerButtonEvent(SDL_ControllerButtonEvent* eve
                 }
                 else if (m_GamepadMouse) {
                     // Send the start button up event to the host, since we won't do it below
-                    sendGamepadState(state);
+                    sendGamepadState(state, true);
 
                     state->mouseEmulationTimer = SDL_AddTimer(MOUSE_EMULATION_POLLING_INTERVAL, SdlInputHandler::mouseEmulationTimerCallback, state);
 
@@ -398,8 +601,7 @@ void SdlInputHandler::handleControllerButtonEvent(SDL_ControllerButtonEvent* eve
         SDL_PushEvent(&event);
 
         // Clear buttons down on this gamepad
-        LiSendMultiControllerEvent(state->index, m_GamepadMask,
-                                   0, 0, 0, 0, 0, 0, 0);
+        sendGamepadPacket(state->index, 0, 0, 0, 0, 0, 0, 0);
         return;
     }
 
@@ -413,14 +615,14 @@ void SdlInputHandler::handleControllerButtonEvent(SDL_ControllerButtonEvent* eve
                                                             !Session::get()->getOverlayManager().isOverlayEnabled(Overlay::OverlayDebug));
 
         // Clear buttons down on this gamepad
-        LiSendMultiControllerEvent(state->index, m_GamepadMask,
-                                   0, 0, 0, 0, 0, 0, 0);
+        sendGamepadPacket(state->index, 0, 0, 0, 0, 0, 0, 0);
         return;
     }
 
-    // Only send the gamepad state to the host if it's not in mouse emulation mode
+    // Only send the gamepad state to the host if it's not in mouse emulation mode.
+    // Button edges are never delayed by the analog send rate.
     if (state->mouseEmulationTimer == 0) {
-        sendGamepadState(state);
+        sendGamepadState(state, true);
     }
 
     if (state->motionState.deviceModel != Cemuhook::SharedResponse::DeviceModel::FULL_GYRO) {
@@ -506,6 +708,8 @@ void SdlInputHandler::handleJoystickBatteryEvent(SDL_JoyBatteryEvent* event)
     }
 
     sendGamepadBatteryState(state, event->level);
+
+    Cemuhook::Server::updateBattery(state, event->level);
 }
 
 #endif
@@ -593,6 +797,10 @@ void SdlInputHandler::handleControllerDeviceEvent(SDL_ControllerDeviceEvent* eve
             state->index = 0;
         }
 
+        // The host has to hear about this controller regardless of
+        // what was last sent for this index
+        resetGamepadSendState(state->index);
+
         state->controller = controller;
         state->jsId = SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(state->controller));
 
@@ -804,9 +1012,12 @@ void SdlInputHandler::handleControllerDeviceEvent(SDL_ControllerDeviceEvent* eve
 #else
 
         // Send an empty event to tell the PC we've arrived
-        sendGamepadState(state);
+        sendGamepadState(state, true);
 #endif
 
+        // Cache the static controller details for DSU clients
+        Cemuhook::Server::connectSlot(state);
+
         // Send a power level if it's known at this time
         if (powerLevel != SDL_JOYSTICK_POWER_UNKNOWN) {
             sendGamepadBatteryState(state, powerLevel);
@@ -842,8 +1053,10 @@ void SdlInputHandler::handleControllerDeviceEvent(SDL_ControllerDeviceEvent* eve
                         state->index);
 
             // Send a final event to let the PC know this gamepad is gone
-            LiSendMultiControllerEvent(state->index, m_GamepadMask,
-                                       0, 0, 0, 0, 0, 0, 0);
+            sendGamepadPacket(state->index, 0, 0, 0, 0, 0, 0, 0);
+            resetGamepadSendState(state->index);
+
+            Cemuhook::Server::disconnectSlot(state);
 
             // Clear all remaining state from this slot
             SDL_memset(state, 0, sizeof(*state));
@@ -855,6 +1068,11 @@ void SdlInputHandler::handleJoystickArrivalEvent(SDL_JoyDeviceEvent* event)
 {
     SDL_assert(event->type == SDL_JOYDEVICEADDED);
 
+    // The posted SDL_CONTROLLERDEVICEADDED event will handle it
+    if (MappingManager::handleJoystickArrival(event)) {
+        return;
+    }
+
     if (!SDL_IsGameController(event->which)) {
         char guidStr[33];
         SDL_JoystickGetGUIDString(SDL_JoystickGetDeviceGUID(event->which),
@@ -887,6 +1105,9 @@ void SdlInputHandler::rumble(unsigned short controllerNumber, unsigned short low
         return;
     }
 
+    // The input thread may be modifying the gamepad state concurrently
+    QMutexLocker lock(&m_GamepadLock);
+
 #if SDL_VERSION_ATLEAST(2, 0, 9)
     if (m_GamepadState[controllerNumber].controller != nullptr) {
         SDL_GameControllerRumble(m_GamepadState[controllerNumber].controller, lowFreqMotor, highFreqMotor, 30000);
@@ -945,6 +1166,8 @@ void SdlInputHandler::rumbleTriggers(uint16_t controllerNumber, uint16_t leftTri
         return;
     }
 
+    QMutexLocker lock(&m_GamepadLock);
+
 #if SDL_VERSION_ATLEAST(2, 0, 14)
     if (m_GamepadState[controllerNumber].controller != nullptr) {
         SDL_GameControllerRumbleTriggers(m_GamepadState[controllerNumber].controller, leftTrigger, rightTrigger, 30000);
@@ -959,6 +1182,8 @@ void SdlInputHandler::setMotionEventState(uint16_t controllerNumber, uint8_t mot
         return;
     }
 
+    QMutexLocker lock(&m_GamepadLock);
+
 #if SDL_VERSION_ATLEAST(2, 0, 14)
     if (m_GamepadState[controllerNumber].controller != nullptr) {
         uint8_t reportPeriodMs = reportRateHz ? (1000 / reportRateHz) : 0;
@@ -985,6 +1210,8 @@ void SdlInputHandler::setControllerLED(uint16_t controllerNumber, uint8_t r, uin
         return;
     }
 
+    QMutexLocker lock(&m_GamepadLock);
+
 #if SDL_VERSION_ATLEAST(2, 0, 14)
     if (m_GamepadState[controllerNumber].controller != nullptr) {
         SDL_GameControllerSetLED(m_GamepadState[controllerNumber].controller, r, g, b);
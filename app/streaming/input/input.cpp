@@ -19,6 +19,9 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
       m_PendingMouseButtonsAllUpOnVideoRegionLeave(false),
       m_PointerRegionLockActive(false),
       m_PointerRegionLockToggledByUser(false),
+      m_GamepadSendIntervalMs(1000 / qBound(1, prefs.gamepadSendRate, 1000)),
+      m_GamepadEventsIn(0),
+      m_GamepadPacketsSent(0),
       m_FakeCaptureActive(false),
       m_CaptureSystemKeysMode(prefs.captureSysKeysMode),
       m_MouseCursorCapturedVisibilityState(SDL_DISABLE),
@@ -33,7 +36,11 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
       m_DragTimer(0),
       m_DragButton(0),
       m_NumFingersDown(0),
-      m_CemuhookServer(prefs.cemuhookServer)
+      m_CemuhookServer(prefs.cemuhookServer),
+      m_InputThread(nullptr),
+      m_InputThreadStopping(false),
+      m_InputBatch(nullptr),
+      m_InputBatchIndex(0)
 {
     // System keys are always captured when running without a DE
     if (!WMUtils::isRunningDesktopEnvironment()) {
@@ -66,6 +73,14 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
     SDL_SetHint("SDL_JOYSTICK_HIDAPI_PS4_RUMBLE", "1");
     SDL_SetHint("SDL_JOYSTICK_HIDAPI_PS5_RUMBLE", "1");
 
+#ifdef Q_OS_WIN32
+    // Receive raw input and device change messages for joysticks on a
+    // dedicated SDL thread rather than the main thread's message loop,
+    // so the input thread can update joysticks while the main thread
+    // is busy rendering.
+    SDL_SetHint("SDL_JOYSTICK_THREAD", "1");
+#endif
+
     // Populate special key combo configuration
     m_SpecialKeyCombos[KeyComboQuit].keyCombo = KeyComboQuit;
     m_SpecialKeyCombos[KeyComboQuit].keyCode = SDLK_q;
@@ -194,17 +209,44 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
     m_GamepadMask = getAttachedGamepadMask();
 
     SDL_zero(m_GamepadState);
+    SDL_zero(m_GamepadSendState);
+    for (int i = 0; i < MAX_GAMEPADS; i++) {
+        m_GamepadSendState[i].handler = this;
+        m_GamepadSendState[i].index = i;
+    }
     SDL_zero(m_LastTouchDownEvent);
     SDL_zero(m_LastTouchUpEvent);
     SDL_zero(m_TouchDownEvent);
 
     if (m_CemuhookServer) {
-        Cemuhook::Server::init();
+        Cemuhook::Server::init(QHostAddress::Any, 26760, prefs.cemuhookRate);
     }
 }
 
 SdlInputHandler::~SdlInputHandler()
 {
+    stopInputThread();
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Gamepad events received: %d | Gamepad packets sent: %d",
+                m_GamepadEventsIn,
+                m_GamepadPacketsSent);
+
+    {
+        QMutexLocker lock(&m_GamepadLock);
+
+        for (int i = 0; i < MAX_GAMEPADS; i++) {
+            if (m_GamepadSendState[i].flushTimer != 0) {
+                SDL_RemoveTimer(m_GamepadSendState[i].flushTimer);
+                m_GamepadSendState[i].flushTimer = 0;
+            }
+        }
+    }
+
+    // A flush callback may have been running when we removed its timer.
+    // It must not touch this object once we start tearing it down.
+    waitForTimerCallbacks();
+
     for (int i = 0; i < MAX_GAMEPADS; i++) {
         if (m_GamepadState[i].mouseEmulationTimer != 0) {
             Session::get()->notifyMouseEmulationMode(false);
@@ -239,6 +281,10 @@ SdlInputHandler::~SdlInputHandler()
     // Return background event handling to off
     SDL_SetHint(SDL_HINT_JOYSTICK_ALLOW_BACKGROUND_EVENTS, "0");
 
+#ifdef Q_OS_WIN32
+    SDL_SetHint("SDL_JOYSTICK_THREAD", "0");
+#endif
+
     // Restore the ignored devices
     SDL_SetHint(SDL_HINT_GAMECONTROLLER_IGNORE_DEVICES, m_OldIgnoreDevices.toUtf8());
     SDL_SetHint(SDL_HINT_GAMECONTROLLER_IGNORE_DEVICES_EXCEPT, m_OldIgnoreDevicesExcept.toUtf8());
@@ -254,6 +300,262 @@ SdlInputHandler::~SdlInputHandler()
     Cemuhook::Server::destroy();
 }
 
+// How often the input thread updates joysticks while any are attached
+#define INPUT_THREAD_JOYSTICK_POLL_MS 1
+
+bool SdlInputHandler::isGamepadEvent(Uint32 type)
+{
+    switch (type) {
+    case SDL_CONTROLLERAXISMOTION:
+    case SDL_CONTROLLERBUTTONDOWN:
+    case SDL_CONTROLLERBUTTONUP:
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+    case SDL_CONTROLLERSENSORUPDATE:
+    case SDL_CONTROLLERTOUCHPADDOWN:
+    case SDL_CONTROLLERTOUCHPADUP:
+    case SDL_CONTROLLERTOUCHPADMOTION:
+#endif
+#if SDL_VERSION_ATLEAST(2, 24, 0)
+    case SDL_JOYBATTERYUPDATED:
+#endif
+    case SDL_CONTROLLERDEVICEADDED:
+    case SDL_CONTROLLERDEVICEREMOVED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+int SdlInputHandler::inputThreadEventWatch(void* userdata, SDL_Event* event)
+{
+    auto me = reinterpret_cast<SdlInputHandler*>(userdata);
+
+    // This is called synchronously on whichever thread pushed the event,
+    // which is either the main thread inside SDL_PumpEvents() or the input
+    // thread itself inside SDL_JoystickUpdate().
+    if (isGamepadEvent(event->type)) {
+        me->m_InputQueueLock.lock();
+        me->m_InputQueue.append(*event);
+        me->m_InputQueueNotEmpty.wakeOne();
+        me->m_InputQueueLock.unlock();
+    }
+
+    return 1;
+}
+
+int SdlInputHandler::inputThread(void* context)
+{
+    auto me = reinterpret_cast<SdlInputHandler*>(context);
+    QVector<SDL_Event> batch;
+
+    if (SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH) < 0) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Unable to set input thread to high priority: %s",
+                    SDL_GetError());
+    }
+
+    me->m_InputQueueLock.lock();
+    while (!me->m_InputThreadStopping) {
+        if (me->m_InputQueue.isEmpty()) {
+            // If there are no joysticks, sleep until the event watch hands us
+            // an arrival from the main thread's event pumping.
+            if (SDL_NumJoysticks() == 0) {
+                me->m_InputQueueNotEmpty.wait(&me->m_InputQueueLock);
+                continue;
+            }
+
+            // Otherwise, update the joysticks ourselves rather than waiting for
+            // the main thread to get around to pumping events while it's busy
+            // rendering. The resulting events come back to us via the event
+            // watch, so we must not hold the queue lock while doing this.
+            if (!me->m_InputQueueNotEmpty.wait(&me->m_InputQueueLock, INPUT_THREAD_JOYSTICK_POLL_MS)) {
+                me->m_InputQueueLock.unlock();
+                SDL_LockJoysticks();
+                SDL_JoystickUpdate();
+                SDL_UnlockJoysticks();
+                me->m_InputQueueLock.lock();
+            }
+            continue;
+        }
+
+        batch.swap(me->m_InputQueue);
+        me->m_InputQueueLock.unlock();
+
+        me->m_InputBatch = &batch;
+        for (me->m_InputBatchIndex = 0; me->m_InputBatchIndex < batch.size(); me->m_InputBatchIndex++) {
+            me->handleGamepadEvent(&batch[me->m_InputBatchIndex]);
+        }
+        me->m_InputBatch = nullptr;
+
+        batch.clear();
+        me->m_InputQueueLock.lock();
+    }
+    me->m_InputQueueLock.unlock();
+
+    return 0;
+}
+
+void SdlInputHandler::startInputThread()
+{
+#if defined(Q_OS_WIN32) || defined(Q_OS_LINUX)
+    SDL_assert(m_InputThread == nullptr);
+
+    if (qgetenv("NO_INPUT_THREAD") == "1") {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Input thread disabled by environment variable");
+        return;
+    }
+
+    m_InputThreadStopping = false;
+
+    {
+        QMutexLocker lock(&m_InputQueueLock);
+
+        // Gamepad events will be copied into our queue as they are generated
+        // from now on. SDL_SetEventFilter() would be simpler, but it flushes
+        // every queued event when it's installed.
+        SDL_AddEventWatch(inputThreadEventWatch, this);
+
+        // Steal any gamepad events already waiting in SDL's queue. We hold the
+        // queue lock so newer events can't be appended ahead of these. Events
+        // in this range that aren't gamepad events are ignored by the main loop
+        // anyway, so we just drop those.
+        SDL_Event event;
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+        while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_CONTROLLERAXISMOTION, SDL_CONTROLLERSENSORUPDATE) > 0) {
+#else
+        while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_CONTROLLERAXISMOTION, SDL_CONTROLLERDEVICEREMAPPED) > 0) {
+#endif
+            if (isGamepadEvent(event.type)) {
+                m_InputQueue.append(event);
+            }
+        }
+#if SDL_VERSION_ATLEAST(2, 24, 0)
+        while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_JOYBATTERYUPDATED, SDL_JOYBATTERYUPDATED) > 0) {
+            m_InputQueue.append(event);
+        }
+#endif
+    }
+
+    m_InputThread = SDL_CreateThread(inputThread, "InputThread", this);
+    if (m_InputThread == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to create input thread: %s",
+                     SDL_GetError());
+        SDL_DelEventWatch(inputThreadEventWatch, this);
+
+        // Return the events we took to the main loop
+        for (SDL_Event& event : m_InputQueue) {
+            SDL_PushEvent(&event);
+        }
+        m_InputQueue.clear();
+    }
+#endif
+}
+
+void SdlInputHandler::stopInputThread()
+{
+    if (m_InputThread == nullptr) {
+        return;
+    }
+
+    SDL_DelEventWatch(inputThreadEventWatch, this);
+
+    m_InputQueueLock.lock();
+    m_InputThreadStopping = true;
+    m_InputQueueNotEmpty.wakeAll();
+    m_InputQueueLock.unlock();
+
+    SDL_WaitThread(m_InputThread, nullptr);
+    m_InputThread = nullptr;
+
+    // Any remaining events are for a stream that is ending
+    m_InputQueue.clear();
+}
+
+bool SdlInputHandler::isInputThreadActive()
+{
+    return m_InputThread != nullptr;
+}
+
+InputLatencyStats::InputLatencyStats()
+{
+    SDL_zero(m_GamepadEventsIn);
+    SDL_zero(m_GamepadPacketsSent);
+    SDL_zero(m_Stats);
+}
+
+void InputLatencyStats::recordGamepadEvents(int count)
+{
+    SDL_AtomicAdd(&m_GamepadEventsIn, count);
+}
+
+void InputLatencyStats::recordGamepadPacket()
+{
+    SDL_AtomicAdd(&m_GamepadPacketsSent, 1);
+}
+
+void InputLatencyStats::record(DeviceClass deviceClass, Uint32 eventTimestamp)
+{
+    int latencyMs = (int)(SDL_GetTicks() - eventTimestamp);
+
+    SDL_AtomicAdd(&m_Stats[deviceClass].events, 1);
+    SDL_AtomicAdd(&m_Stats[deviceClass].totalLatencyMs, latencyMs);
+
+    int maxLatencyMs;
+    do {
+        maxLatencyMs = SDL_AtomicGet(&m_Stats[deviceClass].maxLatencyMs);
+    } while (latencyMs > maxLatencyMs &&
+             !SDL_AtomicCAS(&m_Stats[deviceClass].maxLatencyMs, maxLatencyMs, latencyMs));
+}
+
+int InputLatencyStats::stringify(char* output, int length)
+{
+    static const char* const k_DeviceClassNames[DC_MAX] = { "Keyboard", "Mouse", "Gamepad", "Touch" };
+    int offset = 0;
+
+    for (int i = 0; i < DC_MAX; i++) {
+        int events = SDL_AtomicSet(&m_Stats[i].events, 0);
+        int totalLatencyMs = SDL_AtomicSet(&m_Stats[i].totalLatencyMs, 0);
+        int maxLatencyMs = SDL_AtomicSet(&m_Stats[i].maxLatencyMs, 0);
+
+        if (events == 0 || offset >= length) {
+            continue;
+        }
+
+        int ret = snprintf(&output[offset], length - offset,
+                           "%s input latency: %.2f ms (max %d ms, %d events)\n",
+                           k_DeviceClassNames[i],
+                           (float)totalLatencyMs / events,
+                           maxLatencyMs,
+                           events);
+        if (ret < 0 || ret >= length - offset) {
+            // Truncated
+            offset = length;
+            break;
+        }
+
+        offset += ret;
+    }
+
+    int gamepadEventsIn = SDL_AtomicSet(&m_GamepadEventsIn, 0);
+    int gamepadPacketsSent = SDL_AtomicSet(&m_GamepadPacketsSent, 0);
+    if (gamepadEventsIn != 0 && offset < length) {
+        int ret = snprintf(&output[offset], length - offset,
+                           "Gamepad events: %d in, %d packets sent\n",
+                           gamepadEventsIn,
+                           gamepadPacketsSent);
+        if (ret < 0 || ret >= length - offset) {
+            offset = length;
+        }
+        else {
+            offset += ret;
+        }
+    }
+
+    return offset;
+}
+
 void SdlInputHandler::setWindow(SDL_Window *window)
 {
     m_Window = window;
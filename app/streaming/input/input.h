@@ -6,6 +6,10 @@
 
 #include <SDL.h>
 
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
 struct GamepadState {
     SDL_GameController* controller;
     SDL_JoystickID jsId;
@@ -64,6 +68,43 @@ struct GamepadState {
 #define GAMEPAD_HAPTIC_SIMPLE_HIFREQ_MOTOR_WEIGHT 0.33
 #define GAMEPAD_HAPTIC_SIMPLE_LOWFREQ_MOTOR_WEIGHT 0.8
 
+// Tracks the time between SDL receiving an input event and it
+// being sent to the host, and how many gamepad events turned into
+// packets, for the performance overlay
+class InputLatencyStats
+{
+public:
+    enum DeviceClass
+    {
+        DC_KEYBOARD,
+        DC_MOUSE,
+        DC_GAMEPAD,
+        DC_TOUCH,
+        DC_MAX
+    };
+
+    InputLatencyStats();
+
+    void record(DeviceClass deviceClass, Uint32 eventTimestamp);
+
+    void recordGamepadEvents(int count);
+
+    void recordGamepadPacket();
+
+    // Prints the stats since the last call and starts a new window
+    int stringify(char* output, int length);
+
+private:
+    SDL_atomic_t m_GamepadEventsIn;
+    SDL_atomic_t m_GamepadPacketsSent;
+
+    struct {
+        SDL_atomic_t events;
+        SDL_atomic_t totalLatencyMs;
+        SDL_atomic_t maxLatencyMs;
+    } m_Stats[DC_MAX];
+};
+
 class SdlInputHandler
 {
 public:
@@ -71,6 +112,16 @@ public:
 
     ~SdlInputHandler();
 
+    // Gamepad events are processed on a dedicated thread while it's running
+    void startInputThread();
+
+    void stopInputThread();
+
+    bool isInputThreadActive();
+
+    static
+    bool isGamepadEvent(Uint32 type);
+
     void setWindow(SDL_Window* window);
 
     void handleKeyEvent(SDL_KeyboardEvent* event);
@@ -83,6 +134,8 @@ public:
 
     void handleControllerAxisEvent(SDL_ControllerAxisEvent* event);
 
+    void handleGamepadEvent(SDL_Event* event);
+
     void handleControllerButtonEvent(SDL_ControllerButtonEvent* event);
 
     void handleControllerDeviceEvent(SDL_ControllerDeviceEvent* event);
@@ -151,7 +204,25 @@ private:
     GamepadState*
     findStateForGamepad(SDL_JoystickID id);
 
-    void sendGamepadState(GamepadState* state);
+    bool getNextBatchedAxisEvent(SDL_JoystickID id, SDL_Event* nextEvent);
+
+    static
+    int inputThread(void* context);
+
+    static
+    int SDLCALL inputThreadEventWatch(void* userdata, SDL_Event* event);
+
+    // Analog-only changes are coalesced to the configured send rate
+    // unless immediate is set (for button edges).
+    void sendGamepadState(GamepadState* state, bool immediate = false);
+
+    void sendGamepadPacket(short index, int buttons,
+                           unsigned char lt, unsigned char rt,
+                           short lsX, short lsY, short rsX, short rsY);
+
+    void resetGamepadSendState(short index);
+
+    void flushGamepadState(short index);
 
     void sendGamepadBatteryState(GamepadState* state, SDL_JoystickPowerLevel level);
 
@@ -171,6 +242,16 @@ private:
     static
     Uint32 mouseEmulationTimerCallback(Uint32 interval, void* param);
 
+    static
+    Uint32 gamepadFlushTimerCallback(Uint32 interval, void* param);
+
+    static
+    Uint32 timerBarrierCallback(Uint32 interval, void* param);
+
+    // Waits for any timer callback that is already running to return
+    static
+    void waitForTimerCallbacks();
+
     static
     Uint32 releaseLeftButtonTimerCallback(Uint32 interval, void* param);
 
@@ -194,6 +275,23 @@ private:
 
     int m_GamepadMask;
     GamepadState m_GamepadState[MAX_GAMEPADS];
+
+    // What the host last received for each controller index
+    struct GamepadSendState {
+        SdlInputHandler* handler;
+        short index;
+        bool valid;
+        bool pending;
+        SDL_TimerID flushTimer;
+        Uint32 lastSendTime;
+        int buttons;
+        unsigned char lt, rt;
+        short lsX, lsY, rsX, rsY;
+    } m_GamepadSendState[MAX_GAMEPADS];
+    Uint32 m_GamepadSendIntervalMs;
+    int m_GamepadEventsIn;
+    int m_GamepadPacketsSent;
+
     QSet<short> m_KeysDown;
     bool m_FakeCaptureActive;
     QString m_OldIgnoreDevices;
@@ -227,5 +325,16 @@ private:
 
     bool m_CemuhookServer;
 
+    SDL_Thread* m_InputThread;
+    bool m_InputThreadStopping;
+    QMutex m_InputQueueLock;
+    QWaitCondition m_InputQueueNotEmpty;
+    QVector<SDL_Event> m_InputQueue;
+    const QVector<SDL_Event>* m_InputBatch;
+    int m_InputBatchIndex;
+
+    // Protects gamepad state against the input thread and SDL timer callbacks
+    QMutex m_GamepadLock;
+
     static const int k_ButtonMap[];
 };
@@ -2,7 +2,9 @@
 #include "settings/streamingpreferences.h"
 #include "streaming/streamutils.h"
 #include "backend/richpresencemanager.h"
+#include "backend/systemproperties.h"
 #include "streaming/vban.h"
+#include "startuptracer.h"
 
 #include <Limelight.h>
 #include <SDL.h>
@@ -10,6 +12,7 @@
 
 #ifdef HAVE_FFMPEG
 #include "video/ffmpeg.h"
+#include "video/ffmpeg-renderers/hwdevicepool.h"
 #endif
 
 #ifdef HAVE_SLVIDEO
@@ -42,6 +45,10 @@
 #define SDL_CODE_GAMECONTROLLER_SET_MOTION_EVENT_STATE 103
 #define SDL_CODE_GAMECONTROLLER_SET_CONTROLLER_LED 104
 
+// Bounds the number of queued events handled before a pending frame
+// is presented, so a burst of input can't starve rendering
+#define MAX_EVENTS_BEFORE_RENDER 8
+
 #include <openssl/rand.h>
 
 #include <QtEndian>
@@ -54,9 +61,14 @@
 #include <QCursor>
 #include <QWindow>
 #include <QScreen>
+#include <QThread>
+#include <QTimer>
 
 #define CONN_TEST_SERVER "qt.conntest.moonlight-stream.org"
 
+// How long a finished session's window is kept for reuse
+#define WARM_WINDOW_TIMEOUT_MS 15000
+
 CONNECTION_LISTENER_CALLBACKS Session::k_ConnCallbacks = {
     Session::clStageStarting,
     nullptr,
@@ -74,6 +86,11 @@ CONNECTION_LISTENER_CALLBACKS Session::k_ConnCallbacks = {
 
 Session* Session::s_ActiveSession;
 QSemaphore Session::s_ActiveSessionSemaphore(1);
+SDL_Window* Session::s_WarmWindow;
+int Session::s_WarmWindowGeneration;
+QMutex Session::s_PendingQuitLock;
+QWaitCondition Session::s_PendingQuitCondition;
+QSet<NvComputer*> Session::s_PendingQuitComputers;
 
 void Session::clStageStarting(int stage)
 {
@@ -332,7 +349,9 @@ int Session::drSetup(int videoFormat, int width, int height, int frameRate, void
 
     // Defer decoder setup until we've started streaming so we
     // don't have to hide and show the SDL window (which seems to
-    // cause pointer hiding to break on Windows).
+    // cause pointer hiding to break on Windows). If execInternal()
+    // speculatively created a decoder matching these parameters,
+    // it will be used as-is.
 
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Video stream is %dx%dx%d (format 0x%x)",
                 width, height, frameRate, videoFormat);
@@ -353,6 +372,13 @@ int Session::drSubmitDecodeUnit(PDECODE_UNIT du)
     if (SDL_AtomicTryLock(&s_ActiveSession->m_DecoderLock)) {
         IVideoDecoder* decoder = s_ActiveSession->m_VideoDecoder;
         if (decoder != nullptr) {
+            if (!s_ActiveSession->m_FirstFrameSubmitted) {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                            "First frame submitted %u ms after launch",
+                            SDL_GetTicks() - s_ActiveSession->m_LaunchStartTime);
+                s_ActiveSession->m_FirstFrameSubmitted = true;
+            }
+
             int ret = decoder->submitDecodeUnit(du);
             SDL_AtomicUnlock(&s_ActiveSession->m_DecoderLock);
             return ret;
@@ -557,6 +583,8 @@ Session::Session(NvComputer* computer, NvApp& app, StreamingPreferences *prefere
       m_FlushingWindowEventsRef(0),
       m_AsyncConnectionSuccess(false),
       m_PortTestResults(0),
+      m_LaunchStartTime(0),
+      m_FirstFrameSubmitted(false),
       m_OpusDecoder(nullptr),
       m_AudioRenderer(nullptr),
       m_AudioSampleCount(0),
@@ -566,6 +594,9 @@ Session::Session(NvComputer* computer, NvApp& app, StreamingPreferences *prefere
 
 bool Session::initialize()
 {
+    // Make sure we have exclusive use of the SDL video subsystem
+    SystemProperties::waitForBackgroundProbe();
+
 #ifdef Q_OS_DARWIN
     if (qEnvironmentVariableIntValue("I_WANT_BUGGY_FULLSCREEN") == 0) {
         // If we have a notch and the user specified one of the two native display modes
@@ -628,7 +659,7 @@ bool Session::initialize()
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                          "Failed to create window for hardware decode test: %s",
                          SDL_GetError());
-            SDL_QuitSubSystem(SDL_INIT_VIDEO);
+            StreamUtils::quitVideoSubsystem();
             return false;
         }
     }
@@ -830,12 +861,14 @@ bool Session::initialize()
     SDL_DestroyWindow(testWindow);
 
     if (!ret) {
-        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+        StreamUtils::quitVideoSubsystem();
         return false;
     }
 
     if (m_Preferences->vbanEmitter) {
-        Vban::Emitter::init(QHostAddress(m_Computer->activeAddress.address()));
+        Vban::Emitter::init(QHostAddress(m_Computer->activeAddress.address()), 6980, nullptr,
+                            static_cast<Vban::Emitter::GateMode>(m_Preferences->vbanGateMode),
+                            m_Preferences->vbanGateThreshold);
     }
 
     return true;
@@ -1090,10 +1123,6 @@ public:
 private:
     virtual ~DeferredSessionCleanupTask() override
     {
-        // Allow another session to start now that we're cleaned up
-        Session::s_ActiveSession = nullptr;
-        Session::s_ActiveSessionSemaphore.release();
-
         // Notify that the session is ready to be cleaned up
         emit m_Session->readyForDeletion();
     }
@@ -1121,6 +1150,16 @@ private:
         // Finish cleanup of the connection state
         LiStopConnection();
 
+        // The next session only needs the connection to be stopped, so allow
+        // it to start while the app quit finishes. A session for this same host
+        // waits in startConnectionAsync() until the quit is done.
+        if (shouldQuit) {
+            QMutexLocker locker(&Session::s_PendingQuitLock);
+            Session::s_PendingQuitComputers.insert(m_Session->m_Computer);
+        }
+        Session::s_ActiveSession = nullptr;
+        Session::s_ActiveSessionSemaphore.release();
+
         // Perform a best-effort app quit
         if (shouldQuit) {
             NvHTTP http(m_Session->m_Computer);
@@ -1132,6 +1171,12 @@ private:
             } catch (const QtNetworkReplyException&) {
             }
 
+            {
+                QMutexLocker locker(&Session::s_PendingQuitLock);
+                Session::s_PendingQuitComputers.remove(m_Session->m_Computer);
+                Session::s_PendingQuitCondition.wakeAll();
+            }
+
             // Session is finished now
             emit m_Session->sessionFinished(m_Session->m_PortTestResults);
         }
@@ -1396,6 +1441,9 @@ bool Session::startConnectionAsync()
     // have time to read any messages present on the segue
     SDL_Delay(1500);
 
+    // Don't launch until the previous session has finished quitting its app
+    waitForPendingQuit(m_Computer);
+
     // The UI should have ensured the old game was already quit
     // if we decide to stream a different game.
     Q_ASSERT(m_Computer->currentGameId == 0 ||
@@ -1584,60 +1632,92 @@ void Session::exec(QWindow* qtWindow)
     }
 }
 
-void Session::execInternal()
+void Session::waitForPendingQuit(NvComputer* computer)
 {
-    // Complete initialization in this deferred context to avoid
-    // calling expensive functions in the constructor (during the
-    // process of loading the StreamSegue).
+    QMutexLocker locker(&s_PendingQuitLock);
+
+    if (s_PendingQuitComputers.contains(computer)) {
+        StartupTracer::Span span("Waiting for previous app quit");
+        while (s_PendingQuitComputers.contains(computer)) {
+            s_PendingQuitCondition.wait(&s_PendingQuitLock);
+        }
+    }
+}
+
+void Session::releaseWindow(SDL_Window* window)
+{
+    // Keep the window and the SDL video subsystem around for a little while so
+    // a session started right after this one can skip creating them. We only do
+    // this when the window lives on the main thread and in a desktop environment,
+    // where holding the video subsystem doesn't take the display away from Qt.
     //
-    // NB: This initializes the SDL video subsystem, so it must be
-    // called on the main thread.
-    if (!initialize()) {
-        emit sessionFinished(0);
-        emit readyForDeletion();
+    // This isn't done on Windows, because hiding and showing the window there
+    // breaks pointer hiding when it is reused.
+#ifndef Q_OS_WIN32
+    if (window != nullptr && !m_ThreadedExec && WMUtils::isRunningDesktopEnvironment() &&
+            QThread::currentThread() == QCoreApplication::instance()->thread()) {
+        destroyWarmWindow();
+
+        SDL_SetWindowFullscreen(window, 0);
+        SDL_HideWindow(window);
+
+        // Don't let a parked window keep the display awake
+        SDL_EnableScreenSaver();
+
+        // The warm window keeps this session's video subsystem reference
+        s_WarmWindow = window;
+        int generation = ++s_WarmWindowGeneration;
+        QTimer::singleShot(WARM_WINDOW_TIMEOUT_MS, QCoreApplication::instance(), [generation] {
+            if (generation == s_WarmWindowGeneration) {
+                destroyWarmWindow();
+            }
+        });
         return;
     }
+#endif
 
-    // Wait for any old session to finish cleanup
-    s_ActiveSessionSemaphore.acquire();
-
-    // We're now active
-    s_ActiveSession = this;
+    if (window != nullptr) {
+        SDL_DestroyWindow(window);
+    }
+    StreamUtils::quitVideoSubsystem();
+}
 
-    // Initialize the gamepad code with our preferences
-    // NB: m_InputHandler must be initialize before starting the connection.
-    m_InputHandler = new SdlInputHandler(*m_Preferences, m_StreamConfig.width, m_StreamConfig.height);
+SDL_Window* Session::takeWarmWindow()
+{
+    SDL_Window* window = s_WarmWindow;
+    if (window == nullptr) {
+        return nullptr;
+    }
 
-    AsyncConnectionStartThread asyncConnThread(this);
-    if (!m_ThreadedExec) {
-        // Kick off the async connection thread while we sit here and pump the event loop
-        asyncConnThread.start();
-        while (!asyncConnThread.wait(10)) {
-            QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-            QCoreApplication::sendPostedEvents();
-        }
+    s_WarmWindow = nullptr;
+    s_WarmWindowGeneration++;
 
-        // Pump the event loop one last time to ensure we pick up any events from
-        // the thread that happened while it was in the final successful QThread::wait().
-        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-        QCoreApplication::sendPostedEvents();
-    }
-    else {
-        // We're already in a separate thread so run the connection operations
-        // synchronously and don't pump the event loop. The main thread is already
-        // pumping the event loop for us.
-        asyncConnThread.run();
+    // The window can't be reused if a renderer recreated it for another graphics API
+    Uint32 apiFlags = SDL_WINDOW_OPENGL | SDL_WINDOW_VULKAN | StreamUtils::getPlatformWindowFlags();
+    if ((SDL_GetWindowFlags(window) & apiFlags) != (StreamUtils::getPlatformWindowFlags() & apiFlags)) {
+        SDL_DestroyWindow(window);
+        window = nullptr;
     }
 
-    // If the connection failed, clean up and abort the connection.
-    if (!m_AsyncConnectionSuccess) {
-        delete m_InputHandler;
-        m_InputHandler = nullptr;
-        SDL_QuitSubSystem(SDL_INIT_VIDEO);
-        QThreadPool::globalInstance()->start(new DeferredSessionCleanupTask(this));
-        return;
+    // The new session holds its own reference on the video subsystem
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+
+    return window;
+}
+
+void Session::destroyWarmWindow()
+{
+    if (s_WarmWindow != nullptr) {
+        SDL_DestroyWindow(s_WarmWindow);
+        s_WarmWindow = nullptr;
+        s_WarmWindowGeneration++;
+
+        StreamUtils::quitVideoSubsystem();
     }
+}
 
+SDL_Window* Session::createWindow(bool hidden)
+{
     int x, y, width, height;
     getWindowDimensions(x, y, width, height);
 
@@ -1678,6 +1758,17 @@ void Session::execInternal()
 #endif
     }
 
+    // A window created before the connection is established stays hidden until
+    // it succeeds, so it doesn't cover the Qt UI or flash away if it fails. If
+    // we're going to be in full-screen desktop mode, create it that way now so
+    // it already has its final size when the decoder is created for it.
+    if (hidden) {
+        defaultWindowFlags |= SDL_WINDOW_HIDDEN;
+        if (m_IsFullScreen && m_FullScreenFlag == SDL_WINDOW_FULLSCREEN_DESKTOP) {
+            defaultWindowFlags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
+        }
+    }
+
     // We use only the computer name on macOS to match Apple conventions where the
     // app name is featured in the menu bar and the document name is in the title bar.
 #ifdef Q_OS_DARWIN
@@ -1686,35 +1777,268 @@ void Session::execInternal()
     std::string windowName = QString(m_Computer->name + " - Moonlight").toStdString();
 #endif
 
-    m_Window = SDL_CreateWindow(windowName.c_str(),
-                                x,
-                                y,
-                                width,
-                                height,
-                                defaultWindowFlags | StreamUtils::getPlatformWindowFlags());
-    if (!m_Window) {
+    // Reuse the previous session's window if it's still around
+    SDL_Window* window = m_ThreadedExec ? nullptr : takeWarmWindow();
+    if (window != nullptr) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Reusing window from previous session");
+
+        SDL_SetWindowTitle(window, windowName.c_str());
+        SDL_SetWindowSize(window, width, height);
+        SDL_SetWindowPosition(window, x, y);
+
+        // Discard any stale events from the previous session
+        SDL_PumpEvents();
+        SDL_FlushEvent(SDL_WINDOWEVENT);
+
+        SDL_ShowWindow(window);
+        if (defaultWindowFlags & SDL_WINDOW_MAXIMIZED) {
+            SDL_MaximizeWindow(window);
+        }
+        if (defaultWindowFlags & SDL_WINDOW_MINIMIZED) {
+            SDL_MinimizeWindow(window);
+        }
+        return window;
+    }
+
+    window = SDL_CreateWindow(windowName.c_str(),
+                              x,
+                              y,
+                              width,
+                              height,
+                              defaultWindowFlags | StreamUtils::getPlatformWindowFlags());
+    if (!window) {
         SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
                     "SDL_CreateWindow() failed with platform flags: %s",
                     SDL_GetError());
 
-        m_Window = SDL_CreateWindow(windowName.c_str(),
-                                    x,
-                                    y,
-                                    width,
-                                    height,
-                                    defaultWindowFlags);
-        if (!m_Window) {
+        window = SDL_CreateWindow(windowName.c_str(),
+                                  x,
+                                  y,
+                                  width,
+                                  height,
+                                  defaultWindowFlags);
+        if (!window) {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                          "SDL_CreateWindow() failed: %s",
                          SDL_GetError());
+        }
+    }
+
+    return window;
+}
+
+bool Session::shouldEnableVsync(SDL_Window* window)
+{
+    // If the stream exceeds the display refresh rate (plus some slack),
+    // forcefully disable V-sync to allow the stream to render faster
+    // than the display.
+    int displayHz = StreamUtils::getDisplayRefreshRate(window);
+    if (m_Preferences->enableVsync && displayHz + 5 < m_StreamConfig.fps) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Disabling V-sync because refresh rate limit exceeded");
+        return false;
+    }
+
+    return m_Preferences->enableVsync;
+}
 
-            delete m_InputHandler;
-            m_InputHandler = nullptr;
-            SDL_QuitSubSystem(SDL_INIT_VIDEO);
-            QThreadPool::globalInstance()->start(new DeferredSessionCleanupTask(this));
-            return;
+int Session::getExpectedVideoFormat()
+{
+    // This mirrors the codec negotiation in moonlight-common-c
+    int formats = m_StreamConfig.supportedVideoFormats;
+    int serverSupport = m_Computer->serverCodecModeSupport;
+
+    if ((formats & VIDEO_FORMAT_MASK_AV1) && (serverSupport & SCM_MASK_AV1)) {
+        if ((formats & VIDEO_FORMAT_AV1_MAIN10) && (serverSupport & SCM_AV1_MAIN10)) {
+            return VIDEO_FORMAT_AV1_MAIN10;
+        }
+        return VIDEO_FORMAT_AV1_MAIN8;
+    }
+    else if ((formats & VIDEO_FORMAT_MASK_H265) && (serverSupport & SCM_MASK_HEVC)) {
+        if ((formats & VIDEO_FORMAT_H265_MAIN10) && (serverSupport & SCM_HEVC_MAIN10)) {
+            return VIDEO_FORMAT_H265_MAIN10;
         }
+        return VIDEO_FORMAT_H265;
     }
+    else {
+        return VIDEO_FORMAT_H264;
+    }
+}
+
+EventLoopStats::EventLoopStats()
+{
+    SDL_zero(m_Iterations);
+    SDL_zero(m_TotalTimeUs);
+    SDL_zero(m_MaxTimeUs);
+}
+
+void EventLoopStats::recordIteration(Uint64 startCounter)
+{
+    int timeUs = (int)((SDL_GetPerformanceCounter() - startCounter) * 1000000 / SDL_GetPerformanceFrequency());
+
+    SDL_AtomicAdd(&m_Iterations, 1);
+    SDL_AtomicAdd(&m_TotalTimeUs, timeUs);
+
+    int maxTimeUs;
+    do {
+        maxTimeUs = SDL_AtomicGet(&m_MaxTimeUs);
+    } while (timeUs > maxTimeUs &&
+             !SDL_AtomicCAS(&m_MaxTimeUs, maxTimeUs, timeUs));
+}
+
+int EventLoopStats::stringify(char* output, int length)
+{
+    int iterations = SDL_AtomicSet(&m_Iterations, 0);
+    int totalTimeUs = SDL_AtomicSet(&m_TotalTimeUs, 0);
+    int maxTimeUs = SDL_AtomicSet(&m_MaxTimeUs, 0);
+
+    if (iterations == 0 || length <= 0) {
+        return 0;
+    }
+
+    int ret = snprintf(output, length,
+                       "Event loop iteration time: %.2f ms (max %.2f ms, %d iterations)\n",
+                       (float)totalTimeUs / iterations / 1000,
+                       (float)maxTimeUs / 1000,
+                       iterations);
+    if (ret < 0 || ret >= length) {
+        // Truncated
+        return length;
+    }
+
+    return ret;
+}
+
+void Session::execInternal()
+{
+    // Complete initialization in this deferred context to avoid
+    // calling expensive functions in the constructor (during the
+    // process of loading the StreamSegue).
+    //
+    // NB: This initializes the SDL video subsystem, so it must be
+    // called on the main thread.
+    StartupTracer::Span launchSpan("Session launch");
+
+    if (!initialize()) {
+        emit sessionFinished(0);
+        emit readyForDeletion();
+        return;
+    }
+
+    // Wait for any old session to finish cleanup
+    StartupTracer::Span waitSpan("Waiting for previous session");
+    s_ActiveSessionSemaphore.acquire();
+    waitSpan.end();
+
+    // We're now active
+    s_ActiveSession = this;
+
+    // Initialize the gamepad code with our preferences
+    // NB: m_InputHandler must be initialize before starting the connection.
+    m_InputHandler = new SdlInputHandler(*m_Preferences, m_StreamConfig.width, m_StreamConfig.height);
+
+    m_LaunchStartTime = SDL_GetTicks();
+
+    // Start the connection handshake in the background
+    AsyncConnectionStartThread asyncConnThread(this);
+    asyncConnThread.start();
+
+    // When we're on our own thread, create a hidden window and speculatively
+    // create the decoder for the format we expect the host to choose while the
+    // connection is being established. If the negotiated parameters match,
+    // drSetup() will have nothing left to do once the connection is up. This
+    // is skipped on the main thread where it would block the Qt event loop and
+    // for exclusive full-screen since the modeset may change the refresh rate.
+    SDL_Window* window = nullptr;
+    IVideoDecoder* speculativeDecoder = nullptr;
+    int speculativeVideoFormat = getExpectedVideoFormat();
+    if (m_ThreadedExec && !(m_IsFullScreen && m_FullScreenFlag == SDL_WINDOW_FULLSCREEN)) {
+        window = createWindow(true);
+        Uint32 windowReadyTime = SDL_GetTicks();
+
+        if (window != nullptr) {
+            bool enableVsync = shouldEnableVsync(window);
+            if (!chooseDecoder(m_Preferences->videoDecoderSelection,
+                               window, speculativeVideoFormat,
+                               m_StreamConfig.width, m_StreamConfig.height, m_StreamConfig.fps,
+                               enableVsync,
+                               enableVsync && m_Preferences->framePacing,
+                               false,
+                               speculativeDecoder)) {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                            "Unable to create speculative decoder");
+            }
+
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Launch phases: window %u ms, decoder %u ms",
+                        windowReadyTime - m_LaunchStartTime,
+                        SDL_GetTicks() - windowReadyTime);
+        }
+    }
+
+    if (!m_ThreadedExec) {
+        // Pump the event loop while we wait for the connection thread
+        while (!asyncConnThread.wait(10)) {
+            QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+            QCoreApplication::sendPostedEvents();
+        }
+
+        // Pump the event loop one last time to ensure we pick up any events from
+        // the thread that happened while it was in the final successful QThread::wait().
+        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+        QCoreApplication::sendPostedEvents();
+    }
+    else {
+        // We're already in a separate thread and the main thread is
+        // pumping the event loop for us. If our window already exists,
+        // keep processing its events while we wait.
+        while (!asyncConnThread.wait(10)) {
+            if (window != nullptr) {
+                SDL_PumpEvents();
+            }
+        }
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Connection established %u ms after launch",
+                SDL_GetTicks() - m_LaunchStartTime);
+
+    // Create the window now if it wasn't created during the connection
+    if (m_AsyncConnectionSuccess && window == nullptr) {
+        window = createWindow(false);
+    }
+
+    // If the connection failed, clean up and abort the connection.
+    if (!m_AsyncConnectionSuccess || window == nullptr) {
+        delete speculativeDecoder;
+        releaseWindow(window);
+        delete m_InputHandler;
+        m_InputHandler = nullptr;
+        QThreadPool::globalInstance()->start(new DeferredSessionCleanupTask(this));
+        return;
+    }
+
+    // Adopt the speculative decoder if the host chose what we expected
+    if (speculativeDecoder != nullptr) {
+        if (m_ActiveVideoFormat == speculativeVideoFormat &&
+                m_ActiveVideoWidth == m_StreamConfig.width &&
+                m_ActiveVideoHeight == m_StreamConfig.height &&
+                m_ActiveVideoFrameRate == m_StreamConfig.fps) {
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Speculative decoder adopted");
+        }
+        else {
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Speculative decoder discarded: expected %dx%dx%d (format 0x%x), got %dx%dx%d (format 0x%x)",
+                        m_StreamConfig.width, m_StreamConfig.height, m_StreamConfig.fps, speculativeVideoFormat,
+                        m_ActiveVideoWidth, m_ActiveVideoHeight, m_ActiveVideoFrameRate, m_ActiveVideoFormat);
+            delete speculativeDecoder;
+            speculativeDecoder = nullptr;
+        }
+    }
+
+    m_Window = window;
 
     // HACK: Remove once proper Dark Mode support lands in SDL
 #ifdef Q_OS_WIN32
@@ -1786,6 +2110,11 @@ void Session::execInternal()
     // for if/when we enter full-screen mode.
     updateOptimalWindowDisplayMode();
 
+    // Show the window if it was created hidden during the connection
+    if (SDL_GetWindowFlags(m_Window) & SDL_WINDOW_HIDDEN) {
+        SDL_ShowWindow(m_Window);
+    }
+
     // Enter full screen if requested
     if (m_IsFullScreen) {
         SDL_SetWindowFullscreen(m_Window, m_FullScreenFlag);
@@ -1856,12 +2185,33 @@ void Session::execInternal()
     // Start rich presence to indicate we're in game
     RichPresenceManager presence(*m_Preferences, m_App.name);
 
+    // Move gamepad event processing off this thread, since it
+    // can be blocked for a long time by rendering or window events.
+    m_InputHandler->startInputThread();
+
+    // Install the speculative decoder now that the window is in its final state.
+    // The SDL_WINDOWEVENT_SHOWN handler won't recreate it.
+    bool speculativeDecoderActive = speculativeDecoder != nullptr;
+    if (speculativeDecoder != nullptr) {
+        SDL_AtomicLock(&m_DecoderLock);
+        m_VideoDecoder = speculativeDecoder;
+        m_VideoDecoder->setHdrMode(LiGetCurrentHostDisplayHdrMode());
+        SDL_AtomicUnlock(&m_DecoderLock);
+
+        // Frames received before now were dropped
+        LiRequestIdrFrame();
+    }
+
+    launchSpan.end();
+
     // Toggle the stats overlay if requested by the user
     m_OverlayManager.setOverlayState(Overlay::OverlayDebug, m_Preferences->showPerformanceOverlay);
 
     // Hijack this thread to be the SDL main thread. We have to do this
     // because we want to suspend all Qt processing until the stream is over.
     SDL_Event event;
+    bool frameReadyPending = false;
+    int eventsSinceFrameReady = 0;
     for (;;) {
 #if SDL_VERSION_ATLEAST(2, 0, 18) && !defined(STEAM_LINK)
         // SDL 2.0.18 has a proper wait event implementation that uses platform
@@ -1894,6 +2244,8 @@ void Session::execInternal()
             continue;
         }
 #endif
+        Uint64 iterationStartCounter = SDL_GetPerformanceCounter();
+
         switch (event.type) {
         case SDL_QUIT:
             SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
@@ -1903,9 +2255,8 @@ void Session::execInternal()
         case SDL_USEREVENT:
             switch (event.user.code) {
             case SDL_CODE_FRAME_READY:
-                if (m_VideoDecoder != nullptr) {
-                    m_VideoDecoder->renderFrameOnMainThread();
-                }
+                // Presented below once the other queued events are handled
+                frameReadyPending = true;
                 break;
             case SDL_CODE_FLUSH_WINDOW_EVENT_BARRIER:
                 m_FlushingWindowEventsRef--;
@@ -1963,6 +2314,14 @@ void Session::execInternal()
                 needsFirstEnterCapture = false;
             }
 
+            // A speculatively created decoder is already in place when the window is first shown
+            if (needsPostDecoderCreationCapture && m_VideoDecoder != nullptr &&
+                    event.window.event == SDL_WINDOWEVENT_SHOWN) {
+                m_InputHandler->setCaptureActive(true);
+                m_InputHandler->updatePointerRegionLock();
+                needsPostDecoderCreationCapture = false;
+            }
+
             // We want to recreate the decoder for resizes (full-screen toggles) and the initial shown event.
             // We use SDL_WINDOWEVENT_SIZE_CHANGED rather than SDL_WINDOWEVENT_RESIZED because the latter doesn't
             // seem to fire when switching from windowed to full-screen on X11.
@@ -2065,11 +2424,26 @@ void Session::execInternal()
                             event.type);
             }
 
+            if (speculativeDecoderActive) {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                            "Replacing speculative decoder");
+                speculativeDecoderActive = false;
+            }
+
             SDL_AtomicLock(&m_DecoderLock);
 
             // Destroy the old decoder
             delete m_VideoDecoder;
 
+#ifdef HAVE_FFMPEG
+            // Pooled device contexts may belong to the GPU driving the old
+            // display or to a device that was lost, so don't reuse them.
+            if (event.type == SDL_RENDER_DEVICE_RESET ||
+                    currentDisplayIndex != SDL_GetWindowDisplayIndex(m_Window)) {
+                HwDevicePool::invalidate();
+            }
+#endif
+
             // Insert a barrier to discard any additional window events
             // that could cause the renderer to be and recreated again.
             // We don't use SDL_FlushEvent() here because it could cause
@@ -2091,16 +2465,7 @@ void Session::execInternal()
             SDL_FlushEvent(SDL_RENDER_TARGETS_RESET);
 
             {
-                // If the stream exceeds the display refresh rate (plus some slack),
-                // forcefully disable V-sync to allow the stream to render faster
-                // than the display.
-                int displayHz = StreamUtils::getDisplayRefreshRate(m_Window);
-                bool enableVsync = m_Preferences->enableVsync;
-                if (displayHz + 5 < m_StreamConfig.fps) {
-                    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
-                                "Disabling V-sync because refresh rate limit exceeded");
-                    enableVsync = false;
-                }
+                bool enableVsync = shouldEnableVsync(m_Window);
 
                 // Choose a new decoder (hopefully the same one, but possibly
                 // not if a GPU was removed or something).
@@ -2144,44 +2509,42 @@ void Session::execInternal()
         case SDL_KEYDOWN:
             presence.runCallbacks();
             m_InputHandler->handleKeyEvent(&event.key);
+            m_InputLatencyStats.record(InputLatencyStats::DC_KEYBOARD, event.key.timestamp);
             break;
         case SDL_MOUSEBUTTONDOWN:
         case SDL_MOUSEBUTTONUP:
             presence.runCallbacks();
             m_InputHandler->handleMouseButtonEvent(&event.button);
+            m_InputLatencyStats.record(InputLatencyStats::DC_MOUSE, event.button.timestamp);
             break;
         case SDL_MOUSEMOTION:
             m_InputHandler->handleMouseMotionEvent(&event.motion);
+            m_InputLatencyStats.record(InputLatencyStats::DC_MOUSE, event.motion.timestamp);
             break;
         case SDL_MOUSEWHEEL:
             m_InputHandler->handleMouseWheelEvent(&event.wheel);
-            break;
-        case SDL_CONTROLLERAXISMOTION:
-            m_InputHandler->handleControllerAxisEvent(&event.caxis);
+            m_InputLatencyStats.record(InputLatencyStats::DC_MOUSE, event.wheel.timestamp);
             break;
         case SDL_CONTROLLERBUTTONDOWN:
         case SDL_CONTROLLERBUTTONUP:
             presence.runCallbacks();
-            m_InputHandler->handleControllerButtonEvent(&event.cbutton);
-            break;
+            // Fall-through
+        case SDL_CONTROLLERAXISMOTION:
 #if SDL_VERSION_ATLEAST(2, 0, 14)
         case SDL_CONTROLLERSENSORUPDATE:
-            m_InputHandler->handleControllerSensorEvent(&event.csensor);
-            break;
         case SDL_CONTROLLERTOUCHPADDOWN:
         case SDL_CONTROLLERTOUCHPADUP:
         case SDL_CONTROLLERTOUCHPADMOTION:
-            m_InputHandler->handleControllerTouchpadEvent(&event.ctouchpad);
-            break;
 #endif
 #if SDL_VERSION_ATLEAST(2, 24, 0)
         case SDL_JOYBATTERYUPDATED:
-            m_InputHandler->handleJoystickBatteryEvent(&event.jbattery);
-            break;
 #endif
         case SDL_CONTROLLERDEVICEADDED:
         case SDL_CONTROLLERDEVICEREMOVED:
-            m_InputHandler->handleControllerDeviceEvent(&event.cdevice);
+            // These have already been handled if the input thread is running
+            if (!m_InputHandler->isInputThreadActive()) {
+                m_InputHandler->handleGamepadEvent(&event);
+            }
             break;
         case SDL_JOYDEVICEADDED:
             m_InputHandler->handleJoystickArrivalEvent(&event.jdevice);
@@ -2190,11 +2553,31 @@ void Session::execInternal()
         case SDL_FINGERMOTION:
         case SDL_FINGERUP:
             m_InputHandler->handleTouchFingerEvent(&event.tfinger);
+            m_InputLatencyStats.record(InputLatencyStats::DC_TOUCH, event.tfinger.timestamp);
             break;
         }
+
+        // Present the newest frame once the event queue is drained, or after a
+        // bounded number of other events if they keep arriving. Pacer won't post
+        // another frame ready event until this one has been consumed, so we must
+        // not go back to waiting with a frame still pending.
+        if (frameReadyPending &&
+                (++eventsSinceFrameReady >= MAX_EVENTS_BEFORE_RENDER ||
+                 !SDL_HasEvents(SDL_FIRSTEVENT, SDL_LASTEVENT))) {
+            if (m_VideoDecoder != nullptr) {
+                m_VideoDecoder->renderFrameOnMainThread();
+            }
+            frameReadyPending = false;
+            eventsSinceFrameReady = 0;
+        }
+
+        m_EventLoopStats.recordIteration(iterationStartCounter);
     }
 
 DispatchDeferredCleanup:
+    // Stop the input thread before we start tearing down the session
+    m_InputHandler->stopInputThread();
+
     // Uncapture the mouse and hide the window immediately,
     // so we can return to the Qt GUI ASAP.
     m_InputHandler->setCaptureActive(false);
@@ -2248,14 +2631,13 @@ DispatchDeferredCleanup:
 
     // This must be called after the decoder is deleted, because
     // the renderer may want to interact with the window
-    SDL_DestroyWindow(m_Window);
+    releaseWindow(m_Window);
+    m_Window = nullptr;
 
     if (iconSurface != nullptr) {
         SDL_FreeSurface(iconSurface);
     }
 
-    SDL_QuitSubSystem(SDL_INIT_VIDEO);
-
     Vban::Emitter::destroy();
 
     // Cleanup can take a while, so dispatch it to a worker thread.
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <QMutex>
 #include <QSemaphore>
+#include <QSet>
+#include <QWaitCondition>
 #include <QWindow>
 
 #include <Limelight.h>
@@ -11,6 +14,24 @@
 #include "audio/renderers/renderer.h"
 #include "video/overlaymanager.h"
 
+// Tracks how long the main thread spends handling events and presenting
+// frames per loop iteration, for the performance overlay
+class EventLoopStats
+{
+public:
+    EventLoopStats();
+
+    void recordIteration(Uint64 startCounter);
+
+    // Prints the stats since the last call and starts a new window
+    int stringify(char* output, int length);
+
+private:
+    SDL_atomic_t m_Iterations;
+    SDL_atomic_t m_TotalTimeUs;
+    SDL_atomic_t m_MaxTimeUs;
+};
+
 class Session : public QObject
 {
     Q_OBJECT
@@ -44,6 +65,16 @@ public:
         return m_OverlayManager;
     }
 
+    InputLatencyStats& getInputLatencyStats()
+    {
+        return m_InputLatencyStats;
+    }
+
+    EventLoopStats& getEventLoopStats()
+    {
+        return m_EventLoopStats;
+    }
+
     void flushWindowEvents();
 
 signals:
@@ -88,6 +119,29 @@ private:
     void getWindowDimensions(int& x, int& y,
                              int& width, int& height);
 
+    // Creates the streaming window (or reuses the previous session's)
+    // shown in its initial maximized or minimized state
+    SDL_Window* createWindow(bool hidden);
+
+    // Parks the window for reuse by the next session or destroys it,
+    // then drops this session's reference on the SDL video subsystem
+    void releaseWindow(SDL_Window* window);
+
+    static
+    SDL_Window* takeWarmWindow();
+
+    static
+    void destroyWarmWindow();
+
+    // Blocks until any app quit requested by a previous session has finished
+    static
+    void waitForPendingQuit(NvComputer* computer);
+
+    bool shouldEnableVsync(SDL_Window* window);
+
+    // Returns the video format the host is expected to negotiate
+    int getExpectedVideoFormat();
+
     void toggleFullscreen();
 
     void notifyMouseEmulationMode(bool enabled);
@@ -184,6 +238,9 @@ private:
     int m_ActiveVideoHeight;
     int m_ActiveVideoFrameRate;
 
+    Uint32 m_LaunchStartTime;
+    bool m_FirstFrameSubmitted; // Only accessed by the decoder thread
+
     OpusMSDecoder* m_OpusDecoder;
     IAudioRenderer* m_AudioRenderer;
     OPUS_MULTISTREAM_CONFIGURATION m_ActiveAudioConfig;
@@ -192,8 +249,17 @@ private:
     Uint32 m_DropAudioEndTime;
 
     Overlay::OverlayManager m_OverlayManager;
+    InputLatencyStats m_InputLatencyStats;
+    EventLoopStats m_EventLoopStats;
 
     static CONNECTION_LISTENER_CALLBACKS k_ConnCallbacks;
     static Session* s_ActiveSession;
     static QSemaphore s_ActiveSessionSemaphore;
+
+    static SDL_Window* s_WarmWindow; // Only accessed on the main thread
+    static int s_WarmWindowGeneration;
+
+    static QMutex s_PendingQuitLock;
+    static QWaitCondition s_PendingQuitCondition;
+    static QSet<NvComputer*> s_PendingQuitComputers; // Protected by s_PendingQuitLock
 };
@@ -1,5 +1,9 @@
 #include "streamutils.h"
 
+#ifdef HAVE_FFMPEG
+#include "video/ffmpeg-renderers/hwdevicepool.h"
+#endif
+
 #include <Qt>
 
 #ifdef Q_OS_DARWIN
@@ -306,3 +310,14 @@ bool StreamUtils::getNativeDesktopMode(int displayIndex, SDL_DisplayMode* mode,
     return true;
 }
 
+void StreamUtils::quitVideoSubsystem()
+{
+#ifdef HAVE_FFMPEG
+    // We can't tell whether this is the last reference, so drop the pool
+    // whenever a reference is released. Renderers hold their own references,
+    // so contexts in use stay alive until they're destroyed.
+    HwDevicePool::invalidate();
+#endif
+
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+}
@@ -36,4 +36,10 @@ public:
 
     static
     bool hasFastAes();
+
+    // Releases a reference on the SDL video subsystem. This must be used
+    // instead of SDL_QuitSubSystem(SDL_INIT_VIDEO), since pooled decoder
+    // device contexts may reference the native display it owns.
+    static
+    void quitVideoSubsystem();
 };
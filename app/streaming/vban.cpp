@@ -1,7 +1,39 @@
 #include "vban.h"
 
+#include <QtMath>
+
 namespace Vban {
 
+// Gate timings, in milliseconds
+static constexpr int GATE_ATTACK_MS = 10;
+static constexpr int GATE_HANGOVER_MS = 400;
+static constexpr int GATE_KEEPALIVE_MS = 1000;
+
+// Sum of squares using independent accumulator lanes, so the compiler
+// can vectorize the loop without reassociating a single accumulator.
+template <typename T, typename Acc>
+static Acc sumOfSquares(const T* samples, int count) {
+    constexpr int LANES = 8;
+    Acc lanes[LANES] = {};
+
+    int i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        for (int lane = 0; lane < LANES; ++lane) {
+            Acc sample = static_cast<Acc>(samples[i + lane]);
+            lanes[lane] += sample * sample;
+        }
+    }
+
+    Acc sum = 0;
+    for (int lane = 0; lane < LANES; ++lane)
+        sum += lanes[lane];
+    for (; i < count; ++i) {
+        Acc sample = static_cast<Acc>(samples[i]);
+        sum += sample * sample;
+    }
+    return sum;
+}
+
 const QMap<int, Header::SampleRate> Header::k_SampleRateMap {
     {6000, VBAN_SR_6000},
     {12000, VBAN_SR_12000},
@@ -33,13 +65,16 @@ const QMap<SDL_AudioFormat, Header::DataType> Header::k_DataTypeMap {
     {AUDIO_F32, VBAN_DATATYPE_FLOAT32}
 };
 
-void Emitter::init(const QHostAddress& addr, uint16_t port, QObject *parent) {
+void Emitter::init(const QHostAddress& addr, uint16_t port, QObject *parent,
+                   GateMode gateMode, int gateThresholdDb) {
     if (s_Emitter)
         destroy();
 
     SDL_InitSubSystem(SDL_INIT_AUDIO);
 
     s_Emitter = new Emitter(parent);
+    s_Emitter->m_GateMode = gateMode;
+    s_Emitter->m_GateThreshold = qPow(10.0, gateThresholdDb / 10.0);
     s_Thread = new QThread();
     s_Emitter->moveToThread(s_Thread);
     s_Thread->start();
@@ -68,7 +103,11 @@ void Emitter::destroy() {
     qInfo("[VBAN Emitter] Destroyed successfully.");
 }
 
-Emitter::Emitter(QObject *parent) : QUdpSocket(parent) {
+Emitter::Emitter(QObject *parent) : QUdpSocket(parent),
+    m_AudioDeviceId(0), m_AudioFormat(0), m_BytesPerFrame(0), m_Freq(0), m_Silence(0),
+    m_GateMode(GATE_OFF), m_GateThreshold(0), m_GateOpen(false),
+    m_GateAttackFrames(0), m_GateHangoverFrames(0), m_GateKeepaliveFrames(0),
+    m_ActiveFrames(0), m_InactiveFrames(0), m_FramesSinceKeepalive(0) {
     connect(this, &Emitter::sendSignal, this, &Emitter::handleSend);
 }
 
@@ -116,6 +155,20 @@ bool Emitter::bind(const QHostAddress& addr, uint16_t port) {
         }
     }
 
+    m_AudioFormat = obtained.format;
+    m_BytesPerFrame = SDL_AUDIO_BITSIZE(obtained.format) / 8 * obtained.channels;
+    m_Freq = obtained.freq;
+    m_Silence = obtained.silence;
+
+    m_GateAttackFrames = m_Freq * GATE_ATTACK_MS / 1000;
+    m_GateHangoverFrames = m_Freq * GATE_HANGOVER_MS / 1000;
+    m_GateKeepaliveFrames = m_Freq * GATE_KEEPALIVE_MS / 1000;
+    m_GateOpen = false;
+    if (m_GateMode != GATE_OFF) {
+        qInfo("[VBAN Emitter] Voice activity gate: mode[%d] threshold[%.1f dBFS]",
+              m_GateMode, 10 * log10(m_GateThreshold));
+    }
+
     m_ClientAddress = addr;
     m_ClientPort = port;
 
@@ -135,11 +188,80 @@ void Emitter::handleSend(const QByteArray& data) {
     }
 }
 
+double Emitter::meanSquare(const uint8_t* stream, int len, SDL_AudioFormat format) {
+    switch (format) {
+        case AUDIO_S8: {
+            int count = len / sizeof(int8_t);
+            int32_t sum = sumOfSquares<int8_t, int32_t>(reinterpret_cast<const int8_t*>(stream), count);
+            return count ? sum / (count * 128.0 * 128.0) : 0;
+        }
+        case AUDIO_S16: {
+            int count = len / sizeof(int16_t);
+            int64_t sum = sumOfSquares<int16_t, int64_t>(reinterpret_cast<const int16_t*>(stream), count);
+            return count ? sum / (count * 32768.0 * 32768.0) : 0;
+        }
+        case AUDIO_S32: {
+            int count = len / sizeof(int32_t);
+            double sum = sumOfSquares<int32_t, double>(reinterpret_cast<const int32_t*>(stream), count);
+            return count ? sum / (count * 2147483648.0 * 2147483648.0) : 0;
+        }
+        case AUDIO_F32: {
+            int count = len / sizeof(float);
+            float sum = sumOfSquares<float, float>(reinterpret_cast<const float*>(stream), count);
+            return count ? sum / count : 0;
+        }
+        default:
+            // Unknown format, never gate it
+            return 1.0;
+    }
+}
+
+bool Emitter::updateGate(const uint8_t* stream, int len) {
+    if (m_GateMode == GATE_OFF)
+        return true;
+
+    uint32_t frames = m_BytesPerFrame ? len / m_BytesPerFrame : 0;
+    if (meanSquare(stream, len, m_AudioFormat) >= m_GateThreshold) {
+        m_InactiveFrames = 0;
+        m_ActiveFrames += frames;
+        if (!m_GateOpen && m_ActiveFrames >= m_GateAttackFrames) {
+            m_GateOpen = true;
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "[VBAN Emitter] Gate opened");
+        }
+    } else {
+        m_ActiveFrames = 0;
+        if (m_GateOpen) {
+            m_InactiveFrames += frames;
+            if (m_InactiveFrames >= m_GateHangoverFrames) {
+                m_GateOpen = false;
+                m_FramesSinceKeepalive = 0;
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "[VBAN Emitter] Gate closed");
+            }
+        }
+    }
+
+    if (!m_GateOpen && m_GateMode == GATE_KEEPALIVE) {
+        m_FramesSinceKeepalive += frames;
+    }
+
+    return m_GateOpen;
+}
+
 void Emitter::send(void*, uint8_t* stream, int len) {
     if (!s_Emitter)
         return;
 
-    emit s_Emitter->sendSignal(QByteArray(reinterpret_cast<char *>(stream), len));
+    if (s_Emitter->updateGate(stream, len)) {
+        emit s_Emitter->sendSignal(QByteArray(reinterpret_cast<char *>(stream), len));
+    } else if (s_Emitter->m_GateMode == GATE_KEEPALIVE &&
+               s_Emitter->m_FramesSinceKeepalive >= s_Emitter->m_GateKeepaliveFrames) {
+        // A single silent packet keeps receivers from timing out the stream.
+        // nuFrame is only advanced for packets actually sent, so the sequence
+        // stays contiguous when the gate opens again.
+        s_Emitter->m_FramesSinceKeepalive = 0;
+        emit s_Emitter->sendSignal(QByteArray(s_Emitter->m_PacketDataLen,
+                                              static_cast<char>(s_Emitter->m_Silence)));
+    }
 }
 
 Emitter* Emitter::s_Emitter = nullptr;
@@ -105,8 +105,15 @@ class Emitter : public QUdpSocket {
     Q_OBJECT
 
 public:
+    enum GateMode {
+        GATE_OFF,           // stream continuously
+        GATE_SILENCE,       // send nothing while gated
+        GATE_KEEPALIVE      // send a silent frame periodically while gated
+    };
+
     static
-    void init(const QHostAddress& addr, uint16_t port = 6980, QObject *parent = nullptr);
+    void init(const QHostAddress& addr, uint16_t port = 6980, QObject *parent = nullptr,
+              GateMode gateMode = GATE_OFF, int gateThresholdDb = -50);
 
     static
     void destroy();
@@ -126,7 +133,27 @@ private:
     static
     void send(void*, uint8_t* stream, int len);
 
+    static
+    double meanSquare(const uint8_t* stream, int len, SDL_AudioFormat format);
+
+    bool updateGate(const uint8_t* stream, int len);
+
     SDL_AudioDeviceID m_AudioDeviceId;
+    SDL_AudioFormat m_AudioFormat;
+    int m_BytesPerFrame;
+    int m_Freq;
+    uint8_t m_Silence;
+
+    // Voice activity gate, only touched by the SDL audio callback
+    GateMode m_GateMode;
+    double m_GateThreshold;     // Normalized mean square (0.0 - 1.0)
+    bool m_GateOpen;
+    uint32_t m_GateAttackFrames;
+    uint32_t m_GateHangoverFrames;
+    uint32_t m_GateKeepaliveFrames;
+    uint32_t m_ActiveFrames;
+    uint32_t m_InactiveFrames;
+    uint32_t m_FramesSinceKeepalive;
 
     struct {
         Header header;
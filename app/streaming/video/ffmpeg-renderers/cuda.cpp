@@ -1,4 +1,5 @@
 #include "cuda.h"
+#include "hwdevicepool.h"
 
 #include <SDL_opengl.h>
 
@@ -17,17 +18,20 @@ CUDARenderer::~CUDARenderer()
 
 bool CUDARenderer::initialize(PDECODER_PARAMETERS)
 {
-    int err;
-
-    err = av_hwdevice_ctx_create(&m_HwContext, AV_HWDEVICE_TYPE_CUDA, nullptr, nullptr, 0);
-    if (err != 0) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "av_hwdevice_ctx_create(CUDA) failed: %d",
-                     err);
-        return false;
-    }
+    // The CUDA context doesn't depend on the window system
+    m_HwContext = HwDevicePool::acquire(AV_HWDEVICE_TYPE_CUDA, 0, [] {
+        AVBufferRef* hwContext = nullptr;
+        int err = av_hwdevice_ctx_create(&hwContext, AV_HWDEVICE_TYPE_CUDA, nullptr, nullptr, 0);
+        if (err != 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "av_hwdevice_ctx_create(CUDA) failed: %d",
+                         err);
+            return (AVBufferRef*)nullptr;
+        }
+        return hwContext;
+    });
 
-    return true;
+    return m_HwContext != nullptr;
 }
 
 bool CUDARenderer::prepareDecoderContext(AVCodecContext* context, AVDictionary**)
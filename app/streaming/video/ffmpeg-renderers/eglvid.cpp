@@ -6,6 +6,9 @@
 #include "streaming/streamutils.h"
 
 #include <QDir>
+#include <QFile>
+#include <QDataStream>
+#include <QCryptographicHash>
 
 #include <Limelight.h>
 #include <unistd.h>
@@ -26,6 +29,18 @@
 #ifndef GL_UNPACK_ROW_LENGTH_EXT
 #define GL_UNPACK_ROW_LENGTH_EXT 0x0CF2
 #endif
+#ifndef GL_PROGRAM_BINARY_LENGTH_OES
+#define GL_PROGRAM_BINARY_LENGTH_OES 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS_OES
+#define GL_NUM_PROGRAM_BINARY_FORMATS_OES 0x87FE
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+#define PROGRAM_CACHE_MAGIC 0x4D4C5042
+#define PROGRAM_CACHE_VERSION 1
 
 typedef struct _OVERLAY_VERTEX
 {
@@ -80,6 +95,9 @@ EGLRenderer::EGLRenderer(IFFmpegRenderer *backendRenderer)
         m_glGenVertexArraysOES(nullptr),
         m_glBindVertexArrayOES(nullptr),
         m_glDeleteVertexArraysOES(nullptr),
+        m_glGetProgramBinaryOES(nullptr),
+        m_glProgramBinaryOES(nullptr),
+        m_glProgramParameteri(nullptr),
         m_eglCreateSync(nullptr),
         m_eglCreateSyncKHR(nullptr),
         m_eglDestroySync(nullptr),
@@ -363,8 +381,106 @@ bool EGLRenderer::openDisplay(unsigned int platform, void* nativeDisplay)
     return m_EGLDisplay != EGL_NO_DISPLAY;
 }
 
+QString EGLRenderer::getProgramCacheFileName(const char* vertexShaderSrc, const char* fragmentShaderSrc)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    // Program binaries are only valid for the exact driver and GPU
+    // that produced them, and for the exact shader sources.
+    hash.addData(QByteArray((const char*)glGetString(GL_VENDOR)));
+    hash.addData(QByteArray((const char*)glGetString(GL_RENDERER)));
+    hash.addData(QByteArray((const char*)glGetString(GL_VERSION)));
+    hash.addData(QByteArray(vertexShaderSrc));
+    hash.addData(Path::readDataFile(vertexShaderSrc));
+    hash.addData(QByteArray(fragmentShaderSrc));
+    hash.addData(Path::readDataFile(fragmentShaderSrc));
+
+    return QString("egl_%1.bin").arg(QString(hash.result().toHex()));
+}
+
+unsigned EGLRenderer::loadCachedProgram(const QString& cacheFileName)
+{
+    QFile cacheFile(Path::getCacheFileInfo(cacheFileName).absoluteFilePath());
+    if (!cacheFile.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    QDataStream stream(&cacheFile);
+    stream.setVersion(QDataStream::Qt_5_9);
+
+    quint32 magic = 0, version = 0, format = 0;
+    QByteArray binary;
+    stream >> magic >> version >> format >> binary;
+    cacheFile.close();
+
+    if (stream.status() != QDataStream::Ok ||
+            magic != PROGRAM_CACHE_MAGIC ||
+            version != PROGRAM_CACHE_VERSION ||
+            binary.isEmpty()) {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    if (!program) {
+        return 0;
+    }
+
+    m_glProgramBinaryOES(program, format, binary.constData(), binary.size());
+
+    int status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+        // The driver may reject binaries from an older build of itself
+        // even if the version string didn't change.
+        EGL_LOG(Info, "Discarding rejected program binary: %s",
+                qPrintable(cacheFileName));
+        glDeleteProgram(program);
+        Path::deleteCacheFile(cacheFileName);
+        return 0;
+    }
+
+    return program;
+}
+
+void EGLRenderer::saveCachedProgram(const QString& cacheFileName, unsigned program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    QByteArray binary(length, 0);
+    GLsizei writtenLength = 0;
+    GLenum format = 0;
+    m_glGetProgramBinaryOES(program, length, &writtenLength, &format, binary.data());
+    if (writtenLength <= 0) {
+        EGL_LOG(Warn, "glGetProgramBinaryOES() failed: %d", glGetError());
+        return;
+    }
+    binary.truncate(writtenLength);
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_9);
+    stream << (quint32)PROGRAM_CACHE_MAGIC << (quint32)PROGRAM_CACHE_VERSION
+           << (quint32)format << binary;
+    Path::writeCacheFile(cacheFileName, data);
+}
+
 unsigned EGLRenderer::compileShader(const char* vertexShaderSrc, const char* fragmentShaderSrc) {
     unsigned shader = 0;
+    QString cacheFileName;
+
+    // Try to skip compilation entirely by loading the program binary
+    // that we saved the last time we built these shaders.
+    if (m_glProgramBinaryOES != nullptr) {
+        cacheFileName = getProgramCacheFileName(vertexShaderSrc, fragmentShaderSrc);
+        shader = loadCachedProgram(cacheFileName);
+        if (shader) {
+            return shader;
+        }
+    }
 
     GLuint vertexShader = loadAndBuildShader(GL_VERTEX_SHADER, vertexShaderSrc);
     if (!vertexShader)
@@ -382,6 +498,10 @@ unsigned EGLRenderer::compileShader(const char* vertexShaderSrc, const char* fra
 
     glAttachShader(shader, vertexShader);
     glAttachShader(shader, fragmentShader);
+    if (!cacheFileName.isEmpty() && m_glProgramParameteri != nullptr) {
+        // OpenGL ES 3.0 drivers may not keep the binary around unless we ask
+        m_glProgramParameteri(shader, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(shader);
     int status;
     glGetProgramiv(shader, GL_LINK_STATUS, &status);
@@ -392,6 +512,9 @@ unsigned EGLRenderer::compileShader(const char* vertexShaderSrc, const char* fra
         glDeleteProgram(shader);
         shader = 0;
     }
+    else if (!cacheFileName.isEmpty()) {
+        saveCachedProgram(cacheFileName, shader);
+    }
 
 progFailCreate:
     glDeleteShader(fragmentShader);
@@ -635,6 +758,35 @@ bool EGLRenderer::initialize(PDECODER_PARAMETERS params)
         return false;
     }
 
+    // Program binaries are an extension on OpenGL ES 2.0
+    if (SDL_GL_ExtensionSupported("GL_OES_get_program_binary")) {
+        m_glGetProgramBinaryOES = (typeof(m_glGetProgramBinaryOES))eglGetProcAddress("glGetProgramBinaryOES");
+        m_glProgramBinaryOES = (typeof(m_glProgramBinaryOES))eglGetProcAddress("glProgramBinaryOES");
+    }
+    else if (m_GlesMajorVersion >= 3) {
+        // They are included in OpenGL ES 3.0 as part of the standard
+        m_glGetProgramBinaryOES = (typeof(m_glGetProgramBinaryOES))eglGetProcAddress("glGetProgramBinary");
+        m_glProgramBinaryOES = (typeof(m_glProgramBinaryOES))eglGetProcAddress("glProgramBinary");
+        m_glProgramParameteri = (typeof(m_glProgramParameteri))eglGetProcAddress("glProgramParameteri");
+    }
+
+    if (m_glGetProgramBinaryOES && m_glProgramBinaryOES) {
+        // Drivers may expose the functions without supporting any binary formats
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formatCount);
+        if (formatCount <= 0) {
+            m_glGetProgramBinaryOES = nullptr;
+            m_glProgramBinaryOES = nullptr;
+            m_glProgramParameteri = nullptr;
+        }
+    }
+    else {
+        // Sub-optimal, but not fatal. We'll just compile our shaders each time.
+        m_glGetProgramBinaryOES = nullptr;
+        m_glProgramBinaryOES = nullptr;
+        m_glProgramParameteri = nullptr;
+    }
+
     // EGL_KHR_fence_sync is an extension for EGL 1.1+
     if (eglExtensions.isSupported("EGL_KHR_fence_sync")) {
         // eglCreateSyncKHR() has a slightly different prototype to eglCreateSync()
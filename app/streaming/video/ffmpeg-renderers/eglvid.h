@@ -2,6 +2,8 @@
 
 #include "renderer.h"
 
+#include <QString>
+
 #define SDL_USE_BUILTIN_OPENGL_DEFINITIONS 1
 #include <SDL_egl.h>
 #include <SDL_opengles2.h>
@@ -31,6 +33,9 @@ private:
     const float *getColorOffsets(const AVFrame* frame);
     const float *getColorMatrix(const AVFrame* frame);
     static int loadAndBuildShader(int shaderType, const char *filename);
+    static QString getProgramCacheFileName(const char* vertexShaderSrc, const char* fragmentShaderSrc);
+    unsigned loadCachedProgram(const QString& cacheFileName);
+    void saveCachedProgram(const QString& cacheFileName, unsigned program);
     bool openDisplay(unsigned int platform, void* nativeDisplay);
 
     AVPixelFormat m_EGLImagePixelFormat;
@@ -52,6 +57,9 @@ private:
     PFNGLGENVERTEXARRAYSOESPROC m_glGenVertexArraysOES;
     PFNGLBINDVERTEXARRAYOESPROC m_glBindVertexArrayOES;
     PFNGLDELETEVERTEXARRAYSOESPROC m_glDeleteVertexArraysOES;
+    PFNGLGETPROGRAMBINARYOESPROC m_glGetProgramBinaryOES;
+    PFNGLPROGRAMBINARYOESPROC m_glProgramBinaryOES;
+    PFNGLPROGRAMPARAMETERIEXTPROC m_glProgramParameteri;
     PFNEGLCREATESYNCPROC m_eglCreateSync;
     PFNEGLCREATESYNCKHRPROC m_eglCreateSyncKHR;
     PFNEGLDESTROYSYNCPROC m_eglDestroySync;
@@ -0,0 +1,65 @@
+#include "hwdevicepool.h"
+
+#include <SDL.h>
+
+QMutex HwDevicePool::s_Lock;
+QVector<HwDevicePool::Entry> HwDevicePool::s_Entries;
+
+AVBufferRef* HwDevicePool::acquire(AVHWDeviceType type, quintptr nativeDisplay,
+                                   std::function<AVBufferRef*()> factory)
+{
+    {
+        QMutexLocker locker(&s_Lock);
+
+        for (const Entry& entry : s_Entries) {
+            if (entry.type == type && entry.nativeDisplay == nativeDisplay) {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                            "Reusing pooled %s device context",
+                            av_hwdevice_get_type_name(type));
+                return av_buffer_ref(entry.deviceContext);
+            }
+        }
+    }
+
+    // Create the context without holding the lock, since this can be slow
+    // and contexts of other types may be requested concurrently.
+    AVBufferRef* deviceContext = factory();
+    if (deviceContext == nullptr) {
+        return nullptr;
+    }
+
+    QMutexLocker locker(&s_Lock);
+
+    // If another caller created the same context while we were, use theirs
+    for (const Entry& entry : s_Entries) {
+        if (entry.type == type && entry.nativeDisplay == nativeDisplay) {
+            av_buffer_unref(&deviceContext);
+            return av_buffer_ref(entry.deviceContext);
+        }
+    }
+
+    Entry entry;
+    entry.type = type;
+    entry.nativeDisplay = nativeDisplay;
+    entry.deviceContext = av_buffer_ref(deviceContext);
+    if (entry.deviceContext != nullptr) {
+        s_Entries.append(entry);
+    }
+
+    return deviceContext;
+}
+
+void HwDevicePool::invalidate()
+{
+    QVector<Entry> entries;
+
+    {
+        QMutexLocker locker(&s_Lock);
+        entries.swap(s_Entries);
+    }
+
+    // Contexts may be freed here, so do it outside the lock
+    for (Entry& entry : entries) {
+        av_buffer_unref(&entry.deviceContext);
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QMutex>
+#include <QVector>
+
+#include <functional>
+
+extern "C" {
+#include <libavutil/hwcontext.h>
+}
+
+// Process-wide cache of FFmpeg hardware device contexts. Creating these is
+// one of the slowest parts of renderer initialization, so a context is shared
+// by the decoder probes, decoder recreation, and following sessions.
+//
+// Contexts that use the SDL video subsystem's native display must be keyed
+// by that display. The pool must be invalidated before the SDL video subsystem
+// is shut down and when the stream moves to another display.
+class HwDevicePool
+{
+public:
+    // Returns a new reference to the pooled context for this device type and
+    // native display, calling the factory to create it if there isn't one.
+    // The factory returns nullptr on failure. Failures are not cached.
+    static AVBufferRef* acquire(AVHWDeviceType type, quintptr nativeDisplay,
+                                std::function<AVBufferRef*()> factory);
+
+    // Drops all pooled contexts. Contexts still in use by renderers are
+    // freed when their last reference is released.
+    static void invalidate();
+
+private:
+    struct Entry
+    {
+        AVHWDeviceType type;
+        quintptr nativeDisplay;
+        AVBufferRef* deviceContext;
+    };
+
+    static QMutex s_Lock;
+    static QVector<Entry> s_Entries; // Protected by s_Lock
+};
@@ -38,7 +38,7 @@ Pacer::Pacer(IFFmpegRenderer* renderer, PVIDEO_STATS videoStats) :
     m_DisplayFps(0),
     m_VideoStats(videoStats)
 {
-
+    SDL_zero(m_FrameReadyPending);
 }
 
 Pacer::~Pacer()
@@ -85,8 +85,24 @@ void Pacer::renderOnMainThread()
         return;
     }
 
+    // Clear the pending flag before looking at the queue, so a frame
+    // enqueued after this point will always post a new event.
+    SDL_AtomicSet(&m_FrameReadyPending, 0);
+
     m_FrameQueueLock.lock();
 
+    // Only the newest frame is worth presenting. Anything older was
+    // superseded while we were busy handling other events.
+    while (m_RenderQueue.count() > 1) {
+        AVFrame* frame = m_RenderQueue.dequeue();
+
+        // Drop the lock while we call av_frame_free()
+        m_FrameQueueLock.unlock();
+        m_VideoStats->pacerDroppedFrames++;
+        av_frame_free(&frame);
+        m_FrameQueueLock.lock();
+    }
+
     if (!m_RenderQueue.isEmpty()) {
         AVFrame* frame = m_RenderQueue.dequeue();
         m_FrameQueueLock.unlock();
@@ -183,13 +199,18 @@ void Pacer::enqueueFrameForRenderingAndUnlock(AVFrame *frame)
     if (m_RenderThread != nullptr) {
         m_RenderQueueNotEmpty.wakeOne();
     }
-    else {
+    else if (SDL_AtomicCAS(&m_FrameReadyPending, 0, 1)) {
         SDL_Event event;
 
-        // For main thread rendering, we'll push an event to trigger a callback
+        // For main thread rendering, we'll push an event to trigger a callback.
+        // Only one of these is outstanding at a time, since renderOnMainThread()
+        // always picks up the newest frame in the queue.
         event.type = SDL_USEREVENT;
         event.user.code = SDL_CODE_FRAME_READY;
-        SDL_PushEvent(&event);
+        if (SDL_PushEvent(&event) <= 0) {
+            // Let the next frame try again
+            SDL_AtomicSet(&m_FrameReadyPending, 0);
+        }
     }
 }
 
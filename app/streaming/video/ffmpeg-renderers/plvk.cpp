@@ -1,8 +1,12 @@
 #include "plvk.h"
 
+#include "path.h"
 #include "streaming/session.h"
 #include "streaming/streamutils.h"
 
+#include <QFile>
+#include <QCryptographicHash>
+
 // Implementation in plvk_c.c
 #define PL_LIBAV_IMPLEMENTATION 0
 #include <libplacebo/utils/libav.h>
@@ -129,10 +133,17 @@ PlVkRenderer::~PlVkRenderer()
         }
     }
 
+    saveShaderCache();
+
     pl_renderer_destroy(&m_Renderer);
     pl_swapchain_destroy(&m_Swapchain);
     pl_vulkan_destroy(&m_Vulkan);
 
+#if PL_API_VER >= 338
+    // This must be destroyed after the GPU that uses it
+    pl_cache_destroy(&m_Cache);
+#endif
+
     // This surface was created by SDL, so there's no libplacebo API to destroy it
     if (fn_vkDestroySurfaceKHR && m_VkSurface) {
         fn_vkDestroySurfaceKHR(m_PlVkInstance->instance, m_VkSurface, nullptr);
@@ -313,9 +324,83 @@ bool PlVkRenderer::tryInitializeDevice(VkPhysicalDevice device, VkPhysicalDevice
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                 "Vulkan rendering device chosen: %s",
                 deviceProps->deviceName);
+
+    loadShaderCache(deviceProps);
     return true;
 }
 
+void PlVkRenderer::loadShaderCache(VkPhysicalDeviceProperties* deviceProps)
+{
+#if PL_API_VER >= 338
+    SDL_assert(m_Cache == nullptr);
+    SDL_assert(m_Vulkan != nullptr);
+
+    // Pipelines are only valid for the exact GPU and driver that built them
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::fromRawData((const char*)deviceProps->pipelineCacheUUID, VK_UUID_SIZE));
+    hash.addData(QByteArray::number(deviceProps->vendorID));
+    hash.addData(QByteArray::number(deviceProps->deviceID));
+    hash.addData(QByteArray::number(deviceProps->driverVersion));
+    hash.addData(QByteArray::number(PL_API_VER));
+    m_CacheFileName = QString("plvk_%1.bin").arg(QString(hash.result().toHex()));
+
+    pl_cache_params cacheParams = {};
+    cacheParams.log = m_Log;
+    cacheParams.max_total_size = 50 << 20;
+    cacheParams.max_object_size = cacheParams.max_total_size;
+    m_Cache = pl_cache_create(&cacheParams);
+    if (m_Cache == nullptr) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "pl_cache_create() failed");
+        return;
+    }
+
+    QFile cacheFile(Path::getCacheFileInfo(m_CacheFileName).absoluteFilePath());
+    if (cacheFile.open(QIODevice::ReadOnly)) {
+        QByteArray data = cacheFile.readAll();
+        cacheFile.close();
+
+        // libplacebo validates the data itself and ignores it if it's unusable
+        int objects = pl_cache_load(m_Cache, (const uint8_t*)data.constData(), data.size());
+        if (objects < 0) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                        "Discarding invalid shader cache: %s",
+                        qPrintable(m_CacheFileName));
+            Path::deleteCacheFile(m_CacheFileName);
+        }
+        else {
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Loaded %d objects from shader cache",
+                        objects);
+        }
+    }
+
+    m_LoadedCacheSignature = pl_cache_signature(m_Cache);
+    pl_gpu_set_cache(m_Vulkan->gpu, m_Cache);
+#else
+    Q_UNUSED(deviceProps);
+#endif
+}
+
+void PlVkRenderer::saveShaderCache()
+{
+#if PL_API_VER >= 338
+    // Only write the cache back if we compiled anything new
+    if (m_Cache == nullptr || pl_cache_signature(m_Cache) == m_LoadedCacheSignature) {
+        return;
+    }
+
+    QByteArray data(pl_cache_save(m_Cache, nullptr, 0), 0);
+    if (data.isEmpty()) {
+        return;
+    }
+
+    data.resize(pl_cache_save(m_Cache, (uint8_t*)data.data(), data.size()));
+    Path::writeCacheFile(m_CacheFileName, data);
+    m_LoadedCacheSignature = pl_cache_signature(m_Cache);
+#endif
+}
+
 bool PlVkRenderer::isExtensionSupportedByPhysicalDevice(VkPhysicalDevice device, const char *extensionName)
 {
     uint32_t extensionCount = 0;
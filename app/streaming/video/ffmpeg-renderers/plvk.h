@@ -10,6 +10,12 @@
 #include <libplacebo/renderer.h>
 #include <libplacebo/vulkan.h>
 
+#if PL_API_VER >= 338
+#include <libplacebo/cache.h>
+#endif
+
+#include <QString>
+
 class PlVkRenderer : public IFFmpegRenderer {
 public:
     PlVkRenderer(IFFmpegRenderer* backendRenderer);
@@ -44,6 +50,8 @@ private:
     bool isPresentModeSupportedByPhysicalDevice(VkPhysicalDevice device, VkPresentModeKHR presentMode);
     bool isColorSpaceSupportedByPhysicalDevice(VkPhysicalDevice device, VkColorSpaceKHR colorSpace);
     bool isSurfacePresentationSupportedByPhysicalDevice(VkPhysicalDevice device);
+    void loadShaderCache(VkPhysicalDeviceProperties* deviceProps);
+    void saveShaderCache();
 
     // The backend renderer if we're frontend-only
     IFFmpegRenderer* m_Backend;
@@ -91,6 +99,13 @@ private:
     // Device context used for hwaccel decoders
     AVBufferRef* m_HwDeviceCtx = nullptr;
 
+#if PL_API_VER >= 338
+    // Compiled shaders and pipelines persisted across renderers
+    pl_cache m_Cache = nullptr;
+    uint64_t m_LoadedCacheSignature = 0;
+    QString m_CacheFileName;
+#endif
+
     // Vulkan functions we call directly
     PFN_vkDestroySurfaceKHR fn_vkDestroySurfaceKHR = nullptr;
     PFN_vkGetPhysicalDeviceQueueFamilyProperties fn_vkGetPhysicalDeviceQueueFamilyProperties = nullptr;
@@ -4,6 +4,7 @@
 #include <streaming/session.h>
 
 #include "vaapi.h"
+#include "hwdevicepool.h"
 #include "utils.h"
 #include <streaming/streamutils.h>
 
@@ -44,8 +45,6 @@ VAAPIRenderer::~VAAPIRenderer()
     if (m_HwContext != nullptr) {
         AVHWDeviceContext* deviceContext = (AVHWDeviceContext*)m_HwContext->data;
         AVVAAPIDeviceContext* vaDeviceContext = (AVVAAPIDeviceContext*)deviceContext->hwctx;
-
-        // Hold onto this VADisplay since we'll need it to uninitialize VAAPI
         VADisplay display = vaDeviceContext->display;
 
         for (int i = 0; i < Overlay::OverlayMax; i++) {
@@ -57,14 +56,13 @@ VAAPIRenderer::~VAAPIRenderer()
             }
         }
 
+        // The VADisplay may be shared with other renderers via the device
+        // pool, so freeDeviceContext() will terminate it with the last reference.
         av_buffer_unref(&m_HwContext);
-
-        if (display) {
-            vaTerminate(display);
-        }
     }
 
 #ifdef HAVE_LIBVA_DRM
+    // Only set if we failed before the device context took ownership
     if (m_DrmFd >= 0) {
         close(m_DrmFd);
     }
@@ -201,22 +199,37 @@ VAAPIRenderer::tryVaInitialize(AVVAAPIDeviceContext* vaDeviceContext, PDECODER_P
     return status;
 }
 
-bool
-VAAPIRenderer::initialize(PDECODER_PARAMETERS params)
+void
+VAAPIRenderer::freeDeviceContext(AVHWDeviceContext* deviceContext)
 {
-    int err;
+    AVVAAPIDeviceContext* vaDeviceContext = (AVVAAPIDeviceContext*)deviceContext->hwctx;
+    DeviceInfo* info = (DeviceInfo*)deviceContext->user_opaque;
 
-    m_Window = params->window;
-    m_VideoFormat = params->videoFormat;
+    if (vaDeviceContext->display) {
+        vaTerminate(vaDeviceContext->display);
+    }
 
-    m_HwContext = av_hwdevice_ctx_alloc(AV_HWDEVICE_TYPE_VAAPI);
-    if (!m_HwContext) {
+    if (info != nullptr) {
+        if (info->drmFd >= 0) {
+            close(info->drmFd);
+        }
+        delete info;
+    }
+}
+
+AVBufferRef*
+VAAPIRenderer::createDeviceContext(PDECODER_PARAMETERS params)
+{
+    int err;
+
+    AVBufferRef* hwContext = av_hwdevice_ctx_alloc(AV_HWDEVICE_TYPE_VAAPI);
+    if (!hwContext) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                     "Failed to allocate VAAPI context");
-        return false;
+        return nullptr;
     }
 
-    AVHWDeviceContext* deviceContext = (AVHWDeviceContext*)m_HwContext->data;
+    AVHWDeviceContext* deviceContext = (AVHWDeviceContext*)hwContext->data;
     AVVAAPIDeviceContext* vaDeviceContext = (AVVAAPIDeviceContext*)deviceContext->hwctx;
 
     int major, minor;
@@ -348,13 +361,96 @@ VAAPIRenderer::initialize(PDECODER_PARAMETERS params)
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                      "Failed to initialize VAAPI: %d",
                      status);
-        return false;
+        av_buffer_unref(&hwContext);
+        return nullptr;
     }
 
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                 "Initialized VAAPI %d.%d",
                 major, minor);
 
+    // From here on, the device context owns the VADisplay and DRM FD
+    DeviceInfo* info = new DeviceInfo();
+#ifdef HAVE_LIBVA_DRM
+    info->drmFd = m_DrmFd;
+    m_DrmFd = -1;
+#else
+    info->drmFd = -1;
+#endif
+    info->major = major;
+    deviceContext->user_opaque = info;
+    deviceContext->free = freeDeviceContext;
+
+    // This will populate the driver_quirks
+    err = av_hwdevice_ctx_init(hwContext);
+    if (err < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Failed to initialize VAAPI context: %d",
+                     err);
+        av_buffer_unref(&hwContext);
+        return nullptr;
+    }
+
+    return hwContext;
+}
+
+bool
+VAAPIRenderer::initialize(PDECODER_PARAMETERS params)
+{
+    SDL_SysWMinfo wmInfo;
+    quintptr nativeDisplay;
+
+    m_Window = params->window;
+    m_VideoFormat = params->videoFormat;
+
+    SDL_VERSION(&wmInfo.version);
+    if (!SDL_GetWindowWMInfo(params->window, &wmInfo)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "SDL_GetWindowWMInfo() failed: %s",
+                     SDL_GetError());
+        return false;
+    }
+
+    // The VADisplay is tied to the native display, so pooled
+    // device contexts can only be shared by windows on the same one.
+    m_WindowSystem = wmInfo.subsystem;
+    switch (wmInfo.subsystem) {
+#ifdef HAVE_LIBVA_X11
+    case SDL_SYSWM_X11:
+        m_XWindow = wmInfo.info.x11.window;
+        nativeDisplay = (quintptr)wmInfo.info.x11.display;
+        break;
+#endif
+#ifdef HAVE_LIBVA_WAYLAND
+    case SDL_SYSWM_WAYLAND:
+        nativeDisplay = (quintptr)wmInfo.info.wl.display;
+        break;
+#endif
+#if defined(SDL_VIDEO_DRIVER_KMSDRM) && defined(HAVE_LIBVA_DRM) && SDL_VERSION_ATLEAST(2, 0, 15)
+    case SDL_SYSWM_KMSDRM:
+        nativeDisplay = (quintptr)wmInfo.info.kmsdrm.drm_fd;
+        break;
+#endif
+    default:
+        // openDisplay() will log the error
+        nativeDisplay = 0;
+        break;
+    }
+
+    m_HwContext = HwDevicePool::acquire(AV_HWDEVICE_TYPE_VAAPI, nativeDisplay, [this, params] {
+        return createDeviceContext(params);
+    });
+    if (!m_HwContext) {
+        // createDeviceContext() logs the error
+        return false;
+    }
+
+    AVHWDeviceContext* deviceContext = (AVHWDeviceContext*)m_HwContext->data;
+    AVVAAPIDeviceContext* vaDeviceContext = (AVVAAPIDeviceContext*)deviceContext->hwctx;
+    DeviceInfo* info = (DeviceInfo*)deviceContext->user_opaque;
+    int major = info->major;
+    VAStatus status;
+
     const char* vendorString = vaQueryVendorString(vaDeviceContext->display);
     QString vendorStr(vendorString);
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
@@ -406,15 +502,6 @@ VAAPIRenderer::initialize(PDECODER_PARAMETERS params)
         m_BlacklistedForDirectRendering = vendorStr.contains("iHD");
     }
 
-    // This will populate the driver_quirks
-    err = av_hwdevice_ctx_init(m_HwContext);
-    if (err < 0) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "Failed to initialize VAAPI context: %d",
-                     err);
-        return false;
-    }
-
     // Allocate mutex to synchronize overlay updates and rendering
     m_OverlayMutex = SDL_CreateMutex();
     if (m_OverlayMutex == nullptr) {
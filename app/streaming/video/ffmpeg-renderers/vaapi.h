@@ -83,6 +83,17 @@ public:
 #endif
 
 private:
+    // Owned by a VAAPI device context and released with it
+    struct DeviceInfo
+    {
+        int drmFd;
+        int major;
+    };
+
+    static
+    void freeDeviceContext(AVHWDeviceContext* deviceContext);
+
+    AVBufferRef* createDeviceContext(PDECODER_PARAMETERS params);
     VADisplay openDisplay(SDL_Window* window);
     VAStatus tryVaInitialize(AVVAAPIDeviceContext* vaDeviceContext, PDECODER_PARAMETERS params, int* major, int* minor);
     void renderOverlay(VADisplay display, VASurfaceID surface, Overlay::OverlayType type);
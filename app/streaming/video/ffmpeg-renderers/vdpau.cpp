@@ -1,5 +1,6 @@
 #include <streaming/session.h>
 #include "vdpau.h"
+#include "hwdevicepool.h"
 #include <streaming/streamutils.h>
 #include <utils.h>
 
@@ -76,7 +77,6 @@ VDPAURenderer::~VDPAURenderer()
 
 bool VDPAURenderer::initialize(PDECODER_PARAMETERS params)
 {
-    int err;
     VdpStatus status;
     SDL_SysWMinfo info;
 
@@ -130,63 +130,75 @@ bool VDPAURenderer::initialize(PDECODER_PARAMETERS params)
     m_VideoWidth = params->width;
     m_VideoHeight = params->height;
 
-    err = av_hwdevice_ctx_create(&m_HwContext,
-                                 AV_HWDEVICE_TYPE_VDPAU,
-                                 nullptr, nullptr, 0);
+    // libvdpau opens its own X11 display connection, so this context
+    // doesn't depend on SDL's display
+    m_HwContext = HwDevicePool::acquire(AV_HWDEVICE_TYPE_VDPAU, 0, [] {
+        AVBufferRef* hwContext = nullptr;
+        int err;
+
+        err = av_hwdevice_ctx_create(&hwContext,
+                                     AV_HWDEVICE_TYPE_VDPAU,
+                                     nullptr, nullptr, 0);
 
 #if defined(APP_IMAGE) || defined(USE_FALLBACK_DRIVER_PATHS)
-    // AppImages will be running with our libvdpau.so which means they don't know about
-    // distro-specific driver paths. To avoid failing in this scenario, we'll hardcode
-    // some such paths here for common distros. Non-AppImage packaging mechanisms won't
-    // need this fallback because either:
-    // a) They are using both distro libvdpau.so and distro VDPAU drivers (native packages)
-    // b) They are using both runtime libvdpau.so and runtime VDPAU drivers (Flatpak/Snap)
-    if (err < 0 && qEnvironmentVariableIsEmpty("VDPAU_DRIVER_PATH")) {
-        static const char* driverPathsToTry[] = {
+        // AppImages will be running with our libvdpau.so which means they don't know about
+        // distro-specific driver paths. To avoid failing in this scenario, we'll hardcode
+        // some such paths here for common distros. Non-AppImage packaging mechanisms won't
+        // need this fallback because either:
+        // a) They are using both distro libvdpau.so and distro VDPAU drivers (native packages)
+        // b) They are using both runtime libvdpau.so and runtime VDPAU drivers (Flatpak/Snap)
+        if (err < 0 && qEnvironmentVariableIsEmpty("VDPAU_DRIVER_PATH")) {
+            static const char* driverPathsToTry[] = {
 #if Q_PROCESSOR_WORDSIZE == 8
-            "/usr/lib64",
-            "/usr/lib64/vdpau", // Fedora x86_64
+                "/usr/lib64",
+                "/usr/lib64/vdpau", // Fedora x86_64
 #endif
-            "/usr/lib",
-            "/usr/lib/vdpau", // Fedora i386
+                "/usr/lib",
+                "/usr/lib/vdpau", // Fedora i386
 #if defined(Q_PROCESSOR_X86_64)
-            "/usr/lib/x86_64-linux-gnu",
-            "/usr/lib/x86_64-linux-gnu/vdpau", // Ubuntu/Debian x86_64
+                "/usr/lib/x86_64-linux-gnu",
+                "/usr/lib/x86_64-linux-gnu/vdpau", // Ubuntu/Debian x86_64
 #elif defined(Q_PROCESSOR_X86_32)
-            "/usr/lib/i386-linux-gnu",
-            "/usr/lib/i386-linux-gnu/vdpau", // Ubuntu/Debian i386
+                "/usr/lib/i386-linux-gnu",
+                "/usr/lib/i386-linux-gnu/vdpau", // Ubuntu/Debian i386
 #endif
-        };
+            };
+
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Trying fallback VDPAU driver paths");
+
+            // Unlike libva, libvdpau doesn't support multiple paths in
+            // their VDPAU_DRIVER_PATH variable, so we must try them all
+            // one at a time.
+            for (auto& driverPath : driverPathsToTry) {
+                qputenv("VDPAU_DRIVER_PATH", driverPath);
+                err = av_hwdevice_ctx_create(&hwContext,
+                                             AV_HWDEVICE_TYPE_VDPAU,
+                                             nullptr, nullptr, 0);
+                if (err == 0) {
+                    // Success!
+                    break;
+                }
+            }
 
-        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
-                    "Trying fallback VDPAU driver paths");
-
-        // Unlike libva, libvdpau doesn't support multiple paths in
-        // their VDPAU_DRIVER_PATH variable, so we must try them all
-        // one at a time.
-        for (auto& driverPath : driverPathsToTry) {
-            qputenv("VDPAU_DRIVER_PATH", driverPath);
-            err = av_hwdevice_ctx_create(&m_HwContext,
-                                         AV_HWDEVICE_TYPE_VDPAU,
-                                         nullptr, nullptr, 0);
-            if (err == 0) {
-                // Success!
-                break;
+            if (err < 0) {
+                // Unset VDPAU_DRIVER_PATH if we set it ourselves
+                // and we didn't find any working VDPAU drivers.
+                qunsetenv("VDPAU_DRIVER_PATH");
             }
         }
+#endif
 
         if (err < 0) {
-            // Unset VDPAU_DRIVER_PATH if we set it ourselves
-            // and we didn't find any working VDPAU drivers.
-            qunsetenv("VDPAU_DRIVER_PATH");
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "Failed to create VDPAU context: %d",
+                         err);
+            return (AVBufferRef*)nullptr;
         }
-    }
-#endif
 
-    if (err < 0) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "Failed to create VDPAU context: %d",
-                     err);
+        return hwContext;
+    });
+    if (m_HwContext == nullptr) {
         return false;
     }
 
@@ -2,6 +2,7 @@
 // libavutil both defining AVMediaType
 #define AVMediaType AVMediaType_FFmpeg
 #include "vt.h"
+#include "hwdevicepool.h"
 #include "pacer/pacer.h"
 #undef AVMediaType
 
@@ -455,15 +456,22 @@ public:
         #endif
         }
 
-        err = av_hwdevice_ctx_create(&m_HwContext,
-                                     AV_HWDEVICE_TYPE_VIDEOTOOLBOX,
-                                     nullptr,
-                                     nullptr,
-                                     0);
-        if (err < 0) {
-            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
-                        "av_hwdevice_ctx_create() failed for VT decoder: %d",
-                        err);
+        m_HwContext = HwDevicePool::acquire(AV_HWDEVICE_TYPE_VIDEOTOOLBOX, 0, [] {
+            AVBufferRef* hwContext = nullptr;
+            int err = av_hwdevice_ctx_create(&hwContext,
+                                             AV_HWDEVICE_TYPE_VIDEOTOOLBOX,
+                                             nullptr,
+                                             nullptr,
+                                             0);
+            if (err < 0) {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                            "av_hwdevice_ctx_create() failed for VT decoder: %d",
+                            err);
+                return (AVBufferRef*)nullptr;
+            }
+            return hwContext;
+        });
+        if (m_HwContext == nullptr) {
             return false;
         }
 
@@ -893,6 +893,30 @@ bool FFmpegVideoDecoder::tryInitializeRenderer(const AVCodec* decoder,
                                                const AVCodecHWConfig* hwConfig,
                                                IFFmpegRenderer::InitFailureReason* failureReason, // Out - Optional
                                                std::function<IFFmpegRenderer*()> createRendererFunc)
+{
+    Uint32 startTime = SDL_GetTicks();
+    bool ret = initializeRendererCandidate(decoder, requiredFormat, params, hwConfig, failureReason, createRendererFunc);
+
+    // Record how long each candidate took, since failed candidates are what
+    // make decoder selection slow on some systems.
+    const char* pixFmtName = av_get_pix_fmt_name(requiredFormat);
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Renderer candidate %s (hwaccel: %s, format: %s) %s in %u ms",
+                decoder->name,
+                hwConfig != nullptr ? av_hwdevice_get_type_name(hwConfig->device_type) : "none",
+                pixFmtName != nullptr ? pixFmtName : "any",
+                ret ? "succeeded" : "failed",
+                SDL_GetTicks() - startTime);
+
+    return ret;
+}
+
+bool FFmpegVideoDecoder::initializeRendererCandidate(const AVCodec* decoder,
+                                                     enum AVPixelFormat requiredFormat,
+                                                     PDECODER_PARAMETERS params,
+                                                     const AVCodecHWConfig* hwConfig,
+                                                     IFFmpegRenderer::InitFailureReason* failureReason, // Out - Optional
+                                                     std::function<IFFmpegRenderer*()> createRendererFunc)
 {
     DECODER_PARAMETERS testFrameDecoderParams = *params;
 
@@ -1615,9 +1639,16 @@ int FFmpegVideoDecoder::submitDecodeUnit(PDECODE_UNIT du)
             addVideoStats(m_LastWndVideoStats, lastTwoWndStats);
             addVideoStats(m_ActiveWndVideoStats, lastTwoWndStats);
 
-            stringifyVideoStats(lastTwoWndStats,
-                                Session::get()->getOverlayManager().getOverlayText(Overlay::OverlayDebug),
-                                Session::get()->getOverlayManager().getOverlayMaxTextLength());
+            char* overlayText = Session::get()->getOverlayManager().getOverlayText(Overlay::OverlayDebug);
+            int overlayMaxTextLength = Session::get()->getOverlayManager().getOverlayMaxTextLength();
+
+            stringifyVideoStats(lastTwoWndStats, overlayText, overlayMaxTextLength);
+
+            // Append input latency and event loop timing for the same window
+            int offset = (int)strlen(overlayText);
+            offset += Session::get()->getInputLatencyStats().stringify(&overlayText[offset], overlayMaxTextLength - offset);
+            Session::get()->getEventLoopStats().stringify(&overlayText[offset], overlayMaxTextLength - offset);
+
             Session::get()->getOverlayManager().setOverlayTextUpdated(Overlay::OverlayDebug);
         }
 
@@ -58,6 +58,13 @@ private:
                                IFFmpegRenderer::InitFailureReason* failureReason,
                                std::function<IFFmpegRenderer*()> createRendererFunc);
 
+    bool initializeRendererCandidate(const AVCodec* decoder,
+                                     enum AVPixelFormat requiredFormat,
+                                     PDECODER_PARAMETERS params,
+                                     const AVCodecHWConfig* hwConfig,
+                                     IFFmpegRenderer::InitFailureReason* failureReason,
+                                     std::function<IFFmpegRenderer*()> createRendererFunc);
+
     static IFFmpegRenderer* createHwAccelRenderer(const AVCodecHWConfig* hwDecodeCfg, int pass);
 
     void reset();
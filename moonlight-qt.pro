@@ -16,6 +16,12 @@ win32:!winrt {
     app.depends += soundio
 }
 
+# Backend, app model and Cemuhook server tests (run with 'make check')
+tests {
+    SUBDIRS += tests
+    tests.depends = moonlight-common-c
+}
+
 # Support debug and release builds from command line for CI
 CONFIG += debug_and_release
 
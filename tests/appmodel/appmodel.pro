@@ -0,0 +1,23 @@
+QT += core gui testlib
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_appmodel
+TEMPLATE = app
+
+include(../../globaldefs.pri)
+
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+INCLUDEPATH += $$PWD/../../app
+
+# The model sources under test are built directly into the test
+SOURCES += \
+    tst_appmodel.cpp \
+    ../../app/backend/nvapp.cpp \
+    ../../app/gui/applistmodel.cpp
+
+HEADERS += \
+    ../../app/backend/nvapp.h \
+    ../../app/gui/applistmodel.h
@@ -0,0 +1,278 @@
+#include "gui/applistmodel.h"
+
+#include <QtTest>
+
+#include <algorithm>
+#include <random>
+
+// Set to 1 to run the benchmarks at full scale. Otherwise 'make check'
+// only runs them with a small app list as a quick smoke test.
+#define BENCHMARKS_ENV_VAR "MOONLIGHT_BENCHMARKS"
+
+// Share of the apps touched by each kind of change
+#define CHANGE_PERCENT 10
+
+enum ChangeType
+{
+    CT_INSERTIONS,
+    CT_REMOVALS,
+    CT_RENAMES,
+    CT_UPDATES,
+    CT_MIXED,
+};
+
+Q_DECLARE_METATYPE(ChangeType)
+
+static
+bool benchmarksEnabled()
+{
+    return qEnvironmentVariableIntValue(BENCHMARKS_ENV_VAR) != 0;
+}
+
+// Puts the apps in display order like NvComputer::sortAppList()
+static
+void sortApps(QVector<NvApp>& apps)
+{
+    std::stable_sort(apps.begin(), apps.end(), [](const NvApp& a, const NvApp& b) {
+        return a.name.toLower() < b.name.toLower();
+    });
+}
+
+static
+NvApp createApp(int id, const QString& name)
+{
+    NvApp app;
+    app.id = id;
+    app.name = name;
+    return app;
+}
+
+static
+QVector<NvApp> createAppList(int appCount)
+{
+    QVector<NvApp> apps;
+    apps.reserve(appCount);
+    for (int i = 0; i < appCount; i++) {
+        apps.append(createApp(i + 1, QString("App %1").arg(i, 5, 10, QChar('0'))));
+    }
+
+    sortApps(apps);
+    return apps;
+}
+
+// Applies the change to a copy of the list, as a host would report it on the next app list poll
+static
+QVector<NvApp> applyChange(const QVector<NvApp>& apps, ChangeType change, std::mt19937& rng)
+{
+    QVector<NvApp> newApps = apps;
+    int changeCount = qMax(apps.count() * CHANGE_PERCENT / 100, 1);
+
+    if (change == CT_REMOVALS || change == CT_MIXED) {
+        for (int i = 0; i < changeCount && !newApps.isEmpty(); i++) {
+            newApps.remove(std::uniform_int_distribution<int>(0, newApps.count() - 1)(rng));
+        }
+    }
+
+    if (change == CT_RENAMES || change == CT_MIXED) {
+        for (int i = 0; i < changeCount; i++) {
+            NvApp& app = newApps[std::uniform_int_distribution<int>(0, newApps.count() - 1)(rng)];
+            app.name = QString("App %1 (renamed)").arg(std::uniform_int_distribution<int>(0, 99999)(rng), 5, 10, QChar('0'));
+        }
+    }
+
+    if (change == CT_UPDATES || change == CT_MIXED) {
+        for (int i = 0; i < changeCount; i++) {
+            NvApp& app = newApps[std::uniform_int_distribution<int>(0, newApps.count() - 1)(rng)];
+            app.hdrSupported = !app.hdrSupported;
+        }
+    }
+
+    if (change == CT_INSERTIONS || change == CT_MIXED) {
+        for (int i = 0; i < changeCount; i++) {
+            int id = apps.count() + i + 1;
+            newApps.append(createApp(id, QString("App %1 (new)").arg(std::uniform_int_distribution<int>(0, 99999)(rng), 5, 10, QChar('0'))));
+        }
+    }
+
+    sortApps(newApps);
+    return newApps;
+}
+
+class TestListModel : public AppListModel
+{
+public:
+    QVariant data(const QModelIndex&, int) const override
+    {
+        return QVariant();
+    }
+
+    void update(const QVector<NvApp>& apps)
+    {
+        setVisibleApps(apps);
+    }
+
+    const QVector<NvApp>& apps() const
+    {
+        return m_VisibleApps;
+    }
+};
+
+// Applies the model's row signals to a copy of its IDs, so we can check
+// that the views would end up with the same rows as the model.
+class RowTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RowTracker(TestListModel* model)
+        : m_Model(model),
+          m_Removals(0),
+          m_Insertions(0),
+          m_Moves(0),
+          m_DataChanges(0)
+    {
+        for (const NvApp& app : model->apps()) {
+            m_Ids.append(app.id);
+        }
+
+        connect(model, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex&, int first, int last) {
+            m_Ids.remove(first, last - first + 1);
+            m_Removals++;
+        });
+        connect(model, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) {
+            for (int i = first; i <= last; i++) {
+                m_Ids.insert(i, m_Model->apps().at(i).id);
+            }
+            m_Insertions++;
+        });
+        connect(model, &QAbstractItemModel::rowsMoved, this, [this](const QModelIndex&, int start, int end, const QModelIndex&, int row) {
+            // The destination row is relative to the list before the move
+            QVector<int> movedIds = m_Ids.mid(start, end - start + 1);
+            m_Ids.remove(start, movedIds.count());
+
+            int destination = row > end ? row - movedIds.count() : row;
+            for (int i = 0; i < movedIds.count(); i++) {
+                m_Ids.insert(destination + i, movedIds.at(i));
+            }
+            m_Moves++;
+        });
+        connect(model, &QAbstractItemModel::dataChanged, this, [this]() {
+            m_DataChanges++;
+        });
+    }
+
+    QVector<int> ids() const
+    {
+        return m_Ids;
+    }
+
+    TestListModel* m_Model;
+    QVector<int> m_Ids;
+    int m_Removals;
+    int m_Insertions;
+    int m_Moves;
+    int m_DataChanges;
+};
+
+class TestAppModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void updateAppList_data();
+    void updateAppList();
+};
+
+void TestAppModel::updateAppList_data()
+{
+    QTest::addColumn<int>("appCount");
+    QTest::addColumn<ChangeType>("change");
+
+    static const struct {
+        ChangeType change;
+        const char* name;
+    } changes[] = {
+        { CT_INSERTIONS, "insertions" },
+        { CT_REMOVALS, "removals" },
+        { CT_RENAMES, "renames" },
+        { CT_UPDATES, "updates" },
+        { CT_MIXED, "mixed" },
+    };
+
+    QVector<int> appCounts = { 10 };
+    if (benchmarksEnabled()) {
+        appCounts << 1000 << 10000;
+    }
+
+    for (int appCount : appCounts) {
+        for (const auto& change : changes) {
+            QTest::addRow("%d apps, %s", appCount, change.name) << appCount << change.change;
+        }
+    }
+}
+
+void TestAppModel::updateAppList()
+{
+    QFETCH(int, appCount);
+    QFETCH(ChangeType, change);
+
+    std::mt19937 rng(appCount);
+    QVector<NvApp> oldApps = createAppList(appCount);
+    QVector<NvApp> newApps = applyChange(oldApps, change, rng);
+
+    TestListModel model;
+    model.update(oldApps);
+    QCOMPARE(model.apps(), oldApps);
+
+    RowTracker tracker(&model);
+
+    QBENCHMARK_ONCE {
+        model.update(newApps);
+    }
+
+    QCOMPARE(model.apps(), newApps);
+
+    QVector<int> newIds;
+    for (const NvApp& app : newApps) {
+        newIds.append(app.id);
+    }
+    QCOMPARE(tracker.ids(), newIds);
+
+    // Each kind of change must only cause the row operations it needs
+    int changeCount = qMax(appCount * CHANGE_PERCENT / 100, 1);
+    switch (change) {
+    case CT_INSERTIONS:
+        QCOMPARE(tracker.m_Removals, 0);
+        QCOMPARE(tracker.m_Moves, 0);
+        QCOMPARE(tracker.m_DataChanges, 0);
+        QVERIFY(tracker.m_Insertions <= changeCount);
+        break;
+    case CT_REMOVALS:
+        QCOMPARE(tracker.m_Insertions, 0);
+        QCOMPARE(tracker.m_Moves, 0);
+        QCOMPARE(tracker.m_DataChanges, 0);
+        QVERIFY(tracker.m_Removals <= changeCount);
+        break;
+    case CT_RENAMES:
+        QCOMPARE(tracker.m_Insertions, 0);
+        QCOMPARE(tracker.m_Removals, 0);
+        QVERIFY(tracker.m_Moves <= changeCount);
+        QVERIFY(tracker.m_DataChanges <= changeCount);
+        break;
+    case CT_UPDATES:
+        QCOMPARE(tracker.m_Insertions, 0);
+        QCOMPARE(tracker.m_Removals, 0);
+        QCOMPARE(tracker.m_Moves, 0);
+        QVERIFY(tracker.m_DataChanges <= changeCount);
+        break;
+    case CT_MIXED:
+        break;
+    }
+
+    qInfo() << appCount << "apps:" << tracker.m_Removals << "removals," << tracker.m_Insertions << "insertions,"
+            << tracker.m_Moves << "moves and" << tracker.m_DataChanges << "data changes";
+}
+
+QTEST_GUILESS_MAIN(TestAppModel)
+
+#include "tst_appmodel.moc"
@@ -0,0 +1,75 @@
+QT += core gui network testlib
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_backend
+TEMPLATE = app
+
+include(../../globaldefs.pri)
+include(../mockhost/mockhost.pri)
+
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+win32 {
+    contains(QT_ARCH, i386) {
+        LIBS += -L$$PWD/../../libs/windows/lib/x86
+        INCLUDEPATH += $$PWD/../../libs/windows/include/x86
+    }
+    contains(QT_ARCH, x86_64) {
+        LIBS += -L$$PWD/../../libs/windows/lib/x64
+        INCLUDEPATH += $$PWD/../../libs/windows/include/x64
+    }
+    contains(QT_ARCH, arm64) {
+        LIBS += -L$$PWD/../../libs/windows/lib/arm64
+        INCLUDEPATH += $$PWD/../../libs/windows/include/arm64
+    }
+
+    INCLUDEPATH += $$PWD/../../libs/windows/include
+    LIBS += -llibssl -llibcrypto ws2_32.lib winmm.lib
+}
+macx:!disable-prebuilts {
+    INCLUDEPATH += $$PWD/../../libs/mac/include
+    LIBS += -L$$PWD/../../libs/mac/lib -lssl -lcrypto
+}
+unix:if(!macx|disable-prebuilts) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += openssl
+}
+
+INCLUDEPATH += $$PWD/../../app
+
+# The backend sources under test are built directly into the test
+SOURCES += \
+    tst_backend.cpp \
+    ../../app/backend/computerpollscheduler.cpp \
+    ../../app/backend/hoststore.cpp \
+    ../../app/backend/identitymanager.cpp \
+    ../../app/backend/nvaddress.cpp \
+    ../../app/backend/nvapp.cpp \
+    ../../app/backend/nvcomputer.cpp \
+    ../../app/backend/nvhttp.cpp \
+    ../../app/backend/nvpairingmanager.cpp \
+    ../../app/settings/compatfetcher.cpp \
+    ../../app/path.cpp \
+    ../../app/startuptracer.cpp
+
+HEADERS += \
+    ../../app/backend/computerpollscheduler.h \
+    ../../app/backend/hoststore.h \
+    ../../app/backend/identitymanager.h \
+    ../../app/backend/nvaddress.h \
+    ../../app/backend/nvapp.h \
+    ../../app/backend/nvcomputer.h \
+    ../../app/backend/nvhttp.h \
+    ../../app/backend/nvpairingmanager.h \
+    ../../app/settings/compatfetcher.h \
+    ../../app/path.h \
+    ../../app/startuptracer.h
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../../moonlight-common-c/release/ -lmoonlight-common-c
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../../moonlight-common-c/debug/ -lmoonlight-common-c
+else:unix: LIBS += -L$$OUT_PWD/../../moonlight-common-c/ -lmoonlight-common-c
+
+INCLUDEPATH += $$PWD/../../moonlight-common-c/moonlight-common-c/src
+DEPENDPATH += $$PWD/../../moonlight-common-c/moonlight-common-c/src
@@ -0,0 +1,603 @@
+#include "mockhost.h"
+
+#include "backend/computerpollscheduler.h"
+#include "backend/hoststore.h"
+#include "backend/identitymanager.h"
+#include "backend/nvcomputer.h"
+#include "backend/nvhttp.h"
+#include "backend/nvpairingmanager.h"
+
+#include <QtTest>
+#include <QSharedPointer>
+#include <QTemporaryDir>
+#include <QUuid>
+
+#ifdef Q_OS_WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+// How long hosts are polled after coming online to measure steady state
+#define STEADY_STATE_WINDOW_MS 10000
+#define STEADY_STATE_SMOKE_WINDOW_MS 1000
+
+// Set to 1 to run the benchmarks at full scale. Otherwise 'make check'
+// only runs them with a single host as a quick smoke test.
+#define BENCHMARKS_ENV_VAR "MOONLIGHT_BENCHMARKS"
+
+typedef QVector<QSharedPointer<NvComputer>> ComputerList;
+
+// CPU time used by the calling thread, which excludes the mock hosts
+static
+qint64 getThreadCpuTimeUs()
+{
+#ifdef Q_OS_WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime);
+
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+
+    // FILETIMEs are in 100 ns units
+    return (qint64)((kernel.QuadPart + user.QuadPart) / 10);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (qint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+static
+bool benchmarksEnabled()
+{
+    return qEnvironmentVariableIntValue(BENCHMARKS_ENV_VAR) != 0;
+}
+
+// Adds the host the way the user would, by address
+static
+NvComputer* createComputer(MockHost* host)
+{
+    NvHTTP http(NvAddress("127.0.0.1", host->httpPort()), 0, QSslCertificate());
+    return new NvComputer(http, http.getServerInfo(NvHTTP::NVLL_ERROR));
+}
+
+// Creates computers for all hosts in the farm that have already paired
+// and are waiting for their first poll
+static
+ComputerList createPairedComputers(MockHostFarm& farm)
+{
+    ComputerList computers;
+
+    for (int i = 0; i < farm.hostCount(); i++) {
+        NvComputer* computer = createComputer(farm.host(i));
+        computer->serverCert = MockHost::serverCert();
+        computer->state = NvComputer::CS_UNKNOWN;
+        computer->pairState = NvComputer::PS_UNKNOWN;
+        computers.append(QSharedPointer<NvComputer>(computer));
+    }
+
+    return computers;
+}
+
+static
+bool hasAppLists(const ComputerList& computers)
+{
+    for (const QSharedPointer<NvComputer>& computer : computers) {
+        QReadLocker lock(&computer->lock);
+        if (computer->appList.isEmpty()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+class TestBackend : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void serverInfo();
+
+    void pairing_data();
+    void pairing();
+
+    void unpairedClient();
+
+    void appList();
+
+    void boxArt();
+
+    void quitApp();
+
+    void droppedRequests();
+
+    void pollTimeToOnline_data();
+    void pollTimeToOnline();
+
+    void pollSteadyState_data();
+    void pollSteadyState();
+
+    void hostStore_data();
+    void hostStore();
+
+private:
+    // Polls the computers until they're all online. Returns the time it took.
+    qint64 pollUntilOnline(ComputerPollScheduler& scheduler, const ComputerList& computers, int timeoutMs);
+};
+
+void TestBackend::initTestCase()
+{
+#ifndef Q_OS_WIN32
+    // Each mock host needs a couple of listening sockets plus the
+    // connections to them, which can exceed the default soft limit.
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+#endif
+
+    // Generate our credentials up front rather than during the first test
+    QVERIFY(!IdentityManager::get()->getCertificate().isEmpty());
+}
+
+void TestBackend::serverInfo()
+{
+    MockHostFarm farm(1, MockHostConfig());
+    QVERIFY(farm.start());
+    MockHost* host = farm.host(0);
+
+    QScopedPointer<NvComputer> computer(createComputer(host));
+    QCOMPARE(computer->state, NvComputer::CS_ONLINE);
+    QCOMPARE(computer->uuid, host->uuid());
+    QCOMPARE(computer->name, host->hostname());
+    QCOMPARE(computer->activeHttpsPort, host->httpsPort());
+    QCOMPARE(computer->pairState, NvComputer::PS_NOT_PAIRED);
+    QCOMPARE(computer->currentGameId, 0);
+}
+
+void TestBackend::pairing_data()
+{
+    QTest::addColumn<QString>("appVersion");
+    QTest::addColumn<QString>("pin");
+    QTest::addColumn<int>("expectedState");
+
+    QTest::newRow("SHA-256") << "7.1.431.-1" << "1234" << (int)NvPairingManager::PAIRED;
+    QTest::newRow("SHA-1") << "5.0.0.0" << "1234" << (int)NvPairingManager::PAIRED;
+    QTest::newRow("wrong PIN") << "7.1.431.-1" << "4321" << (int)NvPairingManager::PIN_WRONG;
+}
+
+void TestBackend::pairing()
+{
+    QFETCH(QString, appVersion);
+    QFETCH(QString, pin);
+    QFETCH(int, expectedState);
+
+    MockHostConfig config;
+    config.appVersion = appVersion;
+    config.pin = "1234";
+
+    MockHostFarm farm(1, config);
+    QVERIFY(farm.start());
+    MockHost* host = farm.host(0);
+
+    QScopedPointer<NvComputer> computer(createComputer(host));
+    QSslCertificate clientCert(IdentityManager::get()->getCertificate());
+    QSslCertificate serverCert;
+
+    NvPairingManager pairingManager(computer.data());
+    QCOMPARE((int)pairingManager.pair(computer->appVersion, pin, serverCert), expectedState);
+
+    if (expectedState == NvPairingManager::PAIRED) {
+        QCOMPARE(serverCert, MockHost::serverCert());
+        QVERIFY(host->isPairedWith(clientCert));
+
+        // The host now reports us as paired over HTTPS
+        NvHTTP http(computer->activeAddress, computer->activeHttpsPort, serverCert);
+        NvComputer newState(http, http.getServerInfo(NvHTTP::NVLL_ERROR));
+        QCOMPARE(newState.pairState, NvComputer::PS_PAIRED);
+    }
+    else {
+        QVERIFY(serverCert.isNull());
+        QVERIFY(!host->isPairedWith(clientCert));
+        QCOMPARE(host->requestCount("unpair"), 1);
+    }
+}
+
+void TestBackend::unpairedClient()
+{
+    MockHostFarm farm(1, MockHostConfig());
+    QVERIFY(farm.start());
+
+    QScopedPointer<NvComputer> computer(createComputer(farm.host(0)));
+    computer->serverCert = MockHost::serverCert();
+
+    NvHTTP http(computer.data());
+    QCOMPARE(NvHTTP::getXmlString(http.getServerInfo(NvHTTP::NVLL_ERROR), "PairStatus"), QString("0"));
+
+    try {
+        http.getAppList();
+        QFAIL("App list was returned to an unpaired client");
+    } catch (const GfeHttpResponseException& e) {
+        QCOMPARE(e.getStatusCode(), 401);
+    }
+}
+
+void TestBackend::appList()
+{
+    MockHostConfig config;
+    config.paired = true;
+    config.appCount = 100;
+
+    MockHostFarm farm(1, config);
+    QVERIFY(farm.start());
+
+    QScopedPointer<NvComputer> computer(createComputer(farm.host(0)));
+    computer->serverCert = MockHost::serverCert();
+
+    NvHTTP http(computer.data());
+    QVector<NvApp> apps = http.getAppList();
+    QCOMPARE(apps.size(), config.appCount);
+    QCOMPARE(apps.first().name, QString("App 0"));
+    QCOMPARE(apps.first().id, 1);
+    QCOMPARE(apps.last().id, config.appCount);
+
+    // Storing the same list again shouldn't be reported as a change
+    QVERIFY(computer->updateAppList(apps));
+    QVERIFY(!computer->updateAppList(http.getAppList()));
+}
+
+void TestBackend::boxArt()
+{
+    MockHostConfig config;
+    config.paired = true;
+    config.boxArtSize = 128;
+
+    MockHostFarm farm(1, config);
+    QVERIFY(farm.start());
+
+    QScopedPointer<NvComputer> computer(createComputer(farm.host(0)));
+    computer->serverCert = MockHost::serverCert();
+
+    NvHTTP http(computer.data());
+    QImage image = http.getBoxArt(1);
+    QCOMPARE(image.size(), QSize(config.boxArtSize, config.boxArtSize));
+}
+
+void TestBackend::quitApp()
+{
+    MockHostConfig config;
+    config.paired = true;
+
+    MockHostFarm farm(1, config);
+    QVERIFY(farm.start());
+    MockHost* host = farm.host(0);
+    host->setCurrentGame(1);
+
+    QScopedPointer<NvComputer> computer(createComputer(host));
+    QCOMPARE(computer->currentGameId, 1);
+    computer->serverCert = MockHost::serverCert();
+
+    NvHTTP http(computer.data());
+    http.quitApp();
+    QCOMPARE(host->currentGame(), 0);
+    QCOMPARE(host->requestCount("cancel"), 1);
+}
+
+void TestBackend::droppedRequests()
+{
+    MockHostFarm farm(1, MockHostConfig());
+    QVERIFY(farm.start());
+
+    MockHostConfig config;
+    config.failurePercent = 100;
+
+    MockHostFarm failingFarm(1, config);
+    QVERIFY(failingFarm.start());
+
+    NvHTTP http(NvAddress("127.0.0.1", failingFarm.host(0)->httpPort()), 0, QSslCertificate());
+    QVERIFY_EXCEPTION_THROWN(http.getServerInfo(NvHTTP::NVLL_NONE), QtNetworkReplyException);
+
+    // A host that drops off the network is offlined by the scheduler
+    ComputerList computers;
+    computers.append(QSharedPointer<NvComputer>(createComputer(farm.host(0))));
+    computers.first()->activeAddress = NvAddress("127.0.0.1", failingFarm.host(0)->httpPort());
+
+    ComputerPollScheduler scheduler;
+    scheduler.addComputer(computers.first().data());
+    scheduler.start();
+
+    QTRY_VERIFY_WITH_TIMEOUT(computers.first()->state == NvComputer::CS_OFFLINE, 10000);
+}
+
+qint64 TestBackend::pollUntilOnline(ComputerPollScheduler& scheduler, const ComputerList& computers, int timeoutMs)
+{
+    QSet<NvComputer*> onlineComputers;
+    QElapsedTimer timer;
+    qint64 onlineTimeMs = -1;
+
+    QEventLoop loop;
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+
+    QMetaObject::Connection connection =
+            connect(&scheduler, &ComputerPollScheduler::computerStateChanged, this, [&](NvComputer* computer) {
+        QReadLocker lock(&computer->lock);
+        if (computer->state == NvComputer::CS_ONLINE) {
+            onlineComputers.insert(computer);
+            if (onlineComputers.size() == computers.size() && onlineTimeMs < 0) {
+                onlineTimeMs = timer.elapsed();
+                loop.quit();
+            }
+        }
+    });
+
+    timer.start();
+    for (const QSharedPointer<NvComputer>& computer : computers) {
+        scheduler.addComputer(computer.data());
+    }
+    scheduler.start();
+
+    loop.exec();
+
+    disconnect(connection);
+    return onlineTimeMs;
+}
+
+void TestBackend::pollTimeToOnline_data()
+{
+    QTest::addColumn<int>("hostCount");
+    QTest::addColumn<int>("latencyMs");
+
+    if (!benchmarksEnabled()) {
+        QTest::addRow("1 hosts, 0 ms latency") << 1 << 0;
+        return;
+    }
+
+    for (int hostCount : { 1, 10, 100, 1000 }) {
+        for (int latencyMs : { 0, 20 }) {
+            QTest::addRow("%d hosts, %d ms latency", hostCount, latencyMs) << hostCount << latencyMs;
+        }
+    }
+}
+
+void TestBackend::pollTimeToOnline()
+{
+    QFETCH(int, hostCount);
+    QFETCH(int, latencyMs);
+
+    MockHostConfig config;
+    config.paired = true;
+    config.latencyMs = latencyMs;
+
+    MockHostFarm farm(hostCount, config);
+    if (!farm.start()) {
+        QSKIP("Unable to start enough mock hosts");
+    }
+
+    ComputerList computers = createPairedComputers(farm);
+    ComputerPollScheduler scheduler;
+
+    qint64 startCpuUs = getThreadCpuTimeUs();
+    qint64 onlineTimeMs = pollUntilOnline(scheduler, computers, 30000 + hostCount * (latencyMs + 20));
+    qint64 cpuTimeMs = (getThreadCpuTimeUs() - startCpuUs) / 1000;
+    scheduler.stop();
+
+    QVERIFY(onlineTimeMs >= 0);
+    qInfo() << hostCount << "hosts online after" << onlineTimeMs << "ms using" << cpuTimeMs << "ms of CPU time";
+
+    QTest::setBenchmarkResult(onlineTimeMs, QTest::WalltimeMilliseconds);
+}
+
+void TestBackend::pollSteadyState_data()
+{
+    QTest::addColumn<int>("hostCount");
+    QTest::addColumn<int>("failurePercent");
+
+    if (!benchmarksEnabled()) {
+        QTest::addRow("1 hosts") << 1 << 0;
+        return;
+    }
+
+    for (int hostCount : { 1, 10, 100, 1000 }) {
+        QTest::addRow("%d hosts", hostCount) << hostCount << 0;
+    }
+    QTest::addRow("100 hosts, 5%% dropped requests") << 100 << 5;
+}
+
+void TestBackend::pollSteadyState()
+{
+    QFETCH(int, hostCount);
+    QFETCH(int, failurePercent);
+
+    MockHostConfig config;
+    config.paired = true;
+    config.failurePercent = failurePercent;
+
+    MockHostFarm farm(hostCount, config);
+    if (!farm.start()) {
+        QSKIP("Unable to start enough mock hosts");
+    }
+
+    ComputerList computers = createPairedComputers(farm);
+    ComputerPollScheduler scheduler;
+
+    QVERIFY(pollUntilOnline(scheduler, computers, 30000 + hostCount * 20) >= 0);
+
+    // Let the initial app list fetches finish
+    QTRY_VERIFY_WITH_TIMEOUT(hasAppLists(computers), 30000);
+
+    // Every state change notification causes the UI models to update
+    int stateChanges = 0;
+    connect(&scheduler, &ComputerPollScheduler::computerStateChanged, this, [&stateChanges]() {
+        stateChanges++;
+    });
+
+    int startPolls = 0;
+    for (int i = 0; i < hostCount; i++) {
+        startPolls += farm.host(i)->requestCount("serverinfo");
+    }
+
+    int windowMs = benchmarksEnabled() ? STEADY_STATE_WINDOW_MS : STEADY_STATE_SMOKE_WINDOW_MS;
+
+    qint64 startCpuUs = getThreadCpuTimeUs();
+    QTest::qWait(windowMs);
+    qint64 cpuTimeUs = getThreadCpuTimeUs() - startCpuUs;
+    scheduler.stop();
+
+    int polls = -startPolls;
+    for (int i = 0; i < hostCount; i++) {
+        polls += farm.host(i)->requestCount("serverinfo");
+    }
+
+    qInfo() << hostCount << "hosts:" << polls << "serverinfo requests in" << windowMs << "ms using"
+            << cpuTimeUs / 1000 << "ms of CPU time (" << (polls > 0 ? cpuTimeUs / polls : 0) << "us per request) with"
+            << stateChanges << "state changes";
+
+    if (failurePercent == 0) {
+        // Nothing changed on the hosts, so the UI shouldn't have been told otherwise
+        QCOMPARE(stateChanges, 0);
+    }
+
+    QTest::setBenchmarkResult(stateChanges, QTest::Events);
+}
+
+void TestBackend::hostStore_data()
+{
+    QTest::addColumn<int>("hostCount");
+    QTest::addColumn<int>("appCount");
+
+    if (!benchmarksEnabled()) {
+        QTest::addRow("2 hosts, 10 apps") << 2 << 10;
+        return;
+    }
+
+    QTest::addRow("200 hosts, 500 apps") << 200 << 500;
+}
+
+void TestBackend::hostStore()
+{
+    QFETCH(int, hostCount);
+    QFETCH(int, appCount);
+
+    MockHostFarm farm(1, MockHostConfig());
+    QVERIFY(farm.start());
+
+    // Clone a real host so every record has the fields a user's hosts would
+    QScopedPointer<NvComputer> templateComputer(createComputer(farm.host(0)));
+    templateComputer->serverCert = MockHost::serverCert();
+
+    QVector<NvComputer> computers;
+    for (int i = 0; i < hostCount; i++) {
+        NvComputer computer = *templateComputer;
+        computer.uuid = QUuid::createUuid().toString().mid(1, 36);
+        computer.name = "Host " + QString::number(i);
+
+        computer.appList.clear();
+        for (int j = 0; j < appCount; j++) {
+            NvApp app;
+            app.id = j + 1;
+            app.name = QString("App %1").arg(j, 5, 10, QChar('0'));
+            computer.appList.append(app);
+        }
+
+        computers.append(computer);
+    }
+
+    QTemporaryDir storeDir;
+    QVERIFY(storeDir.isValid());
+    QElapsedTimer timer;
+
+    // This is what every host list save used to cost
+    timer.start();
+    {
+        QSettings settings(storeDir.filePath("legacy.ini"), QSettings::IniFormat);
+        settings.beginWriteArray("hosts");
+        for (int i = 0; i < computers.count(); i++) {
+            settings.setArrayIndex(i);
+            computers[i].serialize(settings, true);
+        }
+        settings.endArray();
+        settings.sync();
+        QCOMPARE(settings.status(), QSettings::NoError);
+    }
+    qreal legacySaveMs = timer.nsecsElapsed() / 1000000.0;
+
+    HostStore store(storeDir.filePath("hosts"));
+
+    timer.restart();
+    for (const NvComputer& computer : computers) {
+        QVERIFY(store.saveHost(computer));
+        QVERIFY(store.saveAppList(computer.uuid, computer.appList));
+    }
+    qreal fullSaveMs = timer.nsecsElapsed() / 1000000.0;
+
+    // A single host's app list changing only rewrites that host's app list
+    computers[0].appList[0].name += " (renamed)";
+    timer.restart();
+    QVERIFY(store.saveAppList(computers[0].uuid, computers[0].appList));
+    qreal appListSaveMs = timer.nsecsElapsed() / 1000000.0;
+
+    // Cold start only reads the host records for the PC view
+    timer.restart();
+    const QStringList uuids = store.getHostUuids();
+    QVector<NvComputer*> loadedComputers;
+    for (const QString& uuid : uuids) {
+        NvComputer* computer = store.loadHost(uuid);
+        QVERIFY(computer != nullptr);
+        loadedComputers.append(computer);
+    }
+    qreal hostLoadMs = timer.nsecsElapsed() / 1000000.0;
+    QCOMPARE(loadedComputers.count(), hostCount);
+
+    // The app lists are loaded later in the background
+    timer.restart();
+    for (NvComputer* computer : loadedComputers) {
+        computer->appList = store.loadAppList(computer->uuid);
+    }
+    qreal appListLoadMs = timer.nsecsElapsed() / 1000000.0;
+
+    for (NvComputer* computer : loadedComputers) {
+        bool found = false;
+        for (const NvComputer& expected : computers) {
+            if (expected.uuid == computer->uuid) {
+                QVERIFY(computer->isEqualSerialized(expected));
+                found = true;
+                break;
+            }
+        }
+        QVERIFY(found);
+    }
+    qDeleteAll(loadedComputers);
+
+    qInfo() << hostCount << "hosts with" << appCount << "apps: legacy full save" << legacySaveMs << "ms,"
+            << "host store full save" << fullSaveMs << "ms, single app list save" << appListSaveMs << "ms,"
+            << "host records load" << hostLoadMs << "ms, app lists load" << appListLoadMs << "ms";
+
+    QTest::setBenchmarkResult(appListSaveMs, QTest::WalltimeMilliseconds);
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Keep our identity and hosts away from the real client's settings
+    QTemporaryDir settingsDir;
+    QCoreApplication::setOrganizationName("Moonlight Game Streaming Project");
+    QCoreApplication::setApplicationName("Moonlight Backend Tests");
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, settingsDir.path());
+
+    TestBackend test;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_backend.moc"
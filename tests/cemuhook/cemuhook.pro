@@ -0,0 +1,56 @@
+QT += core network qml testlib
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_cemuhook
+TEMPLATE = app
+
+include(../../globaldefs.pri)
+
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+win32 {
+    contains(QT_ARCH, i386) {
+        LIBS += -L$$PWD/../../libs/windows/lib/x86
+        INCLUDEPATH += $$PWD/../../libs/windows/include/x86
+    }
+    contains(QT_ARCH, x86_64) {
+        LIBS += -L$$PWD/../../libs/windows/lib/x64
+        INCLUDEPATH += $$PWD/../../libs/windows/include/x64
+    }
+    contains(QT_ARCH, arm64) {
+        LIBS += -L$$PWD/../../libs/windows/lib/arm64
+        INCLUDEPATH += $$PWD/../../libs/windows/include/arm64
+    }
+
+    INCLUDEPATH += $$PWD/../../libs/windows/include
+    LIBS += -llibssl -llibcrypto -lSDL2 ws2_32.lib winmm.lib
+}
+macx:!disable-prebuilts {
+    INCLUDEPATH += $$PWD/../../libs/mac/include
+    INCLUDEPATH += $$PWD/../../libs/mac/Frameworks/SDL2.framework/Versions/A/Headers
+    LIBS += -L$$PWD/../../libs/mac/lib -F$$PWD/../../libs/mac/Frameworks -lssl -lcrypto -framework SDL2
+}
+unix:if(!macx|disable-prebuilts) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += openssl sdl2
+}
+
+INCLUDEPATH += $$PWD/../../app
+
+# The server is built directly into the test. The input and backend headers
+# it includes are only needed for their declarations.
+SOURCES += \
+    tst_cemuhook.cpp \
+    ../../app/streaming/cemuhook.cpp \
+    ../../app/backend/identitymanager.cpp \
+    ../../app/startuptracer.cpp
+
+HEADERS += \
+    ../../app/streaming/cemuhook.h \
+    ../../app/backend/identitymanager.h \
+    ../../app/startuptracer.h
+
+INCLUDEPATH += $$PWD/../../moonlight-common-c/moonlight-common-c/src
+INCLUDEPATH += $$PWD/../../qmdnsengine/qmdnsengine/src/include $$PWD/../../qmdnsengine
@@ -0,0 +1,260 @@
+// We provide our own main()
+#define SDL_MAIN_HANDLED
+
+#include "streaming/cemuhook.h"
+#include "streaming/input/input.h"
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+// Longer than the server's subscription and client timeout
+#define SUBSCRIPTION_EXPIRY_MS 6000
+
+// How long we wait for data packets that should (or shouldn't) arrive
+#define RECEIVE_WINDOW_MS 500
+
+using namespace Cemuhook;
+
+// A minimal stand-in for a DSU client like Cemu or Dolphin
+class DsuClient
+{
+public:
+    DsuClient()
+    {
+        m_Socket.bind(QHostAddress::LocalHost, 0);
+    }
+
+    void requestVersion()
+    {
+        Request request = {};
+        sendRequest(request, sizeof(Request::header), Header::EventType::VERSION_TYPE);
+    }
+
+    void subscribeToSlot(uint8_t slot)
+    {
+        Request request = {};
+        request.data.bitmask = 0x1;
+        request.data.slot = slot;
+        sendRequest(request, sizeof(Request::data), Header::EventType::DATA_TYPE);
+    }
+
+    void subscribeToMac(const uint8_t* mac)
+    {
+        Request request = {};
+        request.data.bitmask = 0x2;
+        memcpy(request.data.mac, mac, sizeof(request.data.mac));
+        sendRequest(request, sizeof(Request::data), Header::EventType::DATA_TYPE);
+    }
+
+    // Returns the slots of all data packets received within the timeout
+    QList<int> receiveDataSlots(int timeoutMs, bool* gotVersion = nullptr)
+    {
+        QList<int> slots;
+        QElapsedTimer timer;
+        timer.start();
+
+        while (timer.elapsed() < timeoutMs) {
+            if (!m_Socket.hasPendingDatagrams() &&
+                    !m_Socket.waitForReadyRead(timeoutMs - timer.elapsed())) {
+                break;
+            }
+
+            while (m_Socket.hasPendingDatagrams()) {
+                DataResponse response = {};
+                qint64 len = m_Socket.readDatagram(reinterpret_cast<char*>(&response), sizeof(response));
+                if (len < (qint64)sizeof(Header) || strncmp(response.header.magic, "DSUS", 4) != 0) {
+                    continue;
+                }
+
+                if (response.header.eventType == Header::EventType::DATA_TYPE &&
+                        len == (qint64)sizeof(DataResponse)) {
+                    slots.append(response.shared.slot);
+                }
+                else if (response.header.eventType == Header::EventType::VERSION_TYPE &&
+                         gotVersion != nullptr) {
+                    *gotVersion = true;
+                }
+            }
+        }
+
+        return slots;
+    }
+
+private:
+    void sendRequest(Request& request, size_t size, Header::EventType eventType)
+    {
+        memcpy(request.header.magic, "DSUC", 4);
+        request.header.version = VERSION;
+        request.header.length = (uint16_t)(size - 16);
+        request.header.id = 0x1234;
+        request.header.eventType = eventType;
+        request.header.crc32 = 0;
+        request.header.crc32 = SDL_crc32(0, &request, size);
+
+        m_Socket.writeDatagram(reinterpret_cast<const char*>(&request), size,
+                               QHostAddress::LocalHost, Server::boundPort());
+    }
+
+    QUdpSocket m_Socket;
+};
+
+class TestCemuhook : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void cleanupTestCase();
+
+    void init();
+
+    void versionRequestDoesNotSubscribe();
+
+    void slotSubscription();
+
+    void macSubscription();
+
+    void idleStateOnSubscription();
+
+    void subscriptionExpiry();
+
+private:
+    // Acts as the input thread for the given gamepad slot
+    void connectPad(int index);
+
+    void updatePad(int index, int buttons);
+
+    GamepadState m_Pads[2];
+};
+
+void TestCemuhook::initTestCase()
+{
+    Server::init(QHostAddress::LocalHost, 0);
+    QVERIFY(Server::boundPort() != 0);
+}
+
+void TestCemuhook::cleanupTestCase()
+{
+    Server::destroy();
+}
+
+void TestCemuhook::init()
+{
+    for (int i = 0; i < 2; i++) {
+        m_Pads[i] = {};
+        m_Pads[i].index = i;
+        Server::disconnectSlot(&m_Pads[i]);
+    }
+}
+
+void TestCemuhook::connectPad(int index)
+{
+    // Without a controller, the pad has no serial and an all-zero MAC
+    Server::connectSlot(&m_Pads[index]);
+}
+
+void TestCemuhook::updatePad(int index, int buttons)
+{
+    m_Pads[index].buttons = buttons;
+    Server::send(&m_Pads[index]);
+}
+
+void TestCemuhook::versionRequestDoesNotSubscribe()
+{
+    DsuClient client;
+    connectPad(0);
+
+    bool gotVersion = false;
+    client.requestVersion();
+    updatePad(0, A_FLAG);
+
+    QVERIFY(client.receiveDataSlots(RECEIVE_WINDOW_MS, &gotVersion).isEmpty());
+    QVERIFY(gotVersion);
+}
+
+void TestCemuhook::slotSubscription()
+{
+    DsuClient client;
+    connectPad(0);
+    connectPad(1);
+
+    client.subscribeToSlot(1);
+    updatePad(0, A_FLAG);
+    updatePad(1, B_FLAG);
+
+    QList<int> slots = client.receiveDataSlots(RECEIVE_WINDOW_MS);
+    QVERIFY(slots.contains(1));
+    QVERIFY(!slots.contains(0));
+}
+
+void TestCemuhook::macSubscription()
+{
+    static const uint8_t otherMac[6] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+    static const uint8_t padMac[6] = {};
+
+    DsuClient otherClient;
+    DsuClient padClient;
+    connectPad(0);
+
+    otherClient.subscribeToMac(otherMac);
+    padClient.subscribeToMac(padMac);
+    updatePad(0, X_FLAG);
+
+    QVERIFY(otherClient.receiveDataSlots(RECEIVE_WINDOW_MS).isEmpty());
+    QVERIFY(padClient.receiveDataSlots(RECEIVE_WINDOW_MS).contains(0));
+}
+
+void TestCemuhook::idleStateOnSubscription()
+{
+    DsuClient client;
+    connectPad(0);
+    updatePad(0, Y_FLAG);
+
+    // Let the server go idle with nobody subscribed
+    QTest::qWait(RECEIVE_WINDOW_MS);
+
+    // The current state must be sent even though the pad didn't change
+    client.subscribeToSlot(0);
+    QVERIFY(client.receiveDataSlots(RECEIVE_WINDOW_MS).contains(0));
+
+    // But only once until it does
+    QVERIFY(client.receiveDataSlots(RECEIVE_WINDOW_MS).isEmpty());
+}
+
+void TestCemuhook::subscriptionExpiry()
+{
+    DsuClient client;
+    connectPad(0);
+
+    client.subscribeToSlot(0);
+    updatePad(0, A_FLAG);
+    QVERIFY(client.receiveDataSlots(RECEIVE_WINDOW_MS).contains(0));
+
+    // Subscriptions must be renewed by the client
+    QTest::qWait(SUBSCRIPTION_EXPIRY_MS);
+    updatePad(0, B_FLAG);
+    QVERIFY(client.receiveDataSlots(RECEIVE_WINDOW_MS).isEmpty());
+
+    // Renewing the subscription sends the current state again
+    client.subscribeToSlot(0);
+    QVERIFY(client.receiveDataSlots(RECEIVE_WINDOW_MS).contains(0));
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Keep our unique ID away from the real client's settings
+    QTemporaryDir settingsDir;
+    QCoreApplication::setOrganizationName("Moonlight Game Streaming Project");
+    QCoreApplication::setApplicationName("Moonlight Cemuhook Tests");
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, settingsDir.path());
+
+    TestCemuhook test;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_cemuhook.moc"
@@ -0,0 +1,699 @@
+#include "mockhost.h"
+#include "utils.h"
+
+#include <QtDebug>
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QImage>
+#include <QSslSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QUuid>
+
+#include <openssl/bio.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/x509.h>
+
+namespace {
+
+// Accepts TLS connections and asks clients for their certificate
+class SslServer : public QTcpServer
+{
+public:
+    explicit SslServer(QObject* parent)
+        : QTcpServer(parent)
+    {
+    }
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+};
+
+struct ServerCredentials
+{
+    QByteArray pemCert;
+    QByteArray pemKey;
+    QByteArray signature;
+    EVP_PKEY* privateKey;
+};
+
+}
+
+static
+QByteArray getCertSignature(X509* cert)
+{
+    const ASN1_BIT_STRING* asnSignature;
+    X509_get0_signature(&asnSignature, nullptr, cert);
+
+    return QByteArray(reinterpret_cast<const char*>(asnSignature->data), asnSignature->length);
+}
+
+static
+ServerCredentials generateServerCredentials()
+{
+    ServerCredentials credentials;
+
+    X509* cert = X509_new();
+    THROW_BAD_ALLOC_IF_NULL(cert);
+
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    THROW_BAD_ALLOC_IF_NULL(ctx);
+
+    EVP_PKEY_keygen_init(ctx);
+    EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048);
+
+    // pk must be initialized on input
+    EVP_PKEY* pk = NULL;
+    EVP_PKEY_keygen(ctx, &pk);
+
+    EVP_PKEY_CTX_free(ctx);
+    THROW_BAD_ALLOC_IF_NULL(pk);
+
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 0);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 60 * 60 * 24 * 365); // 1 yr
+    X509_set_pubkey(cert, pk);
+
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               reinterpret_cast<unsigned char *>(const_cast<char*>("Mock GameStream Host")),
+                               -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+
+    X509_sign(cert, pk, EVP_sha256());
+
+    BIO* biokey = BIO_new(BIO_s_mem());
+    THROW_BAD_ALLOC_IF_NULL(biokey);
+    PEM_write_bio_PrivateKey(biokey, pk, NULL, NULL, 0, NULL, NULL);
+
+    BIO* biocert = BIO_new(BIO_s_mem());
+    THROW_BAD_ALLOC_IF_NULL(biocert);
+    PEM_write_bio_X509(biocert, cert);
+
+    BUF_MEM* mem;
+    BIO_get_mem_ptr(biokey, &mem);
+    credentials.pemKey = QByteArray(mem->data, (int)mem->length);
+
+    BIO_get_mem_ptr(biocert, &mem);
+    credentials.pemCert = QByteArray(mem->data, (int)mem->length);
+
+    credentials.signature = getCertSignature(cert);
+
+    // The key is used to sign pairing secrets for the life of the process
+    credentials.privateKey = pk;
+
+    X509_free(cert);
+    BIO_free(biokey);
+    BIO_free(biocert);
+
+    return credentials;
+}
+
+static
+const ServerCredentials& getServerCredentials()
+{
+    // Generating a key is slow, so all hosts share one certificate
+    static const ServerCredentials credentials = generateServerCredentials();
+    return credentials;
+}
+
+static
+X509* readPemCert(const QByteArray& pemCert)
+{
+    BIO* bio = BIO_new_mem_buf(pemCert.data(), pemCert.length());
+    THROW_BAD_ALLOC_IF_NULL(bio);
+
+    X509* cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+    BIO_free_all(bio);
+
+    return cert;
+}
+
+static
+QByteArray aesEcb(const QByteArray& input, const QByteArray& key, bool encrypt)
+{
+    QByteArray output(input.size(), 0);
+    EVP_CIPHER_CTX* cipher;
+    int outputLen;
+
+    cipher = EVP_CIPHER_CTX_new();
+    THROW_BAD_ALLOC_IF_NULL(cipher);
+
+    EVP_CipherInit(cipher, EVP_aes_128_ecb(), reinterpret_cast<const unsigned char*>(key.data()), NULL, encrypt ? 1 : 0);
+    EVP_CIPHER_CTX_set_padding(cipher, 0);
+
+    EVP_CipherUpdate(cipher,
+                     reinterpret_cast<unsigned char*>(output.data()),
+                     &outputLen,
+                     reinterpret_cast<const unsigned char*>(input.data()),
+                     input.length());
+    Q_ASSERT(outputLen == output.length());
+
+    EVP_CIPHER_CTX_free(cipher);
+
+    return output;
+}
+
+static
+QByteArray signMessage(EVP_PKEY* privateKey, const QByteArray& message)
+{
+    EVP_MD_CTX* ctx = EVP_MD_CTX_create();
+    THROW_BAD_ALLOC_IF_NULL(ctx);
+
+    EVP_DigestSignInit(ctx, NULL, EVP_sha256(), NULL, privateKey);
+    EVP_DigestSignUpdate(ctx, message.data(), message.length());
+
+    size_t signatureLength = 0;
+    EVP_DigestSignFinal(ctx, NULL, &signatureLength);
+
+    QByteArray signature((int)signatureLength, 0);
+    EVP_DigestSignFinal(ctx, reinterpret_cast<unsigned char*>(signature.data()), &signatureLength);
+
+    EVP_MD_CTX_destroy(ctx);
+
+    return signature;
+}
+
+static
+bool verifySignature(X509* cert, const QByteArray& data, const QByteArray& signature)
+{
+    EVP_PKEY* pubKey = X509_get_pubkey(cert);
+    THROW_BAD_ALLOC_IF_NULL(pubKey);
+
+    EVP_MD_CTX* mdctx = EVP_MD_CTX_create();
+    THROW_BAD_ALLOC_IF_NULL(mdctx);
+
+    EVP_DigestVerifyInit(mdctx, nullptr, EVP_sha256(), nullptr, pubKey);
+    EVP_DigestVerifyUpdate(mdctx, data.data(), data.length());
+    int result = EVP_DigestVerifyFinal(mdctx,
+                                       reinterpret_cast<const unsigned char*>(signature.data()),
+                                       signature.length());
+
+    EVP_PKEY_free(pubKey);
+    EVP_MD_CTX_destroy(mdctx);
+
+    return result > 0;
+}
+
+static
+QByteArray generateRandomBytes(int length)
+{
+    QByteArray data(length, 0);
+    RAND_bytes(reinterpret_cast<unsigned char*>(data.data()), length);
+    return data;
+}
+
+void SslServer::incomingConnection(qintptr socketDescriptor)
+{
+    const ServerCredentials& credentials = getServerCredentials();
+
+    QSslSocket* socket = new QSslSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        delete socket;
+        return;
+    }
+
+    socket->setLocalCertificate(QSslCertificate(credentials.pemCert));
+    socket->setPrivateKey(QSslKey(credentials.pemKey, QSsl::Rsa));
+
+    // Request the client certificate without validating it, since clients
+    // use self-signed certificates. Pairing decides whether we trust it.
+    socket->setPeerVerifyMode(QSslSocket::QueryPeer);
+    socket->startServerEncryption();
+
+    addPendingConnection(socket);
+}
+
+MockHostConfig::MockHostConfig()
+    : latencyMs(0),
+      failurePercent(0),
+      appCount(10),
+      boxArtSize(64),
+      paired(false),
+      nvidiaServerSoftware(false),
+      pin("1234"),
+      appVersion("7.1.431.-1")
+{
+}
+
+MockHost::MockHost(const MockHostConfig& config, QString hostname, QObject* parent)
+    : QObject(parent),
+      m_Config(config),
+      m_Hostname(hostname),
+      m_Uuid(QUuid::createUuid().toString().mid(1, 36).toUpper()),
+      m_HttpServer(new QTcpServer(this)),
+      m_HttpsServer(new SslServer(this)),
+      m_HttpPort(0),
+      m_HttpsPort(0),
+      m_Random(std::random_device()()),
+      m_CurrentGame(0)
+{
+    // Make sure the first host pays for key generation, not the first request
+    getServerCredentials();
+
+    if (m_Config.boxArtSize > 0) {
+        QImage image(m_Config.boxArtSize, m_Config.boxArtSize, QImage::Format_RGB32);
+        image.fill(Qt::darkGreen);
+
+        QBuffer buffer(&m_BoxArt);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "PNG");
+    }
+
+    connect(m_HttpServer, &QTcpServer::newConnection, this, [this]() {
+        while (m_HttpServer->hasPendingConnections()) {
+            acceptConnection(m_HttpServer->nextPendingConnection(), false);
+        }
+    });
+    connect(m_HttpsServer, &QTcpServer::newConnection, this, [this]() {
+        while (m_HttpsServer->hasPendingConnections()) {
+            acceptConnection(m_HttpsServer->nextPendingConnection(), true);
+        }
+    });
+}
+
+MockHost::~MockHost()
+{
+}
+
+bool MockHost::listen()
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    if (!m_HttpServer->listen(QHostAddress::LocalHost, 0)) {
+        qWarning() << "Mock host failed to listen for HTTP:" << m_HttpServer->errorString();
+        return false;
+    }
+
+    if (!m_HttpsServer->listen(QHostAddress::LocalHost, 0)) {
+        qWarning() << "Mock host failed to listen for HTTPS:" << m_HttpsServer->errorString();
+        return false;
+    }
+
+    m_HttpPort = m_HttpServer->serverPort();
+    m_HttpsPort = m_HttpsServer->serverPort();
+    return true;
+}
+
+QSslCertificate MockHost::serverCert()
+{
+    return QSslCertificate(getServerCredentials().pemCert);
+}
+
+QString MockHost::uuid() const
+{
+    return m_Uuid;
+}
+
+QString MockHost::hostname() const
+{
+    return m_Hostname;
+}
+
+uint16_t MockHost::httpPort() const
+{
+    return m_HttpPort;
+}
+
+uint16_t MockHost::httpsPort() const
+{
+    return m_HttpsPort;
+}
+
+void MockHost::setCurrentGame(int appId)
+{
+    QMutexLocker lock(&m_Lock);
+    m_CurrentGame = appId;
+}
+
+int MockHost::currentGame()
+{
+    QMutexLocker lock(&m_Lock);
+    return m_CurrentGame;
+}
+
+int MockHost::requestCount(QString command)
+{
+    QMutexLocker lock(&m_Lock);
+    return m_RequestCounts.value(command);
+}
+
+bool MockHost::isPairedWith(const QSslCertificate& clientCert)
+{
+    QMutexLocker lock(&m_Lock);
+    return !clientCert.isNull() && m_PairedClientCert == clientCert;
+}
+
+void MockHost::acceptConnection(QTcpSocket* socket, bool https)
+{
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket, https]() {
+        handleReadyRead(socket, https);
+    });
+    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+
+    // The buffer outlives the disconnection, since a request being
+    // parsed can cause the socket to be aborted.
+    connect(socket, &QObject::destroyed, this, [this, socket]() {
+        m_ReadBuffers.remove(socket);
+    });
+}
+
+void MockHost::handleReadyRead(QTcpSocket* socket, bool https)
+{
+    QByteArray& buffer = m_ReadBuffers[socket];
+    buffer.append(socket->readAll());
+
+    // We only serve GET requests, so each request ends with its headers
+    int headerEnd;
+    while (socket->state() == QAbstractSocket::ConnectedState &&
+           (headerEnd = buffer.indexOf("\r\n\r\n")) >= 0) {
+        QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        buffer.remove(0, headerEnd + 4);
+
+        QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+        if (requestLine.size() < 2 || requestLine[0] != "GET") {
+            socket->abort();
+            return;
+        }
+
+        QUrl url(QString::fromLatin1(requestLine[1]));
+
+        Request request;
+        request.command = url.path().mid(1);
+        request.keepAlive = true;
+
+        for (const auto& item : QUrlQuery(url).queryItems(QUrl::FullyDecoded)) {
+            request.arguments.insert(item.first, item.second);
+        }
+
+        for (const QByteArray& line : lines) {
+            int separator = line.indexOf(':');
+            if (separator > 0 &&
+                    line.left(separator).trimmed().toLower() == "connection" &&
+                    line.mid(separator + 1).trimmed().toLower() == "close") {
+                request.keepAlive = false;
+            }
+        }
+
+        handleRequest(socket, https, request);
+    }
+}
+
+void MockHost::handleRequest(QTcpSocket* socket, bool https, const Request& request)
+{
+    {
+        QMutexLocker lock(&m_Lock);
+        m_RequestCounts[request.command]++;
+    }
+
+    if (std::uniform_int_distribution<int>(0, 99)(m_Random) < m_Config.failurePercent) {
+        // Simulate a host that drops off the network mid-request
+        socket->abort();
+        return;
+    }
+
+    Response response;
+    if (request.command == "serverinfo") {
+        response = xmlResponse(200, getServerInfo(isAuthorized(socket, https)));
+    }
+    else if (request.command == "pair") {
+        response = handlePair(socket, https, request);
+    }
+    else if (request.command == "unpair") {
+        {
+            QMutexLocker lock(&m_Lock);
+            m_PairedClientCert.clear();
+        }
+        m_PairingAesKey.clear();
+        response = xmlResponse(200);
+    }
+    else if (!isAuthorized(socket, https)) {
+        response = xmlResponse(401);
+    }
+    else if (request.command == "applist") {
+        response = xmlResponse(200, getAppList());
+    }
+    else if (request.command == "appasset") {
+        if (m_BoxArt.isEmpty()) {
+            response = xmlResponse(404);
+        }
+        else {
+            response.httpStatus = 200;
+            response.contentType = "image/png";
+            response.body = m_BoxArt;
+        }
+    }
+    else if (request.command == "cancel") {
+        setCurrentGame(0);
+        response = xmlResponse(200, "<cancel>1</cancel>");
+    }
+    else {
+        response = xmlResponse(404);
+    }
+
+    if (m_Config.latencyMs > 0) {
+        // The timer is cancelled if the socket is destroyed first
+        QTimer::singleShot(m_Config.latencyMs, socket, [this, socket, request, response]() {
+            sendResponse(socket, request, response);
+        });
+    }
+    else {
+        sendResponse(socket, request, response);
+    }
+}
+
+void MockHost::sendResponse(QTcpSocket* socket, const Request& request, const Response& response)
+{
+    QByteArray header = "HTTP/1.1 " + QByteArray::number(response.httpStatus) +
+            (response.httpStatus == 200 ? " OK" : " Error") + "\r\n"
+            "Content-Type: " + response.contentType + "\r\n"
+            "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n"
+            "Connection: " + (request.keepAlive ? "keep-alive" : "close") + "\r\n"
+            "\r\n";
+
+    socket->write(header);
+    socket->write(response.body);
+
+    if (!request.keepAlive) {
+        // Closes once the response has been written
+        socket->disconnectFromHost();
+    }
+}
+
+bool MockHost::isAuthorized(QTcpSocket* socket, bool https)
+{
+    if (!https) {
+        return false;
+    }
+
+    QSslCertificate clientCert = static_cast<QSslSocket*>(socket)->peerCertificate();
+    if (m_Config.paired) {
+        return !clientCert.isNull();
+    }
+
+    return isPairedWith(clientCert);
+}
+
+QString MockHost::getServerInfo(bool authorized)
+{
+    int currentGame = this->currentGame();
+    QString state = m_Config.nvidiaServerSoftware ? "MJOLNIR_STATE" : "SUNSHINE";
+    state += currentGame != 0 ? "_SERVER_BUSY" : "_SERVER_FREE";
+
+    return QString("<hostname>%1</hostname>"
+                   "<appversion>%2</appversion>"
+                   "<GfeVersion>3.23.0.74</GfeVersion>"
+                   "<uniqueid>%3</uniqueid>"
+                   "<HttpsPort>%4</HttpsPort>"
+                   "<ExternalPort>%5</ExternalPort>"
+                   "<mac>00:00:00:00:00:00</mac>"
+                   "<LocalIP>127.0.0.1</LocalIP>"
+                   "<ServerCodecModeSupport>259</ServerCodecModeSupport>"
+                   "<MaxLumaPixelsHEVC>1869449984</MaxLumaPixelsHEVC>"
+                   "<PairStatus>%6</PairStatus>"
+                   "<currentgame>%7</currentgame>"
+                   "<state>%8</state>")
+            .arg(m_Hostname)
+            .arg(m_Config.appVersion)
+            .arg(m_Uuid)
+            .arg(httpsPort())
+            .arg(httpPort())
+            .arg(authorized ? 1 : 0)
+            .arg(currentGame)
+            .arg(state);
+}
+
+QString MockHost::getAppList()
+{
+    QString appList;
+
+    for (int i = 0; i < m_Config.appCount; i++) {
+        appList += QString("<App>"
+                           "<IsHdrSupported>0</IsHdrSupported>"
+                           "<AppTitle>App %1</AppTitle>"
+                           "<ID>%2</ID>"
+                           "</App>").arg(i).arg(i + 1);
+    }
+
+    return appList;
+}
+
+MockHost::Response MockHost::handlePair(QTcpSocket* socket, bool https, const Request& request)
+{
+    const ServerCredentials& credentials = getServerCredentials();
+    QCryptographicHash::Algorithm hashAlgo;
+    int hashLength;
+
+    if (m_Config.appVersion.split('.').first().toInt() >= 7) {
+        hashAlgo = QCryptographicHash::Sha256;
+        hashLength = 32;
+    }
+    else {
+        hashAlgo = QCryptographicHash::Sha1;
+        hashLength = 20;
+    }
+
+    if (request.arguments.value("phrase") == "getservercert") {
+        QByteArray salt = QByteArray::fromHex(request.arguments.value("salt").toLatin1());
+
+        m_PairingClientCert = QByteArray::fromHex(request.arguments.value("clientcert").toLatin1());
+        m_PairingAesKey = QCryptographicHash::hash(salt + m_Config.pin.toLatin1(), hashAlgo).left(16);
+
+        return xmlResponse(200, "<paired>1</paired><plaincert>" +
+                           QString::fromLatin1(credentials.pemCert.toHex()) + "</plaincert>");
+    }
+    else if (request.arguments.value("phrase") == "pairchallenge") {
+        return xmlResponse(200, QString("<paired>%1</paired>").arg(isAuthorized(socket, https) ? 1 : 0));
+    }
+    else if (m_PairingAesKey.isEmpty()) {
+        // Every other stage requires pairing to be in progress
+        return xmlResponse(200, "<paired>0</paired>");
+    }
+    else if (request.arguments.contains("clientchallenge")) {
+        QByteArray clientChallenge = aesEcb(QByteArray::fromHex(request.arguments.value("clientchallenge").toLatin1()),
+                                            m_PairingAesKey, false);
+
+        m_PairingServerSecret = generateRandomBytes(16);
+        m_PairingServerChallenge = generateRandomBytes(16);
+
+        QByteArray challengeResponse = QCryptographicHash::hash(clientChallenge + credentials.signature + m_PairingServerSecret,
+                                                                hashAlgo);
+        challengeResponse.append(m_PairingServerChallenge);
+
+        // Pad to the AES block size
+        challengeResponse.append(QByteArray((16 - challengeResponse.size() % 16) % 16, 0));
+
+        return xmlResponse(200, "<paired>1</paired><challengeresponse>" +
+                           QString::fromLatin1(aesEcb(challengeResponse, m_PairingAesKey, true).toHex()) +
+                           "</challengeresponse>");
+    }
+    else if (request.arguments.contains("serverchallengeresp")) {
+        // We can only check this once the client reveals its secret
+        m_PairingClientHash = aesEcb(QByteArray::fromHex(request.arguments.value("serverchallengeresp").toLatin1()),
+                                     m_PairingAesKey, false).left(hashLength);
+
+        QByteArray pairingSecret = m_PairingServerSecret + signMessage(credentials.privateKey, m_PairingServerSecret);
+        return xmlResponse(200, "<paired>1</paired><pairingsecret>" +
+                           QString::fromLatin1(pairingSecret.toHex()) + "</pairingsecret>");
+    }
+    else if (request.arguments.contains("clientpairingsecret")) {
+        QByteArray clientPairingSecret = QByteArray::fromHex(request.arguments.value("clientpairingsecret").toLatin1());
+        QByteArray clientSecret = clientPairingSecret.left(16);
+        QByteArray clientSignature = clientPairingSecret.mid(16);
+        bool paired = false;
+
+        X509* clientCert = readPemCert(m_PairingClientCert);
+        if (clientCert != nullptr) {
+            QByteArray expectedHash = QCryptographicHash::hash(m_PairingServerChallenge + getCertSignature(clientCert) + clientSecret,
+                                                               hashAlgo);
+            paired = verifySignature(clientCert, clientSecret, clientSignature) && expectedHash == m_PairingClientHash;
+            X509_free(clientCert);
+        }
+
+        if (paired) {
+            QMutexLocker lock(&m_Lock);
+            m_PairedClientCert = QSslCertificate(m_PairingClientCert);
+        }
+
+        m_PairingAesKey.clear();
+        return xmlResponse(200, QString("<paired>%1</paired>").arg(paired ? 1 : 0));
+    }
+
+    return xmlResponse(400);
+}
+
+MockHost::Response MockHost::xmlResponse(int statusCode, QString contents)
+{
+    Response response;
+
+    // Like GFE, errors are reported in the XML rather than the HTTP status
+    response.httpStatus = 200;
+    response.contentType = "application/xml";
+    response.body = QString("<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+                            "<root status_code=\"%1\"%2>%3</root>")
+            .arg(statusCode)
+            .arg(statusCode == 200 ? QString() : QString(" status_message=\"Mock host error\""))
+            .arg(contents)
+            .toUtf8();
+
+    return response;
+}
+
+MockHostFarm::MockHostFarm(int hostCount, const MockHostConfig& config)
+    : m_HostCount(hostCount),
+      m_Config(config)
+{
+    m_Thread.setObjectName("Mock hosts");
+}
+
+MockHostFarm::~MockHostFarm()
+{
+    stop();
+}
+
+bool MockHostFarm::start()
+{
+    m_Thread.start();
+
+    for (int i = 0; i < m_HostCount; i++) {
+        MockHost* host = new MockHost(m_Config, "MockHost" + QString::number(i));
+        host->moveToThread(&m_Thread);
+        m_Hosts.append(host);
+
+        // The listening sockets must belong to the farm thread
+        bool listening = false;
+        QMetaObject::invokeMethod(host, "listen", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, listening));
+        if (!listening) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MockHostFarm::stop()
+{
+    // Hosts are deleted on their own thread before it exits
+    for (MockHost* host : m_Hosts) {
+        host->deleteLater();
+    }
+    m_Hosts.clear();
+
+    m_Thread.quit();
+    m_Thread.wait();
+}
+
+int MockHostFarm::hostCount() const
+{
+    return m_HostCount;
+}
+
+MockHost* MockHostFarm::host(int index) const
+{
+    return m_Hosts.at(index);
+}
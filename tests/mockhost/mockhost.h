@@ -0,0 +1,161 @@
+#pragma once
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+
+#include <random>
+
+struct MockHostConfig
+{
+    MockHostConfig();
+
+    // Delay before each response is sent
+    int latencyMs;
+
+    // Percentage of requests answered by dropping the connection
+    int failurePercent;
+
+    // Number of apps returned by /applist
+    int appCount;
+
+    // Width and height of the box art returned by /appasset (0 for none)
+    int boxArtSize;
+
+    // Accept any client certificate as paired instead of requiring /pair
+    bool paired;
+
+    // Report GFE's server state and versions instead of Sunshine's
+    bool nvidiaServerSoftware;
+
+    // PIN expected by /pair
+    QString pin;
+
+    // Determines the pairing hash algorithm (SHA-256 for 7 and later)
+    QString appVersion;
+};
+
+// Serves the GameStream HTTP and HTTPS endpoints used by the backend
+// (serverinfo, applist, appasset, pair and cancel) on loopback ports.
+class MockHost : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MockHost(const MockHostConfig& config, QString hostname, QObject* parent = nullptr);
+
+    virtual ~MockHost();
+
+    // Must be called on the thread that owns the host. The ports
+    // are fixed once this returns.
+    Q_INVOKABLE bool listen();
+
+    // The server certificate shared by all mock hosts
+    static
+    QSslCertificate serverCert();
+
+    QString uuid() const;
+
+    QString hostname() const;
+
+    uint16_t httpPort() const;
+
+    uint16_t httpsPort() const;
+
+    // These may be called from any thread
+    void setCurrentGame(int appId);
+
+    int currentGame();
+
+    int requestCount(QString command);
+
+    bool isPairedWith(const QSslCertificate& clientCert);
+
+private:
+    struct Request
+    {
+        QString command;
+        QHash<QString, QString> arguments;
+        bool keepAlive;
+    };
+
+    struct Response
+    {
+        int httpStatus;
+        QByteArray contentType;
+        QByteArray body;
+    };
+
+    void acceptConnection(QTcpSocket* socket, bool https);
+
+    void handleReadyRead(QTcpSocket* socket, bool https);
+
+    void handleRequest(QTcpSocket* socket, bool https, const Request& request);
+
+    void sendResponse(QTcpSocket* socket, const Request& request, const Response& response);
+
+    bool isAuthorized(QTcpSocket* socket, bool https);
+
+    QString getServerInfo(bool authorized);
+
+    QString getAppList();
+
+    Response handlePair(QTcpSocket* socket, bool https, const Request& request);
+
+    static
+    Response xmlResponse(int statusCode, QString contents = QString());
+
+    MockHostConfig m_Config;
+    QString m_Hostname;
+    QString m_Uuid;
+    QTcpServer* m_HttpServer;
+    QTcpServer* m_HttpsServer;
+    uint16_t m_HttpPort;
+    uint16_t m_HttpsPort;
+    QHash<QTcpSocket*, QByteArray> m_ReadBuffers;
+    QByteArray m_BoxArt;
+    std::mt19937 m_Random;
+
+    // Pairing in progress
+    QByteArray m_PairingClientCert;
+    QByteArray m_PairingAesKey;
+    QByteArray m_PairingServerSecret;
+    QByteArray m_PairingServerChallenge;
+    QByteArray m_PairingClientHash;
+
+    QMutex m_Lock;
+    QSslCertificate m_PairedClientCert; // Protected by m_Lock
+    int m_CurrentGame; // Protected by m_Lock
+    QHash<QString, int> m_RequestCounts; // Protected by m_Lock
+};
+
+// Runs a number of mock hosts on their own thread, so blocking clients
+// on the calling thread can talk to them.
+class MockHostFarm
+{
+public:
+    MockHostFarm(int hostCount, const MockHostConfig& config);
+
+    ~MockHostFarm();
+
+    // Returns false if any host failed to listen
+    bool start();
+
+    void stop();
+
+    int hostCount() const;
+
+    MockHost* host(int index) const;
+
+private:
+    int m_HostCount;
+    MockHostConfig m_Config;
+    QThread m_Thread;
+    QVector<MockHost*> m_Hosts;
+};
@@ -0,0 +1,5 @@
+# Mock GameStream hosts for backend tests
+INCLUDEPATH += $$PWD $$PWD/../../app
+
+SOURCES += $$PWD/mockhost.cpp
+HEADERS += $$PWD/mockhost.h